@@ -60,7 +60,7 @@ cp .profile ~/.profile
 
 
 
-sudo apt install qt5-default libqt5opengl5-dev qtchooser libgraphicsmagick++1-dev -y
+sudo apt install qt5-default libqt5opengl5-dev qtchooser -y
 
 
 
@@ -107,12 +107,6 @@ python setup.py build_ext --inplace
 
 
 
-### Install Slic3r
-sudo apt install slic3r -y
-
-
-
-
 sudo apt install samba -y
 
 
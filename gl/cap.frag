@@ -0,0 +1,5 @@
+#version 120
+
+void main() {
+    gl_FragColor = vec4(0.93, 0.55, 0.16, 1.0);
+}
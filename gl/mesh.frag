@@ -2,9 +2,20 @@
 
 uniform float zoom;
 
+// When clip is set, everything above clip_z (in model units) is cut away.
+// Discarding fragments works the same on every GL 2.1 driver, llvmpipe
+// included, which fixed-function clip planes don't.
+uniform bool clip;
+uniform float clip_z;
+
 varying vec3 ec_pos;
+varying float model_z;
 
 void main() {
+    if (clip && model_z > clip_z) {
+        discard;
+    }
+
     vec3 base3 = vec3(0.99, 0.96, 0.89);
     vec3 base2 = vec3(0.92, 0.91, 0.83);
     vec3 base00 = vec3(0.40, 0.48, 0.51);
@@ -1,13 +1,19 @@
 #version 120
 attribute vec3 vertex_position;
 
+// Positions arrive normalized to 0..1 over the mesh's bounding box
+uniform vec3 vertex_offset;
+uniform vec3 vertex_scale;
+
 uniform mat4 transform_matrix;
 uniform mat4 view_matrix;
 
 varying vec3 ec_pos;
+varying float model_z;
 
 void main() {
-    gl_Position = view_matrix*transform_matrix*
-        vec4(vertex_position, 1.0);
+    vec3 position = vertex_offset + vertex_scale*vertex_position;
+    gl_Position = view_matrix*transform_matrix*vec4(position, 1.0);
     ec_pos = gl_Position.xyz;
+    model_z = position.z;
 }
@@ -2,8 +2,16 @@
 
 uniform float zoom;
 
+uniform bool clip;
+uniform float clip_z;
+
 varying vec3 ec_pos;
+varying float model_z;
 
 void main() {
+    if (clip && model_z > clip_z) {
+        discard;
+    }
+
     gl_FragColor = vec4(1.0, 1.0, 1.0, 1.0);
 }
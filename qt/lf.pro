@@ -19,6 +19,7 @@ SOURCES +=                          \
     ../src/backdrop.cpp             \
     ../src/buildinfo.cpp            \
     ../src/canvas.cpp               \
+    ../src/compressedfilereader.cpp \
     ../src/constants.cpp            \
     ../src/debug.cpp                \
     ../src/debuglogcopier.cpp       \
@@ -30,14 +31,22 @@ SOURCES +=                          \
     ../src/hasher.cpp               \
     ../src/key.cpp                  \
     ../src/keyboard.cpp             \
+    ../src/layerarchive.cpp         \
+    ../src/layerrenderer.cpp        \
     ../src/lightfieldstyle.cpp      \
     ../src/loader.cpp               \
     ../src/main.cpp                 \
     ../src/mesh.cpp                 \
+    ../src/meshcache.cpp            \
+    ../src/meshsimplifier.cpp       \
+    ../src/modelfingerprint.cpp     \
+    ../src/modellibraryproxymodel.cpp \
+    ../src/modelmetadataindex.cpp   \
     ../src/ordermanifestmanager.cpp \
     ../src/movementsequencer.cpp    \
     ../src/paramslider.cpp          \
     ../src/pngdisplayer.cpp         \
+    ../src/polygonrasterizer.cpp    \
     ../src/preparetab.cpp           \
     ../src/printjob.cpp             \
     ../src/printmanager.cpp         \
@@ -47,17 +56,20 @@ SOURCES +=                          \
     ../src/processrunner.cpp        \
     ../src/profilestab.cpp          \
     ../src/progressdialog.cpp       \
+    ../src/projectorcontroller.cpp  \
     ../src/shepherd.cpp             \
     ../src/signalhandler.cpp        \
+    ../src/slicecache.cpp           \
+    ../src/slicer.cpp               \
     ../src/slicesorderpopup.cpp	    \
     ../src/slicertask.cpp           \
     ../src/spoiler.cpp              \
     ../src/statustab.cpp            \
     ../src/stdiologger.cpp          \
     ../src/strings.cpp              \
-    ../src/svgrenderer.cpp          \
     ../src/systemtab.cpp            \
     ../src/tabbase.cpp              \
+    ../src/thumbnailrenderer.cpp    \
     ../src/timinglogger.cpp         \
     ../src/tilingmanager.cpp        \
     ../src/tilingtab.cpp            \
@@ -76,6 +88,7 @@ HEADERS  +=                         \
     ../src/backdrop.h               \
     ../src/buildinfo.h              \
     ../src/canvas.h                 \
+    ../src/compressedfilereader.h   \
     ../src/constants.h              \
     ../src/coordinate.h             \
     ../src/debug.h                  \
@@ -90,14 +103,23 @@ HEADERS  +=                         \
     ../src/key.h                    \
     ../src/keyboard.h               \
     ../src/initialshoweventmixin.h  \
+    ../src/layerarchive.h           \
+    ../src/layerrenderer.h          \
     ../src/lightfieldstyle.h        \
     ../src/loader.h                 \
     ../src/mesh.h                   \
+    ../src/meshcache.h              \
+    ../src/meshsimplifier.h         \
+    ../src/modelfingerprint.h       \
+    ../src/modellibraryproxymodel.h \
+    ../src/modelmetadataindex.h     \
     ../src/movementsequencer.h      \
     ../src/spoiler.h                \
     ../src/ordermanifestmanager.h   \
+    ../src/parallel.h               \
     ../src/paramslider.h            \
     ../src/pngdisplayer.h           \
+    ../src/polygonrasterizer.h      \
     ../src/preparetab.h             \
     ../src/printjob.h               \
     ../src/printmanager.h           \
@@ -108,16 +130,19 @@ HEADERS  +=                         \
     ../src/profilesjsonparser.h     \
     ../src/profilestab.h            \
     ../src/progressdialog.h         \
+    ../src/projectorcontroller.h    \
     ../src/shepherd.h               \
     ../src/signalhandler.h          \
+    ../src/slicecache.h             \
+    ../src/slicer.h                 \
     ../src/slicesorderpopup.h	    \
     ../src/slicertask.h             \
     ../src/statustab.h              \
     ../src/stdiologger.h            \
     ../src/strings.h                \
-    ../src/svgrenderer.h            \
     ../src/systemtab.h              \
     ../src/tabbase.h                \
+    ../src/thumbnailrenderer.h      \
     ../src/timinglogger.h           \
     ../src/tilingmanager.h          \
     ../src/tilingtab.h              \
@@ -127,12 +152,12 @@ HEADERS  +=                         \
     ../src/usbmountmanager.h        \
     ../src/utils.h                  \
     ../src/version.h                \
-    ../src/vertex.h                 \
     ../src/window.h \
     ../src/thicknesswindow.h
 
 CONFIG += c++1z precompile_header link_pkgconfig
-PKGCONFIG = GraphicsMagick++
+PKGCONFIG += libzstd
+LIBS += -lz
 PRECOMPILED_HEADER = ../src/pch.h
 
 RESOURCES += \
@@ -5,6 +5,7 @@
 #include "pngdisplayer.h"
 #include "printjob.h"
 #include "printmanager.h"
+#include "projectorcontroller.h"
 #include "shepherd.h"
 #include "advancedtabselectionmodel.h"
 #include "paramslider.h"
@@ -206,7 +207,7 @@ void AdvancedTab::_projectImage( char const* fileName ) {
         _pngDisplayer->clear( );
     }
 
-    QProcess::startDetached( SetProjectorPowerCommand, { QString { "%1" }.arg( _isProjectorOn ? PercentagePowerLevelToRawLevel( _powerLevelSlider->value( ) ) : 0 ) } );
+    App::projectorController( )->setPowerLevel( _isProjectorOn ? PercentagePowerLevelToRawLevel( _powerLevelSlider->value( ) ) : 0 );
 
     setPrinterAvailable( !_isProjectorOn );
     emit printerAvailabilityChanged( _isPrinterAvailable );
@@ -237,7 +238,7 @@ void AdvancedTab::projectFocusImageButton_clicked( bool checked ) {
 }
 
 void AdvancedTab::powerLevelSlider_sliderReleased( ) {
-    QProcess::startDetached( SetProjectorPowerCommand, { QString { "%1" }.arg( _isProjectorOn ? PercentagePowerLevelToRawLevel( _powerLevelSlider->value( ) ) : 0 ) } );
+    App::projectorController( )->setPowerLevel( _isProjectorOn ? PercentagePowerLevelToRawLevel( _powerLevelSlider->value( ) ) : 0 );
 
     emit projectorPowerLevelChanged( _powerLevelSlider->value( ) );
 }
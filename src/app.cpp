@@ -2,7 +2,10 @@
 
 #include "buildinfo.h"
 #include "lightfieldstyle.h"
+#include "modelfingerprint.h"
+#include "projectorcontroller.h"
 #include "signalhandler.h"
+#include "slicecache.h"
 #include "version.h"
 #include "window.h"
 
@@ -21,6 +24,7 @@ namespace {
         QCommandLineOption {               "s",            "Run at 800×480.",                                                                       },
         QCommandLineOption {               "x",            "Offsets the projected image horizontally.",                              "xOffset", "0" },
         QCommandLineOption {               "y",            "Offsets the projected image vertically.",                                "yOffset", "0" },
+        QCommandLineOption {               "c",            "Limits the disk space used by cached slices, in MiB.",                   "budget", "4096" },
 #if defined _DEBUG
         QCommandLineOption {               "h",            "Positions main window at (0, 0)."                                                       },
         QCommandLineOption {               "i",            "Sets FramelessWindowHint instead of BypassWindowManagerHint on windows."                },
@@ -28,6 +32,7 @@ namespace {
         QCommandLineOption {               "k",            "Ignore stdio-shepherd failure reports."                                                 },
         QCommandLineOption {               "m",            "Pretend printer is online."                                                             },
         QCommandLineOption {               "n",            "Ignore USB."                                                                            },
+        QCommandLineOption {               "p",            "Use a mock projector instead of the real one."                                          },
 #endif // defined _DEBUG
     };
 
@@ -68,6 +73,18 @@ namespace {
                 ::exit( 1 );
             }
         },
+        [] ( ) { // -c
+            auto value = CommandLineParser.value( CommandLineOptions[5] );
+
+            bool ok = false;
+            auto budget = value.toInt( &ok, 10 );
+            if ( ok && ( budget > 0 ) ) {
+                g_settings.sliceCacheBudget = budget;
+            } else {
+                ::fprintf( stderr, "Invalid value given for -c parameter.\n" );
+                ::exit( 1 );
+            }
+        },
 #if defined _DEBUG
         [] ( ) { // -h
             MoveMainWindow = true;
@@ -87,12 +104,16 @@ namespace {
         [] ( ) { // -n
             g_settings.ignoreUsb = true;
         },
+        [] ( ) { // -p
+            g_settings.mockProjector = true;
+        },
 #endif // defined _DEBUG
     };
 
 }
 
-Window* App::_window { };
+Window*              App::_window              { };
+ProjectorController* App::_projectorController { };
 
 void App::_parseCommandLine( ) {
     CommandLineParser.setOptionsAfterPositionalArgumentsMode( QCommandLineParser::ParseAsOptions );
@@ -279,7 +300,12 @@ App::App( int& argc, char* argv[] ): QApplication( argc, argv ) {
         ::exit( 1 );
     }
 
-    QProcess::startDetached( SetProjectorPowerCommand, { "0" } );
+#if defined _DEBUG
+    _projectorController = new ProjectorController { g_settings.mockProjector ? new MockProjectorBackend : ProjectorBackend::create( ) };
+#else
+    _projectorController = new ProjectorController { ProjectorBackend::create( ) };
+#endif // defined _DEBUG
+    _projectorController->setPowerLevel( 0 );
 
     _setTheme( );
 
@@ -297,12 +323,19 @@ void App::terminate( ) {
     _window->deleteLater( );
     _window = nullptr;
 
-    QProcess::startDetached( SetProjectorPowerCommand,     { "0" } );
-    QProcess::startDetached( ResetLumenArduinoPortCommand, {     } );
+    // Waits for the projector to be turned off
+    _projectorController->setPowerLevel( 0 );
+    delete _projectorController;
+    _projectorController = nullptr;
+
+    QProcess::startDetached( ResetLumenArduinoPortCommand, { } );
 
     delete _debugManager;
     _debugManager = nullptr;
 
+    ModelFingerprint::flush( );
+    SliceCache::flush( );
+
     PidFile.remove( );
 
     debug( "LightField version %s terminating at %s (pid: %d).\n", LIGHTFIELD_VERSION_STRING, QDateTime::currentDateTime( ).toString( Qt::ISODate ).toUtf8( ).data( ), getpid( ) );
@@ -4,6 +4,7 @@
 #include <QtCore>
 #include <QtWidgets>
 
+class ProjectorController;
 class Window;
 
 enum class Theme {
@@ -23,12 +24,14 @@ public:
     bool   frameless                { false  };
 
     int    buildPlatformOffset      {    300 }; // µm
+    int    sliceCacheBudget         {   4096 }; // MiB
 
 #if defined _DEBUG
     bool   pretendPrinterIsPrepared { false  };
     bool   ignoreShepherdFailures   { false  };
     bool   pretendPrinterIsOnline   { false  };
     bool   ignoreUsb                { false  };
+    bool   mockProjector            { false  };
 #endif // defined _DEBUG
 
 };
@@ -57,11 +60,13 @@ public slots:
 
 public /*static*/:
 
-    static Window* mainWindow( ) { return _window; }
+    static Window*              mainWindow( )          { return _window;              }
+    static ProjectorController* projectorController( ) { return _projectorController; }
 
 private /*static*/:
 
-    static Window* _window;
+    static Window*              _window;
+    static ProjectorController* _projectorController;
 
 };
 
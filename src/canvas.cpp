@@ -5,23 +5,46 @@
 #include "glmesh.h"
 #include "mesh.h"
 
+// Most triangles drawn per frame while the view is being moved
+static const size_t InteractiveTriangleBudget = 300000;
+
 Canvas::Canvas(QWidget *parent)
-    : QOpenGLWidget(parent), mesh(nullptr),
+    : QOpenGLWidget(parent), mesh(nullptr), showing_preview(false),
+      cross_section(false), cross_section_z(0),
       scale(1), zoom(1), tilt(90), yaw(0),
-      perspective(0.25), anim(this, "perspective"), status(" ")
+      perspective(0.25), anim(this, "perspective"),
+      interacting(false), status(" ")
 {
     setFormat(QSurfaceFormat::defaultFormat());
     anim.setDuration(100);
+
+    refine_timer.setSingleShot(true);
+    refine_timer.setInterval(250);
+    QObject::connect(&refine_timer, &QTimer::timeout, [this]() {
+        interacting = false;
+        update();
+    });
 }
 
 Canvas::~Canvas()
 {
     makeCurrent();
+    delete_meshes();
+    doneCurrent();
+}
+
+void Canvas::delete_meshes()
+{
     if (mesh)
     {
         delete mesh;
+        mesh = nullptr;
     }
-    doneCurrent();
+    for (auto level : levels)
+    {
+        delete level;
+    }
+    levels.clear();
 }
 
 void Canvas::view_anim(float v)
@@ -51,36 +74,70 @@ void Canvas::draw_wireframe()
     set_drawMode(1);
 }
 
+void Canvas::set_cross_section(float z)
+{
+    cross_section = true;
+    cross_section_z = z;
+    update();
+}
+
+void Canvas::clear_cross_section()
+{
+    cross_section = false;
+    update();
+}
+
 void Canvas::load_mesh(Mesh* m)
 {
-    if (mesh) {
-        delete mesh;
-    }
+    // Keep the camera where it is if the user has already been looking at
+    // this model's preview
+    set_mesh(m, !showing_preview);
+    showing_preview = false;
+}
+
+void Canvas::load_preview(Mesh* m)
+{
+    set_mesh(m, true);
+    showing_preview = true;
+}
+
+void Canvas::set_mesh(Mesh* m, bool reset_camera)
+{
+    makeCurrent();
+    delete_meshes();
     mesh = new GLMesh(m);
+    for (auto level : m->levels_of_detail())
+    {
+        levels.push_back(new GLMesh(level));
+    }
+    doneCurrent();
 
-    QVector3D lower(m->xmin(), m->ymin(), m->zmin());
-    QVector3D upper(m->xmax(), m->ymax(), m->zmax());
+    mesh_lower = QVector3D(m->xmin(), m->ymin(), m->zmin());
+    mesh_upper = QVector3D(m->xmax(), m->ymax(), m->zmax());
 
     delete m;
 
-    center = (lower + upper) / 2;
-    gravityCenter = center;
-    scale = 2 / (upper - lower).length();
-
-    // Reset other camera parameters
-    zoom = 1;
-    yaw = 0;
-    tilt = 90;
+    if (reset_camera)
+    {
+        center = (mesh_lower + mesh_upper) / 2;
+        gravityCenter = center;
+        scale = 2 / (mesh_upper - mesh_lower).length();
+
+        // Reset other camera parameters
+        zoom = 1;
+        yaw = 0;
+        tilt = 90;
+    }
 
     update();
 }
 
 void Canvas::clear()
 {
-    if (mesh) {
-        delete mesh;
-        mesh = nullptr;
-    }
+    makeCurrent();
+    delete_meshes();
+    doneCurrent();
+    showing_preview = false;
     status.clear();
 
     update();
@@ -120,6 +177,9 @@ void Canvas::initializeGL()
     mesh_wireframe_shader.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/gl/mesh.vert");
     mesh_wireframe_shader.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/gl/mesh_wireframe.frag");
     mesh_wireframe_shader.link();
+    cap_shader.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/gl/cap.vert");
+    cap_shader.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/gl/cap.frag");
+    cap_shader.link();
 
     backdrop = new Backdrop();
 }
@@ -133,6 +193,7 @@ void Canvas::paintGL()
 
     backdrop->draw();
     if (mesh)  draw_mesh();
+    if (mesh && cross_section)  draw_cross_section_cap();
 
     if (status.isNull())  return;
 
@@ -157,24 +218,14 @@ void Canvas::draw_mesh()
     }
 
     selected_mesh_shader->bind();
-
-    // Load the transform and view matrices into the shader
-    glUniformMatrix4fv(
-                selected_mesh_shader->uniformLocation("transform_matrix"),
-                1, GL_FALSE, transform_matrix().data());
-    glUniformMatrix4fv(
-                selected_mesh_shader->uniformLocation("view_matrix"),
-                1, GL_FALSE, view_matrix().data());
-
-    // Compensate for z-flattening when zooming
-    glUniform1f(selected_mesh_shader->uniformLocation("zoom"), 1/zoom);
+    set_mesh_uniforms(*selected_mesh_shader);
 
     // Find and enable the attribute location for vertex position
     const GLuint vp = selected_mesh_shader->attributeLocation("vertex_position");
     glEnableVertexAttribArray(vp);
 
     // Then draw the mesh with that vertex position
-    mesh->draw(vp);
+    mesh_to_draw()->draw(*selected_mesh_shader, vp);
 
     // Reset draw mode for the background and anything else that needs to be drawn
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
@@ -184,6 +235,106 @@ void Canvas::draw_mesh()
     selected_mesh_shader->release();
 }
 
+void Canvas::set_mesh_uniforms(QOpenGLShaderProgram& shader)
+{
+    // Load the transform and view matrices into the shader
+    glUniformMatrix4fv(
+                shader.uniformLocation("transform_matrix"),
+                1, GL_FALSE, transform_matrix().data());
+    glUniformMatrix4fv(
+                shader.uniformLocation("view_matrix"),
+                1, GL_FALSE, view_matrix().data());
+
+    // Compensate for z-flattening when zooming
+    glUniform1f(shader.uniformLocation("zoom"), 1/zoom);
+
+    // Cut the model away above the cross-section, if there is one
+    glUniform1i(shader.uniformLocation("clip"), cross_section);
+    glUniform1f(shader.uniformLocation("clip_z"), cross_section_z);
+}
+
+void Canvas::draw_cross_section_cap()
+{
+    // Draw the clipped mesh again into the stencil buffer only, inverting
+    // the stencil value for every surface each pixel's ray crosses.  Above
+    // the cut everything has been discarded, so where the count is odd the
+    // ray meets the cut plane inside the solid.
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_DEPTH_TEST);
+
+    mesh_shader.bind();
+    set_mesh_uniforms(mesh_shader);
+    const GLuint vp = mesh_shader.attributeLocation("vertex_position");
+    glEnableVertexAttribArray(vp);
+    mesh_to_draw()->draw(mesh_shader, vp);
+    glDisableVertexAttribArray(vp);
+    mesh_shader.release();
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+
+    // Then fill those pixels with a quad lying in the cut plane, a little
+    // larger than the model.  The depth test still applies, so parts of
+    // the model in front of the cut hide it as they should.
+    glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+    const QVector3D margin = (mesh_upper - mesh_lower) * 0.01f + QVector3D(1, 1, 1);
+    const QVector3D lower = mesh_lower - margin;
+    const QVector3D upper = mesh_upper + margin;
+    const GLfloat quad[] = {
+        lower.x(), lower.y(), cross_section_z,
+        upper.x(), lower.y(), cross_section_z,
+        lower.x(), upper.y(), cross_section_z,
+        upper.x(), upper.y(), cross_section_z};
+
+    cap_shader.bind();
+    glUniformMatrix4fv(
+                cap_shader.uniformLocation("transform_matrix"),
+                1, GL_FALSE, transform_matrix().data());
+    glUniformMatrix4fv(
+                cap_shader.uniformLocation("view_matrix"),
+                1, GL_FALSE, view_matrix().data());
+    const GLuint cp = cap_shader.attributeLocation("vertex_position");
+    glEnableVertexAttribArray(cp);
+    glVertexAttribPointer(cp, 3, GL_FLOAT, false, 3*sizeof(GLfloat), quad);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(cp);
+    cap_shader.release();
+
+    glDisable(GL_STENCIL_TEST);
+}
+
+GLMesh* Canvas::mesh_to_draw() const
+{
+    if (!interacting || mesh->triangle_count() <= InteractiveTriangleBudget)
+    {
+        return mesh;
+    }
+
+    // Use the most detailed level that fits in the budget
+    for (auto level : levels)
+    {
+        if (level->triangle_count() <= InteractiveTriangleBudget)
+        {
+            return level;
+        }
+    }
+    return levels.empty() ? mesh : levels.back();
+}
+
+void Canvas::start_interaction()
+{
+    interacting = true;
+    refine_timer.start();
+}
+
 QMatrix4x4 Canvas::transform_matrix() const
 {
     QMatrix4x4 m;
@@ -218,6 +369,7 @@ void Canvas::mousePressEvent(QMouseEvent* event)
     {
         mouse_pos = event->pos();
         setCursor(Qt::ClosedHandCursor);
+        start_interaction();
     }
 }
 
@@ -227,6 +379,7 @@ void Canvas::mouseReleaseEvent(QMouseEvent* event)
         event->button() == Qt::RightButton)
     {
         unsetCursor();
+        refine_timer.start();
     }
 }
 
@@ -236,6 +389,11 @@ void Canvas::mouseMoveEvent(QMouseEvent* event)
     auto d = p - mouse_pos;
 
 
+    if (event->buttons() & (Qt::LeftButton | Qt::RightButton))
+    {
+        start_interaction();
+    }
+
     if (event->buttons() & Qt::LeftButton)
     {
         yaw = fmod(yaw - d.x(), 360);
@@ -278,6 +436,7 @@ void Canvas::wheelEvent(QWheelEvent *event)
     QVector3D b = transform_matrix().inverted() *
                   view_matrix().inverted() * v;
     center += b - a;
+    start_interaction();
     update();
 }
 
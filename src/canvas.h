@@ -22,10 +22,16 @@ public:
     void draw_shaded();
     void draw_wireframe();
 
+    /*  Shows a cross-section: the model is cut away above height z (in
+     *  model units) and the cut is filled in with a solid cap */
+    void set_cross_section(float z);
+    void clear_cross_section();
+
 public slots:
     void set_status(const QString& s);
     void clear_status();
     void load_mesh(Mesh* m);
+    void load_preview(Mesh* m);
     void clear();
 
 protected:
@@ -44,6 +50,12 @@ protected:
 
 private:
     void draw_mesh();
+    void draw_cross_section_cap();
+    void set_mesh_uniforms(QOpenGLShaderProgram& shader);
+    void set_mesh(Mesh* m, bool reset_camera);
+    void delete_meshes();
+    void start_interaction();
+    GLMesh* mesh_to_draw() const;
 
     QMatrix4x4 transform_matrix() const;
     QMatrix4x4 view_matrix() const;
@@ -51,10 +63,19 @@ private:
     QOpenGLShaderProgram mesh_shader;
     QOpenGLShaderProgram mesh_wireframe_shader;
     QOpenGLShaderProgram quad_shader;
+    QOpenGLShaderProgram cap_shader;
 
     GLMesh* mesh;
+    std::vector<GLMesh*> levels;
+    bool showing_preview;
     Backdrop* backdrop;
 
+    QVector3D mesh_lower;
+    QVector3D mesh_upper;
+
+    bool cross_section;
+    float cross_section_z;
+
     QVector3D center;
     QVector3D gravityCenter;
     float scale;
@@ -67,6 +88,11 @@ private:
     Q_PROPERTY(float perspective MEMBER perspective WRITE set_perspective);
     QPropertyAnimation anim;
 
+    /*  While the view is being moved, a coarser level of detail is drawn;
+     *  the full mesh comes back once it has been still for a moment. */
+    bool interacting;
+    QTimer refine_timer;
+
     QPoint mouse_pos;
     QString status;
 };
@@ -0,0 +1,226 @@
+#include "pch.h"
+
+#include <zlib.h>
+#include <zstd.h>
+
+#include "compressedfilereader.h"
+
+namespace {
+
+    qint64 constexpr InputBufferSize { 1024 * 1024 };
+
+}
+
+CompressedFileReader::CompressedFileReader( QString const& fileName, QObject* parent ): QIODevice( parent ), _file( fileName ) {
+    /*empty*/
+}
+
+CompressedFileReader::~CompressedFileReader( ) {
+    close( );
+}
+
+CompressionFormat CompressedFileReader::detectFormat( QByteArray const& leadingBytes ) {
+    auto bytes = reinterpret_cast<uchar const*>( leadingBytes.constData( ) );
+    if ( ( leadingBytes.size( ) >= 2 ) && ( bytes[0] == 0x1F ) && ( bytes[1] == 0x8B ) ) {
+        return CompressionFormat::Gzip;
+    }
+    if ( ( leadingBytes.size( ) >= 4 ) && ( bytes[0] == 0x28 ) && ( bytes[1] == 0xB5 ) && ( bytes[2] == 0x2F ) && ( bytes[3] == 0xFD ) ) {
+        return CompressionFormat::Zstd;
+    }
+    return CompressionFormat::None;
+}
+
+CompressionFormat CompressedFileReader::detectFormat( QString const& fileName ) {
+    if ( !isCompressedFileName( fileName ) ) {
+        return CompressionFormat::None;
+    }
+
+    QFile file { fileName };
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return CompressionFormat::None;
+    }
+    return detectFormat( file.read( 4 ) );
+}
+
+bool CompressedFileReader::open( OpenMode mode ) {
+    if ( mode & QIODevice::WriteOnly ) {
+        setErrorString( "CompressedFileReader is read-only" );
+        return false;
+    }
+    if ( !_file.open( QIODevice::ReadOnly ) ) {
+        setErrorString( _file.errorString( ) );
+        return false;
+    }
+
+    // A binary STL's header is free-form and may well start with a magic
+    // number, so only files named as compressed are decompressed
+    _format = isCompressedFileName( _file.fileName( ) ) ? detectFormat( _file.peek( 4 ) ) : CompressionFormat::None;
+    switch ( _format ) {
+        case CompressionFormat::Gzip:
+            _zstream = new z_stream { };
+            // 16 + MAX_WBITS: expect a gzip wrapper rather than a raw zlib stream
+            if ( Z_OK != inflateInit2( _zstream, 16 + MAX_WBITS ) ) {
+                delete _zstream;
+                _zstream = nullptr;
+                setErrorString( "couldn't initialize zlib" );
+                _file.close( );
+                return false;
+            }
+            break;
+
+        case CompressionFormat::Zstd:
+            _zstdStream = ZSTD_createDStream( );
+            if ( !_zstdStream || ZSTD_isError( ZSTD_initDStream( _zstdStream ) ) ) {
+                _destroyStreams( );
+                setErrorString( "couldn't initialize zstd" );
+                _file.close( );
+                return false;
+            }
+            break;
+
+        case CompressionFormat::None:
+            break;
+    }
+
+    _input.resize( InputBufferSize );
+    _inputOffset        = 0;
+    _inputLength        = 0;
+    _compressedConsumed = 0;
+    _inputExhausted     = false;
+    _finished           = false;
+    _betweenFrames      = false;
+    _error              = false;
+
+    return QIODevice::open( mode );
+}
+
+void CompressedFileReader::close( ) {
+    _destroyStreams( );
+    _file.close( );
+    _input.clear( );
+    if ( isOpen( ) ) {
+        QIODevice::close( );
+    }
+}
+
+void CompressedFileReader::_destroyStreams( ) {
+    if ( _zstream ) {
+        inflateEnd( _zstream );
+        delete _zstream;
+        _zstream = nullptr;
+    }
+    if ( _zstdStream ) {
+        ZSTD_freeDStream( _zstdStream );
+        _zstdStream = nullptr;
+    }
+}
+
+bool CompressedFileReader::_refillInput( ) {
+    if ( _inputExhausted ) {
+        return false;
+    }
+
+    auto count = _file.read( _input.data( ), _input.size( ) );
+    if ( count < 0 ) {
+        setErrorString( _file.errorString( ) );
+        _error = true;
+        return false;
+    }
+    if ( count == 0 ) {
+        _inputExhausted = true;
+        return false;
+    }
+
+    _inputOffset         = 0;
+    _inputLength         = static_cast<size_t>( count );
+    _compressedConsumed += count;
+    return true;
+}
+
+qint64 CompressedFileReader::readData( char* data, qint64 maxSize ) {
+    qint64 produced = 0;
+
+    while ( !_error && !_finished && ( produced < maxSize ) ) {
+        if ( ( _inputOffset == _inputLength ) && !_refillInput( ) ) {
+            if ( _error ) {
+                break;
+            }
+            // Running out of input is only legitimate between gzip members or zstd frames.
+            if ( ( _format != CompressionFormat::None ) && !_betweenFrames ) {
+                setErrorString( "compressed file is truncated" );
+                _error = true;
+                break;
+            }
+            _finished = true;
+            break;
+        }
+
+        auto input     = reinterpret_cast<uchar*>( _input.data( ) ) + _inputOffset;
+        auto available = _inputLength - _inputOffset;
+        auto output    = reinterpret_cast<uchar*>( data ) + produced;
+        auto room      = static_cast<size_t>( maxSize - produced );
+
+        switch ( _format ) {
+            case CompressionFormat::None: {
+                auto count = std::min( available, room );
+                memcpy( output, input, count );
+                _inputOffset += count;
+                produced     += count;
+                break;
+            }
+
+            case CompressionFormat::Gzip: {
+                // zlib counts in uInt; clamp so huge reads don't overflow it
+                room = std::min<size_t>( room, std::numeric_limits<uInt>::max( ) );
+                _zstream->next_in   = input;
+                _zstream->avail_in  = static_cast<uInt>( std::min<size_t>( available, std::numeric_limits<uInt>::max( ) ) );
+                _zstream->next_out  = output;
+                _zstream->avail_out = static_cast<uInt>( room );
+
+                auto const consumedBefore = _zstream->avail_in;
+                auto const roomBefore     = _zstream->avail_out;
+                auto rc = inflate( _zstream, Z_NO_FLUSH );
+                _inputOffset += consumedBefore - _zstream->avail_in;
+                produced     += roomBefore     - _zstream->avail_out;
+
+                if ( rc == Z_STREAM_END ) {
+                    // Concatenated gzip members decompress to the concatenation of their contents.
+                    _betweenFrames = true;
+                    inflateReset( _zstream );
+                } else if ( ( rc == Z_OK ) || ( rc == Z_BUF_ERROR ) ) {
+                    _betweenFrames = false;
+                } else {
+                    setErrorString( QString { "zlib error: %1" }.arg( _zstream->msg ? _zstream->msg : "unknown" ) );
+                    _error = true;
+                }
+                break;
+            }
+
+            case CompressionFormat::Zstd: {
+                ZSTD_inBuffer  in  { input,  available, 0 };
+                ZSTD_outBuffer out { output, room,      0 };
+                auto rc = ZSTD_decompressStream( _zstdStream, &out, &in );
+                _inputOffset += in.pos;
+                produced     += out.pos;
+
+                if ( ZSTD_isError( rc ) ) {
+                    setErrorString( QString { "zstd error: %1" }.arg( ZSTD_getErrorName( rc ) ) );
+                    _error = true;
+                } else {
+                    // A return value of zero means a frame has been completely decoded and flushed.
+                    _betweenFrames = ( rc == 0 );
+                }
+                break;
+            }
+        }
+    }
+
+    if ( _error && ( produced == 0 ) ) {
+        return -1;
+    }
+    return produced;
+}
+
+qint64 CompressedFileReader::writeData( char const*, qint64 ) {
+    return -1;
+}
@@ -0,0 +1,76 @@
+#ifndef __COMPRESSEDFILEREADER_H__
+#define __COMPRESSEDFILEREADER_H__
+
+#include <QtCore>
+
+struct z_stream_s;
+struct ZSTD_DCtx_s;
+
+enum class CompressionFormat {
+    None,
+    Gzip,
+    Zstd,
+};
+
+//
+// Sequential, read-only QIODevice that decompresses a gzip- or
+// zstd-compressed file on the fly, so that callers can stream its
+// contents without ever holding the whole uncompressed file.
+//
+
+class CompressedFileReader: public QIODevice {
+
+    Q_OBJECT
+
+public:
+
+    CompressedFileReader( QString const& fileName, QObject* parent = nullptr );
+    virtual ~CompressedFileReader( ) override;
+
+    // Identifies the compression format from the file's magic number. The
+    // overload taking a file name only reports a format for .gz and .zst
+    // files.
+    static CompressionFormat detectFormat( QString const& fileName );
+    static CompressionFormat detectFormat( QByteArray const& leadingBytes );
+
+    static bool isCompressedFileName( QString const& fileName ) {
+        return fileName.endsWith( ".gz", Qt::CaseInsensitive ) || fileName.endsWith( ".zst", Qt::CaseInsensitive );
+    }
+
+    virtual bool   open( OpenMode mode ) override;
+    virtual void   close( ) override;
+    virtual bool   isSequential( ) const override { return true; }
+    virtual bool   atEnd( )        const override { return _finished && ( QIODevice::bytesAvailable( ) == 0 ); }
+
+    CompressionFormat format( )                 const { return _format;              }
+    qint64            compressedSize( )         const { return _file.size( );        }
+    qint64            compressedBytesConsumed( ) const { return _compressedConsumed; }
+    bool              hasError( )               const { return _error;               }
+
+protected:
+
+    virtual qint64 readData( char* data, qint64 maxSize ) override;
+    virtual qint64 writeData( char const* data, qint64 maxSize ) override;
+
+private:
+
+    QFile             _file;
+    CompressionFormat _format             { CompressionFormat::None };
+    QByteArray        _input;
+    size_t            _inputOffset        { };
+    size_t            _inputLength        { };
+    qint64            _compressedConsumed { };
+    bool              _inputExhausted     { };
+    bool              _finished           { };
+    bool              _betweenFrames      { };
+    bool              _error              { };
+
+    z_stream_s*       _zstream            { };
+    ZSTD_DCtx_s*      _zstdStream         { };
+
+    bool _refillInput( );
+    void _destroyStreams( );
+
+};
+
+#endif // __COMPRESSEDFILEREADER_H__
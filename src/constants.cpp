@@ -26,6 +26,8 @@ QSize constexpr           const  ProjectorWindowSize           {   1280,  800 };
 
 #endif // defined DLP4710
 
+QSize                     const  ModelThumbnailSize            {     64,   64 };
+
 int                       const  KeyboardRepeatDelay           { 200        }; //miliseconds
 int                       const  KeyboardRepeatDelayStart      { 600        }; //miliseconds
 int                       const  DefaultBodyLayerThickness     { 100        }; //um
@@ -34,11 +36,11 @@ int                       const  DefaultBaseLayerThickness     { 100        }; /
 
 QString                   const  AptSourcesFilePath            { "/etc/apt/sources.list.d/volumetric-lightfield.list"     };
 QString                   const  JobWorkingDirectoryPath       { "/var/cache/lightfield/print-jobs"                       };
+QString                   const  LayerArchiveFileName          { "layers.lfa"                                             };
 QString                   const  MountmonCommand               { "mountmon"                                               };
 QString                   const  ResetLumenArduinoPortCommand  { "/usr/share/lightfield/libexec/reset-lumen-arduino-port" };
 QString                   const  SetProjectorPowerCommand      { "set-projector-power"                                    };
 QString                   const  ShepherdPath                  { "/usr/share/lightfield/libexec/stdio-shepherd"           };
-QString                   const  SlicedSvgFileName             { "sliced.svg"                                             };
 QString                   const  StlModelLibraryPath           { "/var/lib/lightfield/model-library"                      };
 QString                   const  UpdatesRootPath               { "/var/lib/lightfield/software-updates"                   };
 QString                   const  ManifestFilename              { "manifest.json"                                          };
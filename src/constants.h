@@ -20,13 +20,15 @@ QSize              extern const  ButtonPadding;
 
 QSize              extern const  ProjectorWindowSize;
 
+QSize              extern const  ModelThumbnailSize;
+
 QString            extern const  AptSourcesFilePath;
 QString            extern const  JobWorkingDirectoryPath;
+QString            extern const  LayerArchiveFileName;
 QString            extern const  MountmonCommand;
 QString            extern const  ResetLumenArduinoPortCommand;
 QString            extern const  SetProjectorPowerCommand;
 QString            extern const  ShepherdPath;
-QString            extern const  SlicedSvgFileName;
 QString            extern const  StlModelLibraryPath;
 QString            extern const  UpdatesRootPath;
 QString            extern const  PrintProfilesPath;
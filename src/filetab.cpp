@@ -1,7 +1,5 @@
 #include "pch.h"
 
-#include <sys/sysinfo.h>
-
 #include "filetab.h"
 
 #include "app.h"
@@ -9,10 +7,12 @@
 #include "filecopier.h"
 #include "loader.h"
 #include "mesh.h"
+#include "modellibraryproxymodel.h"
+#include "modelmetadataindex.h"
 #include "printjob.h"
 #include "printmanager.h"
-#include "processrunner.h"
 #include "shepherd.h"
+#include "thumbnailrenderer.h"
 #include "timinglogger.h"
 #include "usbmountmanager.h"
 #include "printprofilemanager.h"
@@ -20,8 +20,6 @@
 
 namespace {
 
-    QRegularExpression VolumeLineMatcher { QString { "^\\s*volume\\s*[:=]\\s*(\\d+(?:\\.(?:\\d+))?)" }, QRegularExpression::CaseInsensitiveOption };
-
     QString ModelFileNameToDelete;
 
     char const* ModelsLocationStrings[] {
@@ -34,6 +32,13 @@ namespace {
         "Directory"
     };
 
+    // Layer thickness for cross-sections, in µm: the one chosen for the
+    // print job if there is one yet, otherwise the default
+    int CrossSectionLayerThickness( ) {
+        int const thickness = printJob.getSelectedBodyLayerThickness( );
+        return ( thickness > 0 ) ? thickness : DefaultBodyLayerThickness;
+    }
+
     char const* ToString( ModelsLocation const value ) {
 #if defined _DEBUG
         if ( ( value >= ModelsLocation::Library ) && ( value <= ModelsLocation::Usb ) ) {
@@ -68,6 +73,8 @@ FileTab::FileTab(QWidget* parent ): InitialShowEventMixin<FileTab, TabBase>(pare
     _libraryFsModel->setNameFilterDisables( false );
     _libraryFsModel->setNameFilters( {
         { "*.stl" },
+        { "*.stl.gz" },
+        { "*.stl.zst" },
 #if defined EXPERIMENTAL
         { "*-20"  },
 #endif
@@ -78,6 +85,10 @@ FileTab::FileTab(QWidget* parent ): InitialShowEventMixin<FileTab, TabBase>(pare
     _libraryFsModel->setRootPath( StlModelLibraryPath );
     QObject::connect( _libraryFsModel, &QFileSystemModel::directoryLoaded, this, &FileTab::libraryFsModel_directoryLoaded );
 
+    _metadataIndex     = new ModelMetadataIndex { this };
+    _thumbnailRenderer = new ThumbnailRenderer { this };
+    _libraryModel      = new ModelLibraryProxyModel { _libraryFsModel, _metadataIndex, _thumbnailRenderer, this };
+
     _toggleLocationButton->setEnabled( false );
     _toggleLocationButton->setFont( font16pt );
     _toggleLocationButton->setText( "Show USB stick" );
@@ -91,7 +102,8 @@ FileTab::FileTab(QWidget* parent ): InitialShowEventMixin<FileTab, TabBase>(pare
     _availableFilesListView->setMovement( QListView::Static );
     _availableFilesListView->setResizeMode( QListView::Fixed );
     _availableFilesListView->setViewMode( QListView::ListMode );
-    _availableFilesListView->setModel( _libraryFsModel );
+    _availableFilesListView->setIconSize( ModelThumbnailSize );
+    _availableFilesListView->setModel( _libraryModel );
     _availableFilesListView->grabGesture( Qt::SwipeGesture );
     QObject::connect( _availableFilesListView, &QListView::clicked, this, &FileTab::availableFilesListView_clicked );
 
@@ -141,7 +153,18 @@ FileTab::FileTab(QWidget* parent ): InitialShowEventMixin<FileTab, TabBase>(pare
     _viewWireframe->setText( "Wireframe" );
     QObject::connect( _viewWireframe, &QRadioButton::toggled, this, &FileTab::viewWireframe_toggled );
 
-    auto viewButtonsLayout = WrapWidgetsInHBox( nullptr, _viewSolid, _viewWireframe );
+    _crossSection->setChecked( false );
+    _crossSection->setEnabled( false );
+    _crossSection->setFont( font16pt );
+    _crossSection->setText( "Cross-section" );
+    QObject::connect( _crossSection, &QCheckBox::toggled, this, &FileTab::crossSection_toggled );
+
+    _layerSlider->setOrientation( Qt::Horizontal );
+    _layerSlider->setEnabled( false );
+    _layerSlider->setPageStep( 10 );
+    QObject::connect( _layerSlider, &QSlider::valueChanged, this, &FileTab::layerSlider_valueChanged );
+
+    auto viewButtonsLayout = WrapWidgetsInHBox( nullptr, _viewSolid, _viewWireframe, _crossSection );
     viewButtonsLayout->setAlignment( Qt::AlignVCenter );
 
     _rightColumn->setContentsMargins( { } );
@@ -150,7 +173,7 @@ FileTab::FileTab(QWidget* parent ): InitialShowEventMixin<FileTab, TabBase>(pare
     _rightColumn->setLayout( WrapWidgetsInVBox(
         viewButtonsLayout,
         _canvas,
-        WrapWidgetsInHBox(nullptr, _deleteButton),
+        WrapWidgetsInHBox( _layerSlider, _deleteButton ),
         WrapWidgetsInHBox( _dimensionsLabel, nullptr, _errorLabel )
     ) );
 
@@ -234,6 +257,8 @@ void FileTab::_createUsbFsModel( ) {
     _usbFsModel->setNameFilterDisables( false );
     _usbFsModel->setNameFilters( {
         { "*.stl" },
+        { "*.stl.gz" },
+        { "*.stl.zst" },
 #if defined EXPERIMENTAL
         { "*-20"  },
 #endif
@@ -243,9 +268,18 @@ void FileTab::_createUsbFsModel( ) {
     } );
     (void) QObject::connect( _usbFsModel, &QFileSystemModel::directoryLoaded, this, &FileTab::usbFsModel_directoryLoaded );
     _usbFsModel->setRootPath( _usbPath );
+
+    // No thumbnails for models on USB sticks, which are too slow to read
+    // through in full just for a picture
+    _usbModel = new ModelLibraryProxyModel { _usbFsModel, _metadataIndex, nullptr, this };
+    _metadataIndex->indexDirectory( _usbPath );
 }
 
 void FileTab::_destroyUsbFsModel( ) {
+    if ( _usbModel ) {
+        _usbModel->deleteLater( );
+        _usbModel = nullptr;
+    }
     if ( _usbFsModel ) {
         QObject::disconnect( _usbFsModel );
         _usbFsModel->deleteLater( );
@@ -259,12 +293,25 @@ void FileTab::_loadModel( QString const& fileName ) {
     _errorLabel->clear( );
     update( );
 
+    // Abandon any load still in progress; it cleans up after itself once
+    // its thread notices it has been cancelled
     if ( _loader ) {
         QObject::disconnect( _loader, nullptr, this, nullptr );
-        _loader->deleteLater( );
+        QObject::connect( _loader, &Loader::finished, _loader, &Loader::deleteLater );
+        _loader->cancel( );
+        if ( _loader->isFinished( ) ) {
+            _loader->deleteLater( );
+        }
     }
     _loader = new Loader( fileName, this );
 
+    // Leave the machine to the model the user is waiting for
+    _thumbnailRenderer->setPaused( true );
+
+    QObject::connect( _loader, &Loader::hashing,            this, &FileTab::loader_hashing          );
+    QObject::connect( _loader, &Loader::reading,            this, &FileTab::loader_reading          );
+    QObject::connect( _loader, &Loader::deduplicating,      this, &FileTab::loader_deduplicating    );
+    QObject::connect( _loader, &Loader::got_preview,        this, &FileTab::loader_gotPreview       );
     QObject::connect( _loader, &Loader::got_mesh,           this, &FileTab::loader_gotMesh          );
     QObject::connect( _loader, &Loader::error_bad_stl,      this, &FileTab::loader_errorBadStl      );
     QObject::connect( _loader, &Loader::error_empty_mesh,   this, &FileTab::loader_errorEmptyMesh   );
@@ -299,6 +346,7 @@ void FileTab::_clearSelection( ) {
     _errorLabel->clear( );
     _viewSolid->setEnabled( false );
     _viewWireframe->setEnabled( false );
+    _crossSection->setEnabled( false );
     _deleteButton->setEnabled( false );
 
     QTimer::singleShot( 1, [this] ( ) { _canvas->clear( ); } );
@@ -313,8 +361,8 @@ void FileTab::_showLibrary( ) {
     _toggleLocationButton->setText( "Show USB stick" );
     _availableFilesLabel->setText( "Models in library:" );
     _availableFilesListView->setEnabled( true );
-    _availableFilesListView->setModel( _libraryFsModel );
-    _availableFilesListView->setRootIndex( _libraryFsModel->index( StlModelLibraryPath ) );
+    _availableFilesListView->setModel( _libraryModel );
+    _availableFilesListView->setRootIndex( _libraryModel->indexForPath( StlModelLibraryPath ) );
     _selectButton->setText( "Select" );
 
     update( );
@@ -329,8 +377,8 @@ void FileTab::_showUsbStick( ) {
     _toggleLocationButton->setText( "Show library" );
     _availableFilesLabel->setText( "Models on USB stick:" );
     _availableFilesListView->setEnabled( true );
-    _availableFilesListView->setModel( _usbFsModel );
-    _availableFilesListView->setRootIndex( _usbFsModel->index( _usbPath ) );
+    _availableFilesListView->setModel( _usbModel );
+    _availableFilesListView->setRootIndex( _usbModel->indexForPath( _usbPath ) );
     _selectButton->setText( "Copy to library" );
 
     update( );
@@ -347,7 +395,7 @@ void FileTab::tab_uiStateChanged( TabIndex const sender, UiState const state )
 
     case UiState::SelectCompleted:
         if (sender == TabIndex::Tiling) {
-            auto index = _libraryFsModel->index( printJob.getLayerDirectory(0) );
+            auto index = _libraryModel->indexForPath( printJob.getLayerDirectory(0) );
             _availableFilesListView->selectionModel()->setCurrentIndex( index, QItemSelectionModel::Select );
         }
         break;
@@ -418,7 +466,43 @@ void FileTab::usbMountManager_filesystemUnmounted( QString const& mountPoint ) {
     update( );
 }
 
+void FileTab::loader_hashing( qint64 const done, qint64 const total ) {
+    _dimensionsLabel->setText( QString { "Reading %1… %2%" }.arg( GetFileBaseName( _modelSelection.fileName ) ).arg( done * 100 / total ) );
+}
+
+void FileTab::loader_reading( qint64 const done, qint64 const total ) {
+    _dimensionsLabel->setText( QString { "Loading %1… %2%" }.arg( GetFileBaseName( _modelSelection.fileName ) ).arg( done * 100 / total ) );
+}
+
+void FileTab::loader_deduplicating( ) {
+    _dimensionsLabel->setText( "Processing " % GetFileBaseName( _modelSelection.fileName ) % "…" );
+}
+
+void FileTab::loader_gotPreview( Mesh* mesh ) {
+    // A cancelled loader's signals can still be queued when it's replaced
+    if ( sender( ) != _loader ) {
+        delete mesh;
+        return;
+    }
+    if ( _modelSelection.fileName.isEmpty( ) || ( _modelSelection.fileName[0] == L':' ) ) {
+        delete mesh;
+        return;
+    }
+
+    debug( "+ FileTab::loader_gotPreview: %zu triangles\n", mesh->triangle_count( ) );
+    if ( _viewSolid->isChecked( ) ) {
+        _canvas->draw_shaded( );
+    } else {
+        _canvas->draw_wireframe( );
+    }
+    _canvas->load_preview( mesh );
+}
+
 void FileTab::loader_gotMesh( Mesh* mesh ) {
+    if ( sender( ) != _loader ) {
+        delete mesh;
+        return;
+    }
     if ( _modelSelection.fileName.isEmpty( ) || ( _modelSelection.fileName[0] == L':' ) ) {
         _dimensionsLabel->clear( );
         _errorLabel->clear( );
@@ -428,17 +512,23 @@ void FileTab::loader_gotMesh( Mesh* mesh ) {
         return;
     }
 
-    _modelSelection.estimatedVolume = 0.0;
-    mesh->bounds( _modelSelection.vertexCount, _modelSelection.x, _modelSelection.y, _modelSelection.z );
+    auto const& statistics = mesh->statistics( );
+    _modelSelection.vertexCount     = statistics.vertex_count;
+    _modelSelection.x               = statistics.x;
+    _modelSelection.y               = statistics.y;
+    _modelSelection.z               = statistics.z;
+    _modelSelection.estimatedVolume = statistics.volume;
 
     debug(
         "+ FileTab::loader_gotMesh:\n"
         "  + count of vertices: %9zu\n"
+        "  + surface area:          %12.3f mm²\n"
         "  + X range:               %12.6f .. %12.6f, %12.6f\n"
         "  + Y range:               %12.6f .. %12.6f, %12.6f\n"
         "  + Z range:               %12.6f .. %12.6f, %12.6f\n"
         "",
         _modelSelection.vertexCount,
+        statistics.surface_area,
         _modelSelection.x.min, _modelSelection.x.max, _modelSelection.x.size,
         _modelSelection.y.min, _modelSelection.y.max, _modelSelection.y.size,
         _modelSelection.z.min, _modelSelection.z.max, _modelSelection.z.size
@@ -458,7 +548,6 @@ void FileTab::loader_gotMesh( Mesh* mesh ) {
         .arg(GroupDigits(QString{"%1"}.arg(_modelSelection.x.size, 0, 'f', 2), ' '))
         .arg(GroupDigits(QString{"%1"}.arg(_modelSelection.y.size, 0, 'f', 2), ' '))
         .arg(GroupDigits(QString{"%1"}.arg(_modelSelection.z.size, 0, 'f', 2), ' '));
-    _dimensionsLabel->setText( _dimensionsText % ", <i>calculating volume…</i>" );
 
     if ( _viewSolid->isChecked( ) ) {
         _canvas->draw_shaded( );
@@ -466,6 +555,7 @@ void FileTab::loader_gotMesh( Mesh* mesh ) {
         _canvas->draw_wireframe( );
     }
     _canvas->load_mesh( mesh );
+    _updateLayerSlider( );
 
     if ( ( _modelSelection.x.size > PrinterMaximumX ) || ( _modelSelection.y.size > PrinterMaximumY ) || ( _modelSelection.z.size > PrinterMaximumZ ) ) {
         _dimensionsLabel->setText( _dimensionsText );
@@ -481,28 +571,10 @@ void FileTab::loader_gotMesh( Mesh* mesh ) {
         update( );
     }
 
-    if ( _processRunner ) {
-        QObject::disconnect( _processRunner, nullptr, this, nullptr );
-        _processRunner->terminate( );
-        _processRunner->deleteLater( );
-        _processRunner = nullptr;
+    if ( !_printManager->isRunning( ) ) {
+        _deleteButton->setEnabled( true );
     }
-
-    _processRunner = new ProcessRunner( this );
-    QObject::connect( _processRunner, &ProcessRunner::succeeded,               this, &FileTab::processRunner_succeeded               );
-    QObject::connect( _processRunner, &ProcessRunner::failed,                  this, &FileTab::processRunner_failed                  );
-    QObject::connect( _processRunner, &ProcessRunner::readyReadStandardOutput, this, &FileTab::processRunner_readyReadStandardOutput );
-    QObject::connect( _processRunner, &ProcessRunner::readyReadStandardError,  this, &FileTab::processRunner_readyReadStandardError  );
-
-    TimingLogger::startTiming( TimingId::VolumeCalculation, GetFileBaseName( _modelSelection.fileName ) );
-
-    _processRunner->start(
-        { "slic3r" },
-        {
-            "--threads", QString { "%1" }.arg( get_nprocs( ) ),
-            "--info",    _modelSelection.fileName,
-        }
-    );
+    _showEstimatedVolume( );
 }
 
 void FileTab::loader_errorBadStl( ) {
@@ -537,10 +609,14 @@ void FileTab::loader_errorMissingFile( ) {
 
 void FileTab::loader_finished( ) {
     debug( "+ FileTab::loader_finished: %s\n", ToString( _canvas->size( ) ).toUtf8( ).data( ) );
+    if ( sender( ) != _loader ) {
+        return;
+    }
+    _thumbnailRenderer->setPaused( false );
 
-    _availableFilesListView->setEnabled( true );
     _viewSolid->setEnabled( true );
     _viewWireframe->setEnabled( true );
+    _crossSection->setEnabled( true );
     update( );
 
     _loader->deleteLater( );
@@ -551,16 +627,17 @@ void FileTab::libraryFsModel_directoryLoaded( QString const& /*name*/ ) {
     debug( "+ FileTab::libraryFsModel_directoryLoaded\n" );
     if ( _modelsLocation == ModelsLocation::Library ) {
         _libraryFsModel->sort( 0, Qt::AscendingOrder );
-        _availableFilesListView->setRootIndex( _libraryFsModel->index( StlModelLibraryPath ) );
+        _availableFilesListView->setRootIndex( _libraryModel->indexForPath( StlModelLibraryPath ) );
         update( );
     }
+    _metadataIndex->indexDirectory( StlModelLibraryPath );
 }
 
 void FileTab::usbFsModel_directoryLoaded( QString const& /*name*/ ) {
     debug( "+ FileTab::usbFsModel_directoryLoaded\n" );
     if ( _modelsLocation == ModelsLocation::Usb ) {
         _usbFsModel->sort( 0, Qt::AscendingOrder );
-        _availableFilesListView->setRootIndex( _usbFsModel->index( _usbPath ) );
+        _availableFilesListView->setRootIndex( _usbModel->indexForPath( _usbPath ) );
         update( );
     }
 }
@@ -571,32 +648,26 @@ void FileTab::availableFilesListView_clicked( QModelIndex const& index ) {
         return;
     }
 
-    _modelSelection = { ( ( _modelsLocation == ModelsLocation::Library ) ? StlModelLibraryPath : _usbPath ) % Slash % index.data( ).toString( ) };
+    _modelSelection = { ( ( _modelsLocation == ModelsLocation::Library ) ? StlModelLibraryPath : _usbPath ) % Slash % index.data( QFileSystemModel::FileNameRole ).toString( ) };
     _modelSelection.type = QFileInfo { _modelSelection.fileName }.isFile( ) ? ModelFileType::File : ModelFileType::Directory;
 
     _selectedRow = indexRow;
 
     if ( _modelSelection.type == ModelFileType::File ) {
-        _availableFilesListView->setEnabled( false );
         _viewSolid->setEnabled( false );
         _viewWireframe->setEnabled( false );
+        _crossSection->setEnabled( false );
         _selectButton->setEnabled( false );
         _deleteButton->setEnabled( false );
         update( );
 
-        if ( _processRunner ) {
-            QObject::disconnect( _processRunner, nullptr, this, nullptr );
-            _processRunner->terminate( );
-            _processRunner->deleteLater( );
-            _processRunner = nullptr;
-        }
-
         _loadModel( _modelSelection.fileName );
     } else {
         _dimensionsLabel->clear( );
         _errorLabel->clear( );
         _viewSolid->setEnabled( false );
         _viewWireframe->setEnabled( false );
+        _crossSection->setEnabled( false );
 
         if (!_printManager->isRunning()) {
             _selectButton->setEnabled(true);
@@ -712,7 +783,7 @@ void FileTab::selectButton_clicked(bool)
                 if ( copiedFiles == 1 ) {
                     _showLibrary( );
 
-                    auto index = _libraryFsModel->index( fileNamePair.second );
+                    auto index = _libraryModel->indexForPath( fileNamePair.second );
                     _availableFilesListView->selectionModel( )->select( index, QItemSelectionModel::ClearAndSelect );
                     availableFilesListView_clicked( index );
                 } else {
@@ -751,7 +822,7 @@ void FileTab::selectButton_clicked(bool)
                 _selectButton->setEnabled(true);
                 _showLibrary( );
 
-                auto index = _libraryFsModel->index( _modelSelection.fileName );
+                auto index = _libraryModel->indexForPath( _modelSelection.fileName );
                 _availableFilesListView->selectionModel( )->select( index, QItemSelectionModel::ClearAndSelect );
                 availableFilesListView_clicked( index );
 
@@ -780,6 +851,42 @@ void FileTab::viewWireframe_toggled( bool checked ) {
     }
 }
 
+void FileTab::crossSection_toggled( bool checked ) {
+    debug( "+ FileTab::crossSection_toggled: %s\n", ToString( checked ) );
+    _layerSlider->setEnabled( checked );
+    _updateLayerSlider( );
+}
+
+void FileTab::layerSlider_valueChanged( int /*value*/ ) {
+    _updateCrossSection( );
+}
+
+void FileTab::_updateLayerSlider( ) {
+    // Layers are cut through their middles, as the slicer does
+    int const thickness  = CrossSectionLayerThickness( );
+    int const layerCount = std::max( 1, static_cast<int>( std::ceil( _modelSelection.z.size * 1000.0 / thickness ) ) );
+    if ( _layerSlider->maximum( ) != layerCount - 1 ) {
+        QSignalBlocker blocker { _layerSlider };
+        _layerSlider->setRange( 0, layerCount - 1 );
+        _layerSlider->setValue( layerCount / 2 );
+    }
+    _updateCrossSection( );
+}
+
+void FileTab::_updateCrossSection( ) {
+    if ( !_crossSection->isChecked( ) ) {
+        _canvas->clear_cross_section( );
+        _canvas->clear_status( );
+        return;
+    }
+
+    int    const thickness = CrossSectionLayerThickness( );
+    int    const layer     = _layerSlider->value( );
+    double const z         = _modelSelection.z.min + ( layer + 0.5 ) * thickness / 1000.0;
+    _canvas->set_cross_section( static_cast<float>( z ) );
+    _canvas->set_status( QString { "Layer %1 of %2, %3 mm" }.arg( layer + 1 ).arg( _layerSlider->maximum( ) + 1 ).arg( z - _modelSelection.z.min, 0, 'f', 2 ) );
+}
+
 void FileTab::deleteButton_clicked( bool ) {
     debug( "+ FileTab::deleteButton_clicked: file name is '%s'\n", _modelSelection.fileName.toUtf8( ).data( ) );
 
@@ -800,60 +907,22 @@ void FileTab::deleteButton_clicked( bool ) {
     }
 }
 
-void FileTab::processRunner_succeeded( ) {
-    TimingLogger::stopTiming( TimingId::VolumeCalculation );
-    debug( "+ FileTab::processRunner_succeeded\n" );
-    if (!_printManager->isRunning())
-        _deleteButton->setEnabled(true);
-
-    for ( auto line : _slicerBuffer.split( NewLineRegex ) ) {
-        if ( auto match = VolumeLineMatcher.match( line ); match.hasMatch( ) ) {
-            bool ok = false;
-            _modelSelection.estimatedVolume = match.captured( 1 ).toDouble( &ok );
-            if ( !ok ) {
-                debug( "  + couldn't parse '%s' as a number\n", match.captured( 1 ).toUtf8( ).data( ) );
-                break;
-            }
-
-            QString unit;
-            double estimatedVolume = _modelSelection.estimatedVolume;
-
-            debug( "  + Estimated volume of model: %.3f µL\n", estimatedVolume );
-            if ( estimatedVolume < 1000.0 ) {
-                unit = "µL";
-            } else {
-                estimatedVolume /= 1000.0;
-                unit = "mL";
-            }
-            _dimensionsLabel->setText( _dimensionsText % Comma % Space % GroupDigits( QString { "%1" }.arg( estimatedVolume, 0, 'f', 2 ), ' ' ) % Space % unit );
-            if (!_printManager->isRunning())
-                _selectButton->setEnabled(true);
+void FileTab::_showEstimatedVolume( ) {
+    QString unit;
+    double estimatedVolume = _modelSelection.estimatedVolume;
 
-            update( );
-            break;
-        }
+    debug( "  + Estimated volume of model: %.3f µL\n", estimatedVolume );
+    if ( estimatedVolume < 1000.0 ) {
+        unit = "µL";
+    } else {
+        estimatedVolume /= 1000.0;
+        unit = "mL";
     }
-
-    _slicerBuffer.clear( );
-}
-
-void FileTab::processRunner_failed( int const exitCode, QProcess::ProcessError const error ) {
-    TimingLogger::stopTiming( TimingId::VolumeCalculation );
-    debug( "+ FileTab::processRunner_failed: exit code: %d, error %s [%d]\n", exitCode, ToString( error ), error );
+    _dimensionsLabel->setText( _dimensionsText % Comma % Space % GroupDigits( QString { "%1" }.arg( estimatedVolume, 0, 'f', 2 ), ' ' ) % Space % unit );
     if (!_printManager->isRunning())
-        _deleteButton->setEnabled(true);
+        _selectButton->setEnabled(true);
 
-    _slicerBuffer.clear( );
-    emit uiStateChanged( TabIndex::File, UiState::SelectStarted );
-}
-
-void FileTab::processRunner_readyReadStandardOutput( QString const& data ) {
-    _slicerBuffer += data;
-}
-
-void FileTab::processRunner_readyReadStandardError( QString const& data ) {
-    auto tmp = data.toUtf8( );
-    fwrite( tmp.data( ), 1, tmp.count( ), stderr );
+    update( );
 }
 
 void FileTab::printJobChanged() {
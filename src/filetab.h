@@ -10,7 +10,9 @@
 class Canvas;
 class Loader;
 class Mesh;
-class ProcessRunner;
+class ModelLibraryProxyModel;
+class ModelMetadataIndex;
+class ThumbnailRenderer;
 
 enum class ModelsLocation {
     Library,
@@ -80,28 +82,35 @@ private:
     QLabel*             _errorLabel              { new QLabel              };
     QRadioButton*       _viewSolid               { new QRadioButton        };
     QRadioButton*       _viewWireframe           { new QRadioButton        };
+    QCheckBox*          _crossSection            { new QCheckBox           };
+    QSlider*            _layerSlider             { new QSlider             };
     QWidget*            _rightColumn             { new QWidget             };
 
     QPushButton*        _deleteButton            {                         };
 
-    QFileSystemModel*   _libraryFsModel          { new QFileSystemModel    };
-    QFileSystemModel*   _usbFsModel              {                         };
-    Loader*             _loader                  {                         };
+    QFileSystemModel*       _libraryFsModel      { new QFileSystemModel    };
+    ModelLibraryProxyModel* _libraryModel        {                         };
+    ModelMetadataIndex*     _metadataIndex       {                         };
+    ThumbnailRenderer*      _thumbnailRenderer   {                         };
+    QFileSystemModel*       _usbFsModel          {                         };
+    ModelLibraryProxyModel* _usbModel            {                         };
+    Loader*                 _loader              {                         };
 
     QString             _dimensionsText;
     int                 _selectedRow             { -1                      };
-    QString             _slicerBuffer;
     ModelSelectionInfo  _modelSelection;
     QString             _usbPath;
 
     ModelsLocation      _modelsLocation          { ModelsLocation::Library };
     QPointF             _swipeLastPoint          {                         };
-    ProcessRunner*      _processRunner           {                         };
 
     void _createUsbFsModel( );
     void _destroyUsbFsModel( );
 
     void _loadModel( QString const& filename );
+    void _showEstimatedVolume( );
+    void _updateLayerSlider( );
+    void _updateCrossSection( );
 
     void _deleteModel( );
     void _clearSelection( );
@@ -125,6 +134,10 @@ private slots:
     void usbMountManager_filesystemRemounted( bool const succeeded, bool const writable );
     void usbMountManager_filesystemUnmounted( QString const& mountPoint );
 
+    void loader_hashing( qint64 const done, qint64 const total );
+    void loader_reading( qint64 const done, qint64 const total );
+    void loader_deduplicating( );
+    void loader_gotPreview( Mesh* m );
     void loader_gotMesh( Mesh* m );
     void loader_errorBadStl( );
     void loader_errorEmptyMesh( );
@@ -142,14 +155,11 @@ private slots:
 
     void viewSolid_toggled( bool checked );
     void viewWireframe_toggled( bool checked );
+    void crossSection_toggled( bool checked );
+    void layerSlider_valueChanged( int value );
 
     void deleteButton_clicked( bool );
 
-    void processRunner_succeeded( );
-    void processRunner_failed( int const exitCode, QProcess::ProcessError const error );
-    void processRunner_readyReadStandardOutput ( QString const& data );
-    void processRunner_readyReadStandardError( QString const& data );
-
     void printManager_printStarting();
     void printManager_printComplete(bool const success);
     void printManager_printAborted();
@@ -1,11 +1,103 @@
+#include <cmath>
+#include <vector>
+
 #include "glmesh.h"
 #include "mesh.h"
 
+// Largest number of vertices one chunk's 16-bit indices can address
+static const size_t ChunkVertexLimit = 65536;
+
+// Components stored per position: x, y, z and a pad, giving an 8-byte
+// stride, so that each vertex (and so each chunk's first vertex) starts on
+// a 4-byte boundary
+static const size_t VertexComponents = 4;
+
 GLMesh::GLMesh(const Mesh* const mesh)
-    : vertices(QOpenGLBuffer::VertexBuffer), indices(QOpenGLBuffer::IndexBuffer)
+    : vertices(QOpenGLBuffer::VertexBuffer), indices(QOpenGLBuffer::IndexBuffer),
+      triangles(mesh->triangle_count())
 {
     initializeOpenGLFunctions();
 
+    // Quantize each axis over the mesh's bounds; the shader maps the
+    // normalized values back with offset + scale * q.
+    for (int axis=0; axis < 3; ++axis)
+    {
+        offset[axis] = mesh->min(axis);
+        scale[axis] = mesh->max(axis) - mesh->min(axis);
+    }
+
+    const GLfloat* const source = mesh->vertex_data();
+    const GLuint* const source_indices = mesh->index_data();
+    const size_t vertex_count = mesh->count() / 3;
+    const size_t index_count = mesh->index_count();
+
+    std::vector<GLushort> quantized;
+    std::vector<GLushort> chunk_indices(index_count);
+    auto add_vertex = [&](GLuint v)
+    {
+        for (int axis=0; axis < 3; ++axis)
+        {
+            const float t = scale[axis] > 0 ? (source[v * 3 + axis] - offset[axis]) / scale[axis] : 0;
+            quantized.push_back(GLushort(std::lround(std::min(std::max(t, 0.0f), 1.0f) * 65535)));
+        }
+        quantized.push_back(0);
+    };
+
+    if (vertex_count <= ChunkVertexLimit)
+    {
+        // Everything fits in one chunk, in the mesh's own vertex order
+        quantized.reserve(vertex_count * VertexComponents);
+        for (GLuint v=0; v < vertex_count; ++v)
+        {
+            add_vertex(v);
+        }
+        std::copy(source_indices, source_indices + index_count, chunk_indices.begin());
+        chunks.push_back({ 0, 0, GLuint(index_count) });
+    }
+    else
+    {
+        // Take triangles in order, giving each chunk its own copy of the
+        // vertices it uses, until another triangle would overflow it.
+        // Neighbouring triangles mostly share vertices, so few are copied
+        // into more than one chunk.
+        quantized.reserve((vertex_count + vertex_count / 8) * VertexComponents);
+        std::vector<GLuint> local(vertex_count, GLuint(-1));
+        std::vector<GLuint> used;
+        used.reserve(ChunkVertexLimit);
+        Chunk chunk { 0, 0, 0 };
+
+        for (size_t i=0; i < index_count; i += 3)
+        {
+            const size_t needed = (local[source_indices[i]] == GLuint(-1)) +
+                                  (local[source_indices[i + 1]] == GLuint(-1)) +
+                                  (local[source_indices[i + 2]] == GLuint(-1));
+            if (used.size() + needed > ChunkVertexLimit)
+            {
+                chunks.push_back(chunk);
+                chunk = { GLuint(quantized.size() / VertexComponents), GLuint(i), 0 };
+                for (auto v : used)
+                {
+                    local[v] = GLuint(-1);
+                }
+                used.clear();
+            }
+
+            for (size_t corner=i; corner < i + 3; ++corner)
+            {
+                const GLuint v = source_indices[corner];
+                if (local[v] == GLuint(-1))
+                {
+                    local[v] = GLuint(used.size());
+                    used.push_back(v);
+                    add_vertex(v);
+                }
+                chunk_indices[corner] = GLushort(local[v]);
+            }
+            chunk.index_count += 3;
+        }
+        chunks.push_back(chunk);
+    }
+
     vertices.create();
     indices.create();
 
@@ -13,24 +105,33 @@ GLMesh::GLMesh(const Mesh* const mesh)
     indices.setUsagePattern(QOpenGLBuffer::StaticDraw);
 
     vertices.bind();
-    vertices.allocate(mesh->vertices.data(),
-                      mesh->vertices.size() * sizeof(float));
+    vertices.allocate(quantized.data(),
+                      int(quantized.size() * sizeof(GLushort)));
     vertices.release();
 
     indices.bind();
-    indices.allocate(mesh->indices.data(),
-                     mesh->indices.size() * sizeof(uint32_t));
+    indices.allocate(chunk_indices.data(),
+                     int(chunk_indices.size() * sizeof(GLushort)));
     indices.release();
 }
 
-void GLMesh::draw(GLuint vp)
+void GLMesh::draw(QOpenGLShaderProgram& shader, GLuint vp)
 {
+    glUniform3fv(shader.uniformLocation("vertex_offset"), 1, offset);
+    glUniform3fv(shader.uniformLocation("vertex_scale"), 1, scale);
+
     vertices.bind();
     indices.bind();
 
-    glVertexAttribPointer(vp, 3, GL_FLOAT, false, 3*sizeof(float), NULL);
-    glDrawElements(GL_TRIANGLES, indices.size() / sizeof(uint32_t),
-                   GL_UNSIGNED_INT, NULL);
+    // OpenGL 2.1 has no base-vertex draw call, so each chunk moves the
+    // attribute pointer to the start of its own vertices instead
+    for (auto const& chunk : chunks)
+    {
+        glVertexAttribPointer(vp, 3, GL_UNSIGNED_SHORT, GL_TRUE, VertexComponents*sizeof(GLushort),
+                              reinterpret_cast<const void*>(size_t(chunk.first_vertex) * VertexComponents * sizeof(GLushort)));
+        glDrawElements(GL_TRIANGLES, chunk.index_count, GL_UNSIGNED_SHORT,
+                       reinterpret_cast<const void*>(size_t(chunk.first_index) * sizeof(GLushort)));
+    }
 
     vertices.release();
     indices.release();
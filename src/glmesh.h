@@ -3,18 +3,42 @@
 
 #include <QOpenGLBuffer>
 #include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
 
 // forward declaration
 class Mesh;
 
+/*
+ *  A mesh uploaded to the GPU in a compact form: positions are quantized
+ *  to 16 bits per axis over the mesh's bounding box and padded to an
+ *  8-byte stride, and indices are 16 bits.  Meshes with more vertices than
+ *  a 16-bit index can reach are split into chunks, each with its own run
+ *  of vertices.
+ */
 class GLMesh : protected QOpenGLFunctions
 {
 public:
     GLMesh(const Mesh* const mesh);
-    void draw(GLuint vp);
+
+    /*  Sets the shader's dequantization uniforms and draws the mesh,
+     *  feeding positions to attribute vp */
+    void draw(QOpenGLShaderProgram& shader, GLuint vp);
+    size_t triangle_count() const { return triangles; }
 private:
+    struct Chunk
+    {
+        GLuint first_vertex;
+        GLuint first_index;
+        GLuint index_count;
+    };
+
     QOpenGLBuffer vertices;
     QOpenGLBuffer indices;
+    std::vector<Chunk> chunks;
+    size_t triangles;
+
+    GLfloat offset[3];
+    GLfloat scale[3];
 };
 
 #endif // GLMESH_H
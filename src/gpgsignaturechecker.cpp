@@ -64,10 +64,8 @@ void GpgSignatureChecker::startCheckDetachedSignature( QString const& dataFileNa
     );
 }
 
-void GpgSignatureChecker::gpg_succeeded( ) {
-    debug( "+ GpgSignatureChecker::gpg_succeeded: examining GPG output for file '%s'\n", _dataFileName.toUtf8( ).data( ) );
-
-    auto lines = _stdout.replace( EndsWithWhitespaceRegex, "" ).split( NewLineRegex );
+bool GpgSignatureChecker::checkStatusOutput( QString output ) {
+    auto lines = output.replace( EndsWithWhitespaceRegex, "" ).split( NewLineRegex );
     debug( "  + Output from GPG:\n" );
     for ( int limit = lines.count( ), index = 0; index < limit; ++index ) {
         debug( "    + line %d: %s\n", index + 1, lines[index].toUtf8( ).data( ) );
@@ -79,6 +77,9 @@ void GpgSignatureChecker::gpg_succeeded( ) {
     auto lineIndex = 0;
     for ( auto line : lines ) {
         auto fields = line.split( SingleWhitespaceCharacterRegex );
+        if ( fields.count( ) < 2 ) {
+            continue;
+        }
         auto& token = fields[1];
         ++lineIndex;
 
@@ -87,8 +88,7 @@ void GpgSignatureChecker::gpg_succeeded( ) {
         if ( token == "NEWSIG" ) {
             if ( ( fields.count( ) > 2 ) && ( fields[2] != ExpectedSignerAddress ) ) {
                 debug( "  + 'NEWSIG': invalid signer address: '%s'\n", fields[2].toUtf8( ).data( ) );
-                emit signatureCheckComplete( false );
-                return;
+                return false;
             }
         } else if ( token == "SIG_ID" ) {
             if ( fields.count( ) >= 5 ) {
@@ -97,22 +97,19 @@ void GpgSignatureChecker::gpg_succeeded( ) {
         } else if ( token == "GOODSIG" ) {
             if ( fields.count( ) < 3 ) {
                 debug( "  + 'GOODSIG': invalid input\n" );
-                emit signatureCheckComplete( false );
-                return;
+                return false;
             }
 
             if ( auto index = ExpectedFingerprints.indexOf( fields[2] ); -1 == index ) {
                 debug( "  + 'GOODSIG': invalid key fingerprint: '%s'\n", fields[2].toUtf8( ).data( ) );
-                emit signatureCheckComplete( false );
-                return;
+                return false;
             } else {
                 if ( -1 == fingerprintIndex ) {
                     debug( "  + 'GOODSIG': setting fingerprint index to %d\n", index );
                     fingerprintIndex = index;
                 } else if ( fingerprintIndex != index ) {
                     debug( "  + 'GOODSIG': existing fingerprint index %d doesn't match new fingerprint index %d\n", fingerprintIndex, index );
-                    emit signatureCheckComplete( false );
-                    return;
+                    return false;
                 }
             }
 
@@ -122,46 +119,58 @@ void GpgSignatureChecker::gpg_succeeded( ) {
             auto signerName = fields.join( Space );
             if ( signerName != ExpectedSignerName ) {
                 debug( "  + 'GOODSIG': invalid signer name: got '%s'\n", signerName.toUtf8( ).data( ) );
-                emit signatureCheckComplete( false );
-                return;
+                return false;
             }
         } else if ( token == "VALIDSIG" ) {
             if ( fields.count( ) < 12 ) {
                 debug( "  + 'VALIDSIG': invalid input\n" );
-                emit signatureCheckComplete( false );
-                return;
+                return false;
             }
 
             if ( auto index = ExpectedKeyIds.indexOf( fields[2] ); -1 == index ) {
                 debug( "  + 'VALIDSIG': unknown key ID: '%s'\n", fields[2].toUtf8( ).data( ) );
-                emit signatureCheckComplete( false );
-                return;
+                return false;
             } else {
                 if ( -1 == keyIdIndex ) {
                     debug( "  + 'VALIDSIG': setting key index to %d\n", index );
                     keyIdIndex = index;
                 } else if ( keyIdIndex != index ) {
                     debug( "  + 'VALIDSIG': existing key index %d doesn't match new key index %d\n", keyIdIndex, index );
-                    emit signatureCheckComplete( false );
-                    return;
+                    return false;
                 }
             }
             if ( fields[2] != fields[11] ) {
                 debug( "  + 'VALIDSIG': first and second key IDs don't match: '%s' vs '%'\n", fields[2].toUtf8( ).data( ), fields[11].toUtf8( ).data( ) );
-                emit signatureCheckComplete( false );
-                return;
+                return false;
             }
         }
     }
     debug( "  + key index: %d; fingerprint index: %d\n", keyIdIndex, fingerprintIndex );
     if ( ( -1 == keyIdIndex ) || ( -1 == fingerprintIndex ) || ( keyIdIndex != fingerprintIndex ) ) {
         debug( "    + key index or fingerprint index is bad\n" );
-        emit signatureCheckComplete( false );
-        return;
+        return false;
     }
 
     debug( "  + signature is good\n" );
-    emit signatureCheckComplete( true );
+    return true;
+}
+
+bool GpgSignatureChecker::checkDetachedSignature( QString const& dataFileName, QString const& signatureFileName ) {
+    QProcess gpg;
+    gpg.start( "gpg", { "--status-fd", "1", "--verify", signatureFileName, dataFileName } );
+    if ( !gpg.waitForFinished( -1 ) || ( gpg.exitStatus( ) != QProcess::NormalExit ) || ( gpg.exitCode( ) != 0 ) ) {
+        debug( "+ GpgSignatureChecker::checkDetachedSignature: gpg failed for file '%s': exit code %d, error %s\n", dataFileName.toUtf8( ).data( ), gpg.exitCode( ), ToString( gpg.error( ) ) );
+        debug( "  + stderr:\n%s", gpg.readAllStandardError( ).data( ) );
+        return false;
+    }
+
+    debug( "+ GpgSignatureChecker::checkDetachedSignature: examining GPG output for file '%s'\n", dataFileName.toUtf8( ).data( ) );
+    return checkStatusOutput( QString::fromUtf8( gpg.readAllStandardOutput( ) ) );
+}
+
+void GpgSignatureChecker::gpg_succeeded( ) {
+    debug( "+ GpgSignatureChecker::gpg_succeeded: examining GPG output for file '%s'\n", _dataFileName.toUtf8( ).data( ) );
+    emit signatureCheckComplete( checkStatusOutput( _stdout ) );
 }
 
 void GpgSignatureChecker::gpg_failed( int const exitCode, QProcess::ProcessError const error ) {
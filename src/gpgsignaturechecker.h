@@ -14,6 +14,14 @@ public:
 
     void startCheckDetachedSignature( QString const& dataFileName, QString const& signatureFileName );
 
+    // Checks the signature on the calling thread, waiting for gpg to finish;
+    // for worker threads, which have no event loop.
+    static bool checkDetachedSignature( QString const& dataFileName, QString const& signatureFileName );
+
+    // Checks the output of `gpg --status-fd 1 --verify` for a good signature
+    // by one of our packaging keys.
+    static bool checkStatusOutput( QString output );
+
     int instanceId( ) const;
     QProcess::ProcessState state( ) const;
 
@@ -2,17 +2,27 @@
 
 #include "hasher.h"
 
-void Hasher::_hash( QString const fileName, QCryptographicHash::Algorithm const algorithm ) {
+#include "modelfingerprint.h"
+
+QString Hasher::hashFile( QString const& fileName, QCryptographicHash::Algorithm const algorithm ) {
     QFile file { fileName };
-    if ( file.open( QIODevice::ReadOnly ) ) {
-        QCryptographicHash hasher { algorithm };
-        hasher.addData( &file );
-        file.close( );
-        emit resultReady( { hasher.result( ).toHex( ) } );
-    } else {
-        debug( "+ Hasher::_hash: couldn't open file '%s'\n", fileName.toUtf8( ).data( ) );
-        emit resultReady( { } );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        debug( "+ Hasher::hashFile: couldn't open file '%s'\n", fileName.toUtf8( ).data( ) );
+        return { };
     }
+
+    QCryptographicHash hasher { algorithm };
+    hasher.addData( &file );
+    file.close( );
+    return hasher.result( ).toHex( );
+}
+
+void Hasher::_hash( QString const fileName, QCryptographicHash::Algorithm const algorithm ) {
+    emit resultReady( hashFile( fileName, algorithm ) );
+}
+
+void Hasher::_fingerprint( QString const fileName ) {
+    emit resultReady( ModelFingerprint::fingerprint( fileName ) );
 }
 
 void Hasher::_checkHashes( QMap<QString, QString> const fileNames, QCryptographicHash::Algorithm const algorithm ) {
@@ -29,10 +39,12 @@ void Hasher::_checkHashes( QMap<QString, QString> const fileNames, QCryptographi
             if ( result != fileNames[fileName] ) {
                 debug( "+ Hasher::_checkHashes: hash mismatch! %s vs %s\n", fileNames[fileName].toUtf8( ).data( ), result.toUtf8( ).data( ) );
                 emit hashCheckResult( false );
+                return;
             }
         } else {
             debug( "+ Hasher::_checkHashes: couldn't open file '%s'\n", fileName.toUtf8( ).data( ) );
             emit hashCheckResult( false );
+            return;
         }
     }
     emit hashCheckResult( true );
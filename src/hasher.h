@@ -29,12 +29,23 @@ public:
         _thread->start( );
     }
 
+    // Reports the model's fingerprint (see ModelFingerprint) through
+    // resultReady.
+    void fingerprint( QString const fileName ) {
+        _thread = QThread::create( std::bind( &Hasher::_fingerprint, this, fileName ) );
+        QObject::connect( _thread, &QThread::finished, _thread, &QThread::deleteLater );
+        _thread->start( );
+    }
+
     void checkHashes( QMap<QString, QString> const fileNames, QCryptographicHash::Algorithm const algorithm ) {
         _thread = QThread::create( std::bind( &Hasher::_checkHashes, this, fileNames, algorithm ) );
         QObject::connect( _thread, &QThread::finished, _thread, &QThread::deleteLater );
         _thread->start( );
     }
 
+    // Hashes a file on the calling thread. Returns an empty string if the file can't be read.
+    static QString hashFile( QString const& fileName, QCryptographicHash::Algorithm const algorithm );
+
 protected:
 
 private:
@@ -42,6 +53,7 @@ private:
     QThread* _thread;
 
     void _hash( QString const fileName, QCryptographicHash::Algorithm const algorithm );
+    void _fingerprint( QString const fileName );
     void _checkHashes( QMap<QString, QString> const fileNames, QCryptographicHash::Algorithm const algorithm );
 
 signals:
@@ -0,0 +1,469 @@
+#include "pch.h"
+
+#include <memory>
+
+#include "layerarchive.h"
+
+namespace {
+
+    char     const LayerArchiveMagic[8] { 'L', 'F', 'L', 'A', 'Y', 'E', 'R', 'S' };
+    uint32_t const LayerArchiveVersion  { 2 };
+
+    // The record's data is the name of another layer with the same image
+    uint32_t const LayerRecordIsAlias   { 1 };
+
+    // Limits how far aliases are followed, in case of a loop
+    int      const MaximumAliasHops     { 8 };
+
+    // A print and the preview rarely look at more than two directories
+    int      const MaximumOpenArchives  { 4 };
+
+    struct LayerArchiveHeader {
+        char     magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        // Tells a reader that the archive it has mapped has been replaced
+        uint64_t serial;
+    };
+
+    struct LayerRecordHeader {
+        uint32_t nameLength;
+        uint32_t dataSize;
+        uint32_t width;
+        uint32_t height;
+        uint32_t left;
+        uint32_t top;
+        uint32_t boxWidth;
+        uint32_t boxHeight;
+        uint32_t flags;
+    };
+
+    // PackBits: a count byte n from 0 to 127 is followed by n + 1 literal
+    // bytes, and one from -1 to -127 by a single byte to repeat 1 - n times.
+    void packRow( uchar const* row, int const count, QByteArray& out ) {
+        int n = 0;
+        while ( n < count ) {
+            int run = 1;
+            while ( ( n + run < count ) && ( run < 128 ) && ( row[n + run] == row[n] ) ) {
+                ++run;
+            }
+            if ( run >= 3 ) {
+                out.append( static_cast<char>( 1 - run ) );
+                out.append( static_cast<char>( row[n] ) );
+                n += run;
+                continue;
+            }
+
+            // Literals go on until the next run of three or more
+            int literals = 0;
+            while ( ( n + literals < count ) && ( literals < 128 ) ) {
+                uchar const* p = row + n + literals;
+                if ( ( n + literals + 2 < count ) && ( p[0] == p[1] ) && ( p[0] == p[2] ) ) {
+                    break;
+                }
+                ++literals;
+            }
+            out.append( static_cast<char>( literals - 1 ) );
+            out.append( reinterpret_cast<char const*>( row + n ), literals );
+            n += literals;
+        }
+    }
+
+    QByteArray recordBytes( LayerRecordHeader const& record, QByteArray const& nameBytes, QByteArray const& data ) {
+        QByteArray bytes;
+        bytes.reserve( static_cast<int>( sizeof( record ) ) + nameBytes.size( ) + data.size( ) );
+        bytes.append( reinterpret_cast<char const*>( &record ), sizeof( record ) );
+        bytes.append( nameBytes );
+        bytes.append( data );
+        return bytes;
+    }
+
+    bool unpackRow( uchar const* data, size_t const size, size_t& in, uchar* row, size_t const count ) {
+        size_t out = 0;
+        while ( out < count ) {
+            if ( in >= size ) {
+                return false;
+            }
+
+            int const n = static_cast<signed char>( data[in++] );
+            if ( n >= 0 ) {
+                size_t const literals = static_cast<size_t>( n ) + 1;
+                if ( ( in + literals > size ) || ( out + literals > count ) ) {
+                    return false;
+                }
+                memcpy( row + out, data + in, literals );
+                in  += literals;
+                out += literals;
+            } else if ( n != -128 ) {
+                size_t const run = static_cast<size_t>( 1 - n );
+                if ( ( in >= size ) || ( out + run > count ) ) {
+                    return false;
+                }
+                memset( row + out, data[in++], run );
+                out += run;
+            }
+        }
+        return true;
+    }
+
+    class LayerArchiveReader {
+
+    public:
+
+        LayerArchiveReader( QString const& fileName ): _fileName { fileName } {
+            /*empty*/
+        }
+
+        // Maps what has been written so far and indexes any new records.
+        // The path is opened afresh every time: the archive may have been
+        // replaced since the last call, even by a file that got the old
+        // one's inode, so the file this reader has open can't be trusted to
+        // still be the archive. An archive is known by its device, inode
+        // and header serial together.
+        bool update( ) {
+            std::unique_ptr<QFile> file { new QFile { _fileName } };
+            struct stat info;
+            if ( !file->open( QIODevice::ReadOnly ) || ( ::fstat( file->handle( ), &info ) != 0 ) ) {
+                return false;
+            }
+            qint64 const size = info.st_size;
+            if ( size < static_cast<qint64>( sizeof( LayerArchiveHeader ) ) ) {
+                // Just created; the header isn't there yet
+                _reset( );
+                return true;
+            }
+
+            LayerArchiveHeader header;
+            if ( file->read( reinterpret_cast<char*>( &header ), sizeof( header ) ) != static_cast<qint64>( sizeof( header ) ) ) {
+                return false;
+            }
+            if ( memcmp( header.magic, LayerArchiveMagic, sizeof( LayerArchiveMagic ) ) || ( header.version != LayerArchiveVersion ) ) {
+                return false;
+            }
+
+            bool const sameArchive = _data && ( info.st_dev == _device ) && ( info.st_ino == _inode ) && ( header.serial == _serial ) && ( size >= _mappedSize );
+            if ( sameArchive && ( size == _mappedSize ) ) {
+                return true;
+            }
+
+            uchar* data = file->map( 0, size );
+            if ( !data ) {
+                return false;
+            }
+            if ( !sameArchive ) {
+                _reset( );
+                _device  = info.st_dev;
+                _inode   = info.st_ino;
+                _serial  = header.serial;
+                _scanned = sizeof( header );
+            }
+            // Letting go of the old file unmaps what it had mapped
+            _file       = std::move( file );
+            _data       = data;
+            _mappedSize = size;
+
+            while ( _scanned + static_cast<qint64>( sizeof( LayerRecordHeader ) ) <= size ) {
+                LayerRecordHeader record;
+                memcpy( &record, _data + _scanned, sizeof( record ) );
+
+                qint64 const end = _scanned + static_cast<qint64>( sizeof( record ) ) + record.nameLength + record.dataSize;
+                if ( end > size ) {
+                    // Still being written
+                    break;
+                }
+
+                char const* name = reinterpret_cast<char const*>( _data + _scanned + sizeof( record ) );
+                QString const layerName { QString::fromUtf8( name, record.nameLength ) };
+                if ( record.flags & LayerRecordIsAlias ) {
+                    _aliases.insert( layerName, QString::fromUtf8( name + record.nameLength, record.dataSize ) );
+                    _records.remove( layerName );
+                } else {
+                    _records.insert( layerName, _scanned );
+                    _aliases.remove( layerName );
+                }
+                _scanned = end;
+            }
+            return true;
+        }
+
+        // Follows aliases to the layer whose image is stored. Returns an
+        // empty string if there isn't one (yet).
+        QString resolve( QString const& name ) const {
+            QString target { name };
+            for ( int hops = 0; hops <= MaximumAliasHops; ++hops ) {
+                if ( _records.contains( target ) ) {
+                    return target;
+                }
+                auto const alias = _aliases.constFind( target );
+                if ( alias == _aliases.constEnd( ) ) {
+                    break;
+                }
+                target = alias.value( );
+            }
+            return { };
+        }
+
+        QList<QString> names( ) const {
+            QList<QString> names { _records.keys( ) };
+            for ( auto iter = _aliases.constBegin( ); iter != _aliases.constEnd( ); ++iter ) {
+                if ( !resolve( iter.key( ) ).isEmpty( ) ) {
+                    names.append( iter.key( ) );
+                }
+            }
+            return names;
+        }
+
+        bool contains( QString const& name ) const {
+            return !resolve( name ).isEmpty( );
+        }
+
+        // Runs of repeated layers share one image, so the last one decoded
+        // is kept.
+        QImage load( QString const& name ) {
+            QString const target { resolve( name ) };
+            if ( target.isEmpty( ) ) {
+                return { };
+            }
+
+            qint64 const offset = _records.value( target );
+            if ( offset == _lastOffset ) {
+                return _lastImage;
+            }
+
+            LayerRecordHeader record;
+            memcpy( &record, _data + offset, sizeof( record ) );
+            if ( ( record.width > 16384 ) || ( record.height > 16384 ) || ( record.left + record.boxWidth > record.width ) || ( record.top + record.boxHeight > record.height ) ) {
+                debug( "+ LayerArchiveReader::load: bad record for layer '%s' in '%s'\n", name.toUtf8( ).data( ), _fileName.toUtf8( ).data( ) );
+                return { };
+            }
+
+            QImage image { static_cast<int>( record.width ), static_cast<int>( record.height ), QImage::Format_Grayscale8 };
+            if ( image.isNull( ) ) {
+                return image;
+            }
+            image.fill( 0 );
+
+            uchar const* data = _data + offset + sizeof( record ) + record.nameLength;
+            size_t       in   = 0;
+            for ( uint32_t y = 0; y < record.boxHeight; ++y ) {
+                if ( !unpackRow( data, record.dataSize, in, image.scanLine( record.top + y ) + record.left, record.boxWidth ) ) {
+                    debug( "+ LayerArchiveReader::load: layer '%s' in '%s' is corrupt\n", name.toUtf8( ).data( ), _fileName.toUtf8( ).data( ) );
+                    return { };
+                }
+            }
+
+            _lastOffset = offset;
+            _lastImage  = image;
+            return image;
+        }
+
+    private:
+
+        QString                 _fileName;
+        std::unique_ptr<QFile>  _file;
+        dev_t                   _device     { };
+        ino_t                   _inode      { };
+        quint64                 _serial     { };
+        uchar*                  _data       { };
+        qint64                  _mappedSize { };
+        qint64                  _scanned    { };
+        QHash<QString, qint64>  _records;
+        QHash<QString, QString> _aliases;
+        qint64                  _lastOffset { -1 };
+        QImage                  _lastImage;
+
+        void _reset( ) {
+            _file.reset( );
+            _data       = nullptr;
+            _mappedSize = 0;
+            _scanned    = 0;
+            _records.clear( );
+            _aliases.clear( );
+            _lastOffset = -1;
+            _lastImage  = { };
+        }
+
+    };
+
+    // Readers stay open between calls, so that a print doesn't re-index the
+    // archive for every layer.
+    QMutex                                               readersLock;
+    QHash<QString, std::shared_ptr<LayerArchiveReader>> readers;
+    QStringList                                          recentDirectories;
+
+    // Call with readersLock held.
+    LayerArchiveReader* archiveFor( QString const& directory ) {
+        QString const fileName { directory % Slash % LayerArchiveFileName };
+
+        if ( !QFile::exists( fileName ) ) {
+            readers.remove( directory );
+            recentDirectories.removeOne( directory );
+            return nullptr;
+        }
+
+        // The reader notices by itself when the archive has been replaced
+        std::shared_ptr<LayerArchiveReader> reader { readers.value( directory ) };
+        if ( !reader ) {
+            reader = std::make_shared<LayerArchiveReader>( fileName );
+        }
+        if ( !reader->update( ) ) {
+            debug( "+ archiveFor: couldn't read layer archive '%s'\n", fileName.toUtf8( ).data( ) );
+            readers.remove( directory );
+            recentDirectories.removeOne( directory );
+            return nullptr;
+        }
+
+        readers.insert( directory, reader );
+        recentDirectories.removeOne( directory );
+        recentDirectories.prepend( directory );
+        while ( recentDirectories.count( ) > MaximumOpenArchives ) {
+            readers.remove( recentDirectories.takeLast( ) );
+        }
+        return reader.get( );
+    }
+
+}
+
+LayerArchiveWriter::LayerArchiveWriter( QString const& directory ):
+    _file { directory % Slash % LayerArchiveFileName }
+{
+    // Records go straight to the file, so that readers see each one whole
+    // as soon as it's written.
+    QFile::remove( _file.fileName( ) );
+    if ( !_file.open( QIODevice::WriteOnly | QIODevice::Unbuffered ) ) {
+        debug( "+ LayerArchiveWriter::LayerArchiveWriter: couldn't create '%s': %s\n", _file.fileName( ).toUtf8( ).data( ), _file.errorString( ).toUtf8( ).data( ) );
+        return;
+    }
+
+    LayerArchiveHeader header { };
+    memcpy( header.magic, LayerArchiveMagic, sizeof( LayerArchiveMagic ) );
+    header.version = LayerArchiveVersion;
+    header.serial  = QRandomGenerator::global( )->generate64( );
+    if ( _file.write( reinterpret_cast<char const*>( &header ), sizeof( header ) ) != static_cast<qint64>( sizeof( header ) ) ) {
+        _failed = true;
+    }
+}
+
+LayerArchiveWriter::~LayerArchiveWriter( ) {
+    close( );
+}
+
+bool LayerArchiveWriter::write( QString const& name, QImage const& source ) {
+    QImage const image { ( source.format( ) == QImage::Format_Grayscale8 ) ? source : source.convertToFormat( QImage::Format_Grayscale8 ) };
+    QByteArray const nameBytes { name.toUtf8( ) };
+    int const width  = image.width( );
+    int const height = image.height( );
+
+    // Only the bounding box of the lit pixels is stored
+    int left = width, right = -1, top = height, bottom = -1;
+    for ( int y = 0; y < height; ++y ) {
+        uchar const* row = image.constScanLine( y );
+        int first = 0;
+        while ( ( first < width ) && !row[first] ) {
+            ++first;
+        }
+        if ( first == width ) {
+            continue;
+        }
+        int last = width - 1;
+        while ( !row[last] ) {
+            --last;
+        }
+
+        left   = std::min( left,  first );
+        right  = std::max( right, last  );
+        top    = std::min( top,   y     );
+        bottom = y;
+    }
+
+    LayerRecordHeader record { };
+    record.nameLength = static_cast<uint32_t>( nameBytes.size( ) );
+    record.width      = static_cast<uint32_t>( width  );
+    record.height     = static_cast<uint32_t>( height );
+
+    QByteArray data;
+    if ( bottom >= 0 ) {
+        record.left      = static_cast<uint32_t>( left );
+        record.top       = static_cast<uint32_t>( top  );
+        record.boxWidth  = static_cast<uint32_t>( right  - left + 1 );
+        record.boxHeight = static_cast<uint32_t>( bottom - top  + 1 );
+        for ( int y = top; y <= bottom; ++y ) {
+            packRow( image.constScanLine( y ) + left, static_cast<int>( record.boxWidth ), data );
+        }
+    }
+    record.dataSize = static_cast<uint32_t>( data.size( ) );
+
+    return _append( name, recordBytes( record, nameBytes, data ) );
+}
+
+bool LayerArchiveWriter::writeAlias( QString const& name, QString const& target ) {
+    QByteArray const nameBytes   { name.toUtf8( )   };
+    QByteArray const targetBytes { target.toUtf8( ) };
+
+    LayerRecordHeader record { };
+    record.nameLength = static_cast<uint32_t>( nameBytes.size( ) );
+    record.dataSize   = static_cast<uint32_t>( targetBytes.size( ) );
+    record.flags      = LayerRecordIsAlias;
+
+    return _append( name, recordBytes( record, nameBytes, targetBytes ) );
+}
+
+bool LayerArchiveWriter::_append( QString const& name, QByteArray const& bytes ) {
+    QMutexLocker locker { &_lock };
+    if ( !_file.isOpen( ) || _failed ) {
+        return false;
+    }
+    if ( _file.write( bytes ) != bytes.size( ) ) {
+        debug( "+ LayerArchiveWriter::write: couldn't write layer '%s': %s\n", name.toUtf8( ).data( ), _file.errorString( ).toUtf8( ).data( ) );
+        _failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool LayerArchiveWriter::close( ) {
+    QMutexLocker locker { &_lock };
+    if ( !_file.isOpen( ) ) {
+        return false;
+    }
+
+    _file.close( );
+    return !_failed;
+}
+
+QImage LoadLayerImage( QString const& path ) {
+    int const slash = path.lastIndexOf( Slash );
+    if ( slash >= 0 ) {
+        QMutexLocker locker { &readersLock };
+
+        LayerArchiveReader* reader = archiveFor( path.left( slash ) );
+        QString const name { path.mid( slash + 1 ) };
+        if ( reader && reader->contains( name ) ) {
+            return reader->load( name );
+        }
+    }
+
+    QImage image;
+    image.load( path );
+    return image;
+}
+
+QString LayerImageIdentity( QString const& path ) {
+    int const slash = path.lastIndexOf( Slash );
+    if ( slash < 0 ) {
+        return path;
+    }
+
+    QMutexLocker locker { &readersLock };
+
+    LayerArchiveReader* reader = archiveFor( path.left( slash ) );
+    QString const target { reader ? reader->resolve( path.mid( slash + 1 ) ) : QString { } };
+    return target.isEmpty( ) ? path : ( path.left( slash + 1 ) % target );
+}
+
+QSet<QString> ArchivedLayerNames( QString const& directory ) {
+    QMutexLocker locker { &readersLock };
+
+    LayerArchiveReader* reader = archiveFor( directory );
+    return reader ? QSet<QString>::fromList( reader->names( ) ) : QSet<QString> { };
+}
@@ -0,0 +1,74 @@
+#ifndef __LAYERARCHIVE_H__
+#define __LAYERARCHIVE_H__
+
+#include <QtCore>
+#include <QtGui>
+
+//
+// A job directory's layer images, packed into one file (LayerArchiveFileName)
+// instead of one PNG per layer. Layers keep the file names the order
+// manifest lists them by, so "<directory>/000042.png" names a layer whether
+// it's a file of its own or a record in the directory's archive.
+//
+// Each layer is stored as the bounding box of its lit pixels, 8-bit gray,
+// PackBits-coded row by row; layers are mostly black, so this is smaller
+// than PNG and much quicker to decode.
+//
+// File layout (native byte order):
+//   LayerArchiveHeader
+//   for each layer, in the order written:
+//     LayerRecordHeader
+//     char  name[nameLength]
+//     uchar data[dataSize]
+//
+// A layer with the same image as one already written can be stored as an
+// alias, whose data is the other layer's name; runs of identical layers
+// then take one image's worth of space, and are decoded once.
+//
+// Records are appended whole, so an archive can be read while it's still
+// being written. A layer written more than once keeps its last record.
+//
+
+class LayerArchiveWriter {
+
+public:
+
+    // Starts a new, empty archive in the directory.
+    LayerArchiveWriter( QString const& directory );
+    ~LayerArchiveWriter( );
+
+    bool isOpen( ) const { return _file.isOpen( ); }
+
+    // Safe to call from several threads at once.
+    bool write( QString const& name, QImage const& image );
+
+    // Stores the layer as having the same image as target.
+    bool writeAlias( QString const& name, QString const& target );
+
+    bool close( );
+
+protected:
+
+private:
+
+    QFile  _file;
+    QMutex _lock;
+    bool   _failed { };
+
+    bool _append( QString const& name, QByteArray const& bytes );
+
+};
+
+// Loads a layer image by path: from the directory's archive if it has the
+// layer, otherwise from a file of that name. Returns a null image if there
+// is neither.
+QImage        LoadLayerImage( QString const& path );
+
+// Names of the layers in the directory's archive, if it has one.
+QSet<QString> ArchivedLayerNames( QString const& directory );
+
+// The path of the layer whose image is actually stored for this one, so
+// layers that share an image have the same identity.
+QString       LayerImageIdentity( QString const& path );
+
+#endif // __LAYERARCHIVE_H__
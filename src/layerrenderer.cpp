@@ -0,0 +1,195 @@
+#include "pch.h"
+
+#include <sys/sysinfo.h>
+#include <QtCore>
+
+#include "layerrenderer.h"
+#include "timinglogger.h"
+#include "ordermanifestmanager.h"
+#include "parallel.h"
+
+
+namespace
+{
+    /* One worker per core, as long as there's memory for each worker's
+     * image, PNG encoder buffers and a share of the queued outlines. */
+    int _RenderThreadCount(unsigned int pxWidth, unsigned int pxHeight, int maximumThreads)
+    {
+        int threads = static_cast<int>(hardware_threads());
+        if (maximumThreads > 0)
+            threads = std::min(threads, maximumThreads);
+
+        struct sysinfo info;
+        if (sysinfo(&info) == 0) {
+            quint64 available = (static_cast<quint64>(info.freeram) + info.bufferram) * info.mem_unit;
+            quint64 perWorker = std::max<quint64>(static_cast<quint64>(pxWidth) * pxHeight * 4, 1);
+            /* leave at least half of what's free for everything else */
+            threads = std::max<int>(1, std::min<quint64>(threads, available / 2 / perWorker));
+        }
+        return threads;
+    }
+
+    /* Identifies a layer's outlines, so repeated layers can be spotted */
+    QByteArray _LayerKey(const QVector<QPolygonF> &polygons, FillRule fillRule)
+    {
+        QCryptographicHash hash { QCryptographicHash::Md5 };
+        char const rule = static_cast<char>(fillRule);
+        hash.addData(&rule, 1);
+        for (auto const &polygon : polygons) {
+            int const count = polygon.count();
+            hash.addData(reinterpret_cast<const char *>(&count), sizeof(count));
+            hash.addData(reinterpret_cast<const char *>(polygon.constData()), count * static_cast<int>(sizeof(QPointF)));
+        }
+        return hash.result();
+    }
+
+}
+
+LayerRenderer::~LayerRenderer()
+{
+    /* The queued tasks refer to this renderer, so they have to finish even
+     * if the layers stopped coming */
+    _threadPool.waitForDone();
+}
+
+void LayerRenderer::begin(const QSize& pxSize, const QString& outputDirectory,
+    QSharedPointer<OrderManifestManager> orderManager)
+{
+    Q_ASSERT(outputDirectory.length() > 0);
+
+    debug("+ LayerRenderer::begin\n");
+    debug("  + outputDirectory: %s\n", outputDirectory.toUtf8().data());
+
+    TimingLogger::startTiming( TimingId::RenderingPngs );
+
+    _outputDirectory = outputDirectory;
+    _orderManager = orderManager;
+    _currentLayer = 0;
+    _completedLayers = 0;
+    _finishedLayers.clear();
+    _nextLayerToReport = 0;
+    _layerFailed = false;
+    _layerKeys.clear();
+    _writtenLayers.clear();
+    _repeatsWaiting.clear();
+    _repeatedLayers = 0;
+
+    _pxWidth  = pxSize.width();
+    _pxHeight = pxSize.height();
+    _threadPool.setMaxThreadCount( _RenderThreadCount( _pxWidth, _pxHeight, _maximumThreadCount ) );
+    debug( "  + dimensions: px %d×%d; %d render threads\n", _pxWidth, _pxHeight, _threadPool.maxThreadCount( ) );
+
+    /* The layers go into one archive in the output directory */
+    _archive.reset(new LayerArchiveWriter { _outputDirectory });
+}
+
+void LayerRenderer::addLayer(const QVector<QPolygonF>& polygons, FillRule fillRule)
+{
+    int const layer = _currentLayer++;
+
+    /* A manager that's already listing every layer is being printed from
+     * while rendering goes on */
+    if (!_orderManager.isNull() && layer >= _orderManager->getSize())
+        _orderManager->addFile(QString("%1.png").arg(layer, 6, 10, DigitZero));
+
+    QByteArray key { _LayerKey(polygons, fillRule) };
+    auto original = _layerKeys.constFind(key);
+    if (original != _layerKeys.constEnd()) {
+        _repeatLayer(layer, original.value());
+    } else {
+        _layerKeys.insert(key, layer);
+        _queueSlots.acquire();
+        _threadPool.start(new LayerRenderTask { *this, layer, polygons, fillRule, _layerPath(layer) });
+    }
+}
+
+void LayerRenderer::finish()
+{
+    _threadPool.waitForDone();
+    if ( !_archive->close( ) ) {
+        _layerFailed = true;
+    }
+
+    int const layers = _currentLayer;
+    debug( "+ LayerRenderer::finish: %d layers, %d of them repeats\n", layers, _repeatedLayers );
+
+    if ( !_orderManager.isNull( ) && ( _orderManager->getSize( ) != layers ) ) {
+        debug( "  + manifest lists %d layers\n", _orderManager->getSize( ) );
+        throw std::runtime_error("Layer count doesn't match manifest");
+    }
+    if ( _layerFailed ) {
+        throw std::runtime_error("Couldn't write layer images");
+    }
+
+    _orderManager->setPath(_outputDirectory);
+
+    _totalLayers = layers;
+    emit layerCount( _totalLayers );
+
+    _orderManager->save();
+}
+
+QString LayerRenderer::_layerPath(int layer) const
+{
+    return QString("%1/%2.png").arg(_outputDirectory).arg(layer, 6, 10, DigitZero);
+}
+
+void LayerRenderer::_layerFinished(int layer, const QString &path)
+{
+    QMutexLocker locker { &_finishedLock };
+
+    _finishedLayers.insert(layer, path);
+    _writtenLayers.insert(layer, path);
+    for (int repeat : _repeatsWaiting.values(layer))
+        _finishedLayers.insert(repeat, _copyLayer(path, repeat));
+    _repeatsWaiting.remove(layer);
+
+    _reportFinishedLayers();
+}
+
+void LayerRenderer::_repeatLayer(int layer, int original)
+{
+    QMutexLocker locker { &_finishedLock };
+
+    _repeatedLayers++;
+    if (!_writtenLayers.contains(original)) {
+        _repeatsWaiting.insert(original, layer);
+        return;
+    }
+
+    _finishedLayers.insert(layer, _copyLayer(_writtenLayers.value(original), layer));
+    _reportFinishedLayers();
+}
+
+/* Called with _finishedLock held */
+QString LayerRenderer::_copyLayer(const QString &originalPath, int layer)
+{
+    if (originalPath.isEmpty())
+        return QString();
+
+    QString path { _layerPath(layer) };
+    if (!_archive->writeAlias(GetFileBaseName(path), GetFileBaseName(originalPath))) {
+        debug("+ layer error: couldn't write %s\n", path.toUtf8().data());
+        return QString();
+    }
+
+    _completedLayers++;
+    return path;
+}
+
+/* Called with _finishedLock held */
+void LayerRenderer::_reportFinishedLayers()
+{
+    while (_finishedLayers.contains(_nextLayerToReport)) {
+        QString finishedPath { _finishedLayers.take(_nextLayerToReport) };
+        if (finishedPath.isEmpty())
+            _layerFailed = true;
+        _nextLayerToReport++;
+
+        /* Layers past one that couldn't be written are never ready */
+        if (!_layerFailed && !_orderManager.isNull())
+            _orderManager->setRenderedCount(_nextLayerToReport);
+        if (!finishedPath.isEmpty())
+            emit layerComplete(_nextLayerToReport - 1, finishedPath);
+    }
+}
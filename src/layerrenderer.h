@@ -0,0 +1,135 @@
+#ifndef __LAYERRENDERER_H__
+#define __LAYERRENDERER_H__
+
+#include <memory>
+#include <QtCore>
+#include "printjob.h"
+#include "debug.h"
+#include "polygonrasterizer.h"
+#include "layerarchive.h"
+
+class LayerRenderTask;
+
+/* Renders layer outlines into a job directory's layer images as the slicer
+ * hands them over: begin() once, addLayer() for each layer in order, then
+ * finish(). Layers are rasterized on a pool of threads while the next ones
+ * are being sliced. */
+class LayerRenderer: public QObject
+{
+    friend class LayerRenderTask;
+    Q_OBJECT
+
+public:
+    LayerRenderer() = default;
+    virtual ~LayerRenderer() override;
+
+    /* pxSize is the size of every layer image, in projector pixels */
+    void begin(const QSize& pxSize, const QString& outputDirectory,
+        QSharedPointer<OrderManifestManager> orderManager);
+
+    /* Outlines are in projector pixels, with (0, 0) at the top left corner
+     * of the image. Blocks while the render threads are too far behind. */
+    void addLayer(const QVector<QPolygonF>& polygons, FillRule fillRule = FillRule::NonZero);
+
+    /* Waits for every layer to be written and saves the manifest; throws if
+     * any layer couldn't be written */
+    void finish();
+
+    /* Caps the render threads below one per core, for when another
+     * renderer is sharing the machine; 0 means no cap */
+    void setMaximumThreadCount(int threads) { _maximumThreadCount = threads; }
+
+protected:
+    /* Layers waiting for a render thread; this bounds memory use however
+     * many layers the model has */
+    static int const MaximumQueuedLayers { 32 };
+
+    QString _outputDirectory;
+    QThreadPool _threadPool;
+    QSemaphore _queueSlots { MaximumQueuedLayers };
+    QSharedPointer<OrderManifestManager> _orderManager;
+    std::unique_ptr<LayerArchiveWriter> _archive;
+
+    int                     _currentLayer        { };
+    std::atomic<int>        _completedLayers     { };
+    int                     _totalLayers         { };
+    int                     _digits              { };
+    unsigned int                     _pxWidth             { };
+    unsigned int                     _pxHeight            { };
+
+    bool                    _isRunning           { };
+    int                     _maximumThreadCount  { };
+
+    /* Layers can finish in any order; they're reported in order */
+    QMutex                  _finishedLock;
+    QMap<int, QString>      _finishedLayers;
+    int                     _nextLayerToReport   { };
+    bool                    _layerFailed         { };
+
+    /* A layer with the same outlines as an earlier one isn't rendered; it's
+     * stored as a reference to the earlier layer's image, once that's
+     * written */
+    QHash<QByteArray, int>  _layerKeys;
+    QHash<int, QString>     _writtenLayers;
+    QMultiHash<int, int>    _repeatsWaiting;
+    int                     _repeatedLayers      { };
+
+    QString _layerPath(int layer) const;
+    void _renderLayer( );
+    void _layerFinished(int layer, const QString &path);
+    void _repeatLayer(int layer, int original);
+    QString _copyLayer(const QString &originalPath, int layer);
+    void _reportFinishedLayers( );
+
+signals:
+    void layerCount(int const totalLayers);
+    void layerComplete(int const layer, QString path);
+};
+
+class LayerRenderTask: public QRunnable
+{
+public:
+    LayerRenderTask(LayerRenderer &renderer, int num, const QVector<QPolygonF> &polygons,
+        FillRule fillRule, const QString output):
+        _renderer(renderer),
+        _layerNumber(num),
+        _polygons(polygons),
+        _fillRule(fillRule),
+        _outputPath(output)
+    {
+    }
+
+    virtual void run() override
+    {
+        _render();
+        _renderer._queueSlots.release();
+    }
+
+private:
+    void _render()
+    {
+        debug("+ processing layer %d\n", _layerNumber);
+
+        PolygonRasterizer rasterizer { QSize(_renderer._pxWidth, _renderer._pxHeight), _fillRule };
+        QImage image { rasterizer.rasterize(_polygons) };
+
+        if (!_renderer._archive->write(GetFileBaseName(_outputPath), image)) {
+            debug("+ layer error: couldn't write %s\n", _outputPath.toUtf8().data());
+            _renderer._layerFinished(_layerNumber, QString());
+            return;
+        }
+
+        _renderer._completedLayers++;
+        _renderer._layerFinished(_layerNumber, _outputPath);
+        debug("+ completed layer %d\n", _layerNumber);
+    }
+
+    LayerRenderer &_renderer;
+    int _layerNumber;
+    const QVector<QPolygonF> _polygons;
+    const FillRule _fillRule;
+    const QString _outputPath;
+};
+
+
+#endif // __LAYERRENDERER_H__
@@ -1,17 +1,36 @@
 #include "pch.h"
 
 #include "loader.h"
-#include "vertex.h"
+
+#include "compressedfilereader.h"
+#include "meshcache.h"
+#include "meshsimplifier.h"
+#include "modelfingerprint.h"
+#include "parallel.h"
+#include "timinglogger.h"
+
+// Models with fewer triangles than this load quickly enough and draw
+// quickly enough that they get neither a preview nor coarser levels.
+static const size_t LodMinimumTriangles = 250000;
+
+// Grid resolutions of the preview shown while loading and of the levels
+// of detail drawn while the view is being moved, finest first
+static const unsigned PreviewResolution = 32;
+static const unsigned LodResolutions[] = { 96, 32 };
+
+// Work is done in blocks of about this many bytes between checks for
+// cancellation and progress reports.
+static const qint64 ProgressBlockSize = 1 << 20;
 
 Loader::Loader(const QString& filename, QObject* parent)
-    : QThread(parent), filename(filename)
+    : QThread(parent), filename(filename), host_thread(nullptr), reading_percent(-1), bytes_parsed(0)
 {
     // Nothing to do here
 }
 
 void Loader::run()
 {
-    Mesh* mesh = load_stl();
+    Mesh* mesh = load_mesh();
     if (mesh)
     {
         if (mesh->empty())
@@ -27,82 +46,614 @@ void Loader::run()
     }
 }
 
+Mesh* Loader::load_mesh(QString model_hash)
+{
+    host_thread = QThread::currentThread();
+
+    // Meshes are cached under the same hash that PrepareTab uses to name
+    // the slice directories, so a model that has been opened before can be
+    // mapped in without parsing it again.
+    if (model_hash.isEmpty())
+    {
+        model_hash = hash_model();
+    }
+    if (cancelled())
+    {
+        return NULL;
+    }
+    Mesh* mesh = model_hash.isEmpty() ? nullptr : MeshCache::load(model_hash);
+    if (!mesh)
+    {
+        mesh = load_stl();
+        if (mesh && !mesh->empty() && !model_hash.isEmpty())
+        {
+            MeshCache::save(model_hash, mesh);
+        }
+    }
+
+    if (mesh && !mesh->empty())
+    {
+        // Measure the mesh here, off the GUI thread, so that FileTab has
+        // the volume as soon as the mesh arrives
+        TimingLogger::startTiming(TimingId::VolumeCalculation, GetFileBaseName(filename));
+        mesh->statistics();
+        TimingLogger::stopTiming(TimingId::VolumeCalculation);
+
+        add_levels_of_detail(mesh);
+    }
+
+    if (cancelled())
+    {
+        debug( "+ Loader::load_mesh: cancelled loading '%s'\n", filename.toUtf8( ).data( ) );
+        delete mesh;
+        return NULL;
+    }
+    return mesh;
+}
+
+QString Loader::hash_model()
+{
+    host_thread = QThread::currentThread();
+
+    // A file that's been fingerprinted before isn't read again
+    int percent = -1;
+    return ModelFingerprint::fingerprint(filename, [this, &percent](qint64 done, qint64 total)
+    {
+        if (cancelled())
+        {
+            return false;
+        }
+        if (done * 100 / total != percent)
+        {
+            percent = int(done * 100 / total);
+            emit hashing(done, total);
+        }
+        return true;
+    });
+}
+
+void Loader::report_reading(qint64 done, qint64 total)
+{
+    if (total <= 0)
+    {
+        return;
+    }
+    const int percent = int(std::min(done, total) * 100 / total);
+    int previous = reading_percent.load();
+    while (percent > previous)
+    {
+        if (reading_percent.compare_exchange_weak(previous, percent))
+        {
+            emit reading(done, total);
+            return;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*  Maps a file into memory, or if that isn't possible, reads it into
+ *  fallback.  Returns nullptr if the file can't be read at all. */
+static const uchar* map_file(QFile& file, QByteArray& fallback)
+{
+    const uchar* data = file.map(0, file.size());
+    if (!data)
+    {
+        debug( "+ map_file: couldn't map file, reading it instead: %s\n", file.errorString( ).toUtf8( ).data( ) );
+        file.seek(0);
+        fallback = file.readAll();
+        if (fallback.size() != file.size())
+        {
+            return nullptr;
+        }
+        data = reinterpret_cast<const uchar*>(fallback.constData());
+    }
+    return data;
+}
+
+void decode_binary_triangles(const uchar* facets, size_t first, size_t last, GLfloat* verts)
+{
+    // Each facet is a normal, three vertices and a 16-bit attribute word;
+    // skip the normal and the attribute.
+    auto b = facets + first * 50;
+    auto v = verts + first * 9;
+    for (size_t t = first; t < last; ++t)
+    {
+        memcpy(v, b + 3 * sizeof(float), 9 * sizeof(float));
+        b += 50;
+        v += 9;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*  Returns the bit pattern of a coordinate, with -0 folded into +0 so
+ *  that the two compare equal (as they did with operator!=) */
+static inline uint32_t coordinate_bits(GLfloat f)
+{
+    f += 0.0f;
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline uint64_t vertex_hash(const GLfloat* v)
+{
+    uint64_t h = coordinate_bits(v[0]) * UINT64_C(0x9E3779B97F4A7C15);
+    h ^= coordinate_bits(v[1]) * UINT64_C(0xC2B2AE3D27D4EB4F);
+    h ^= coordinate_bits(v[2]) * UINT64_C(0x165667B19E3779F9);
+    h ^= h >> 29;
+    h *= UINT64_C(0xBF58476D1CE4E5B9);
+    h ^= h >> 32;
+    return h;
+}
+
+static inline bool same_vertex(const GLfloat* a, const GLfloat* b)
+{
+    return coordinate_bits(a[0]) == coordinate_bits(b[0]) &&
+           coordinate_bits(a[1]) == coordinate_bits(b[1]) &&
+           coordinate_bits(a[2]) == coordinate_bits(b[2]);
+}
+
+/*
+ *  One shard of the deduplication table: an open-addressed hash table
+ *  of slots pointing into a packed array of the shard's unique vertices.
+ *  Each shard is owned by exactly one thread, so no locking is needed.
+ */
+class VertexShard
+{
+public:
+    explicit VertexShard(size_t expected)
+    {
+        size_t capacity = 64;
+        while (capacity < expected * 2)
+        {
+            capacity <<= 1;
+        }
+        slots.assign(capacity, 0);
+        unique.reserve(expected * 3);
+    }
+
+    GLuint insert(const GLfloat* v, uint64_t h)
+    {
+        if ((count() + 1) * 2 > slots.size())
+        {
+            grow();
+        }
+
+        const size_t mask = slots.size() - 1;
+        for (size_t s = h & mask; ; s = (s + 1) & mask)
+        {
+            if (!slots[s])
+            {
+                unique.insert(unique.end(), v, v + 3);
+                slots[s] = GLuint(count());
+                return slots[s] - 1;
+            }
+            if (same_vertex(&unique[(slots[s] - 1) * 3], v))
+            {
+                return slots[s] - 1;
+            }
+        }
+    }
+
+    size_t count() const { return unique.size() / 3; }
+
+    // Slots store index + 1, so that zero marks an empty slot
+    std::vector<GLuint> slots;
+    std::vector<GLfloat> unique;
+
+private:
+    void grow()
+    {
+        std::vector<GLuint> old(slots.size() * 2, 0);
+        old.swap(slots);
+
+        const size_t mask = slots.size() - 1;
+        for (GLuint i = 0; i < count(); ++i)
+        {
+            size_t s = vertex_hash(&unique[i * 3]) & mask;
+            while (slots[s])
+            {
+                s = (s + 1) & mask;
+            }
+            slots[s] = i + 1;
+        }
+    }
+};
+
+/*
+ *  Builds an indexed mesh from a triangle soup of tri_count * 9 floats.
+ *
+ *  Vertices are partitioned by hash into one shard per thread; each thread
+ *  then deduplicates its own shard in a single pass, writing shard-local
+ *  indices into the index buffer.  Finally the shards are concatenated and
+ *  the indices rebased.  Besides the output buffers, the only extra memory
+ *  used is one byte per triangle corner plus the hash tables themselves.
+ *
+ *  The soup is released before the final vertex buffer is allocated.
+ */
+Mesh* mesh_from_verts(uint32_t tri_count, std::vector<GLfloat>& verts, const QThread& thread)
+{
+    const size_t corner_count = size_t(tri_count) * 3;
+    const unsigned threads = corner_count < 65536 ? 1 : hardware_threads();
+
+    // Use a power of two number of shards, so the shard can be taken from
+    // the top bits of the hash
+    unsigned shard_bits = 0;
+    while ((1u << shard_bits) < threads && shard_bits < 8)
+    {
+        ++shard_bits;
+    }
+    const unsigned shard_count = 1u << shard_bits;
+
+    std::vector<uint8_t> shard_of(corner_count);
+    parallel_for(corner_count, threads, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            shard_of[i] = shard_bits ? uint8_t(vertex_hash(&verts[i * 3]) >> (64 - shard_bits)) : 0;
+        }
+    });
+
+    // Most meshes share each vertex between about six triangles, so size
+    // the tables for that and let them grow if needed.
+    std::vector<GLuint> indices(corner_count);
+    std::vector<VertexShard> shards;
+    shards.reserve(shard_count);
+    for (unsigned s = 0; s < shard_count; ++s)
+    {
+        shards.emplace_back(corner_count / shard_count / 4);
+    }
+
+    parallel_for(shard_count, shard_count, [&](size_t first, size_t last)
+    {
+        for (size_t s = first; s < last; ++s)
+        {
+            auto& shard = shards[s];
+            for (size_t i = 0; i < corner_count; ++i)
+            {
+                if (!(i & 0xFFFF) && thread.isInterruptionRequested())
+                {
+                    break;
+                }
+                if (shard_of[i] == s)
+                {
+                    indices[i] = shard.insert(&verts[i * 3], vertex_hash(&verts[i * 3]));
+                }
+            }
+            std::vector<GLuint>().swap(shard.slots);
+        }
+    });
+    std::vector<GLfloat>().swap(verts);
+    if (thread.isInterruptionRequested())
+    {
+        return NULL;
+    }
+
+    std::vector<GLuint> offsets(shard_count);
+    size_t vertex_count = 0;
+    for (unsigned s = 0; s < shard_count; ++s)
+    {
+        offsets[s] = GLuint(vertex_count);
+        vertex_count += shards[s].count();
+    }
+
+    std::vector<GLfloat> flat_verts(vertex_count * 3);
+    parallel_for(shard_count, shard_count, [&](size_t first, size_t last)
+    {
+        for (size_t s = first; s < last; ++s)
+        {
+            std::copy(shards[s].unique.begin(), shards[s].unique.end(), flat_verts.begin() + size_t(offsets[s]) * 3);
+            std::vector<GLfloat>().swap(shards[s].unique);
+        }
+    });
+    parallel_for(corner_count, threads, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            indices[i] += offsets[shard_of[i]];
+        }
+    });
+
+    return new Mesh(std::move(flat_verts), std::move(indices));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
-void parallel_sort(Vertex* begin, Vertex* end, int threads)
+static inline bool is_space(char c)
 {
-    if (threads < 2 || end - begin < 2)
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+/*
+ *  Parses a decimal floating-point token.  Tokens with at most 19
+ *  significant digits and a small exponent (which covers everything CAD
+ *  packages write) are converted with a single double multiply or divide;
+ *  anything else goes through QByteArray::toFloat.
+ */
+static bool parse_float(const char* begin, const char* end, float& out)
+{
+    static const double powers_of_ten[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* p = begin;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
     {
-        std::sort(begin, end);
+        negative = *p == '-';
+        ++p;
     }
-    else
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any_digits = false;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p)
     {
-        const auto mid = begin + (end - begin) / 2;
-        if (threads == 2)
+        any_digits = true;
+        if (digits < 19)
         {
-            auto future = std::async(parallel_sort, begin, mid, threads / 2);
-            std::sort(mid, end);
-            future.wait();
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
         }
         else
         {
-            auto a = std::async(std::launch::async, parallel_sort, begin, mid, threads / 2);
-            auto b = std::async(std::launch::async, parallel_sort, mid, end, threads / 2);
-            a.wait();
-            b.wait();
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            any_digits = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            }
+        }
+    }
+    if (any_digits && p < end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        bool negative_exponent = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative_exponent = *p == '-';
+            ++p;
+        }
+        int e = 0;
+        bool any_exponent_digits = false;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            any_exponent_digits = true;
+            e = std::min(e * 10 + (*p - '0'), 100000);
+        }
+        if (!any_exponent_digits)
+        {
+            any_digits = false;
         }
-        std::inplace_merge(begin, mid, end);
+        exponent += negative_exponent ? -e : e;
     }
+
+    if (any_digits && p == end && mantissa < (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double value = double(mantissa);
+        value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+        out = float(negative ? -value : value);
+        return true;
+    }
+
+    bool okay = false;
+    out = QByteArray::fromRawData(begin, int(end - begin)).toFloat(&okay);
+    return okay;
 }
 
-Mesh* mesh_from_verts(uint32_t tri_count, QVector<Vertex>& verts)
+/*
+ *  Walks whitespace-separated tokens in a mapped buffer, without copying.
+ */
+class AsciiStlTokenizer
 {
-    // Save indicies as the second element in the array
-    // (so that we can reconstruct triangle order after sorting)
-    for (size_t i=0; i < tri_count*3; ++i)
+public:
+    AsciiStlTokenizer(const char* begin, const char* end)
+        : p(begin), end(end)
+    {
+        // Nothing to do here
+    }
+
+    bool next()
+    {
+        while (p < end && is_space(*p))
+        {
+            ++p;
+        }
+        token = p;
+        while (p < end && !is_space(*p))
+        {
+            ++p;
+        }
+        return p > token;
+    }
+
+    bool is(const char* word) const
     {
-        verts[i].i = i;
+        const size_t length = strlen(word);
+        return size_t(p - token) == length && !memcmp(token, word, length);
     }
 
-    // Check how many threads the hardware can safely support. This may return
-    // 0 if the property can't be read so we shoud check for that too.
-    auto threads = std::thread::hardware_concurrency();
-    if (threads == 0)
+    bool expect(const char* word)
     {
-        threads = 8;
+        return next() && is(word);
     }
 
-    // Sort the set of vertices (to deduplicate)
-    parallel_sort(verts.begin(), verts.end(), threads);
+    bool number(float& f)
+    {
+        return next() && parse_float(token, p, f);
+    }
 
-    // This vector will store triangles as sets of 3 indices
-    std::vector<GLuint> indices(tri_count*3);
+    bool skip(int count)
+    {
+        while (count--)
+        {
+            if (!next())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
 
-    // Go through the sorted vertex list, deduplicating and creating
-    // an indexed geometry representation for the triangles.
-    // Unique vertices are moved so that they occupy the first vertex_count
-    // positions in the verts array.
-    size_t vertex_count = 0;
-    for (auto v : verts)
+private:
+    const char* p;
+    const char* const end;
+    const char* token = nullptr;
+};
+
+/*
+ *  Parses a run of complete facets, optionally followed by "endsolid",
+ *  appending their vertices to verts.
+ */
+static bool parse_ascii_facets(const char* begin, const char* end, std::vector<GLfloat>& verts)
+{
+    AsciiStlTokenizer tokens(begin, end);
+    while (tokens.next())
+    {
+        if (tokens.is("endsolid"))
+        {
+            return true;
+        }
+        if (!tokens.is("facet") || !tokens.expect("normal") || !tokens.skip(3) ||
+            !tokens.expect("outer") || !tokens.expect("loop"))
+        {
+            return false;
+        }
+
+        for (int i=0; i < 3; ++i)
+        {
+            float x, y, z;
+            if (!tokens.expect("vertex") || !tokens.number(x) || !tokens.number(y) || !tokens.number(z))
+            {
+                return false;
+            }
+            verts.insert(verts.end(), { x, y, z });
+        }
+
+        if (!tokens.expect("endloop") || !tokens.expect("endfacet"))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*  Returns the start of the first "facet" keyword at or after from */
+static const char* find_facet(const char* from, const char* begin, const char* end)
+{
+    while (from < end)
     {
-        if (!vertex_count || v != verts[vertex_count-1])
+        const char* found = static_cast<const char*>(memmem(from, end - from, "facet", 5));
+        if (!found)
         {
-            verts[vertex_count++] = v;
+            return end;
         }
-        indices[v.i] = vertex_count - 1;
+        // Skip over "endfacet", which also contains the keyword
+        if (found > begin && is_space(found[-1]))
+        {
+            return found;
+        }
+        from = found + 5;
     }
-    verts.resize(vertex_count);
+    return end;
+}
 
-    std::vector<GLfloat> flat_verts;
-    flat_verts.reserve(vertex_count*3);
-    for (auto v : verts)
+/*  Returns the start of the first "endsolid" keyword in [begin, end), or end */
+static const char* find_endsolid(const char* begin, const char* end)
+{
+    for (const char* from = begin; from < end; )
     {
-        flat_verts.push_back(v.x);
-        flat_verts.push_back(v.y);
-        flat_verts.push_back(v.z);
+        const char* found = static_cast<const char*>(memmem(from, end - from, "endsolid", 8));
+        if (!found)
+        {
+            return end;
+        }
+        if ((found == begin || is_space(found[-1])) && (found + 8 == end || is_space(found[8])))
+        {
+            return found;
+        }
+        from = found + 8;
     }
+    return end;
+}
 
-    return new Mesh(std::move(flat_verts), std::move(indices));
+////////////////////////////////////////////////////////////////////////////////
+
+Mesh* Loader::build_mesh(uint32_t tri_count, std::vector<GLfloat>& verts)
+{
+    if (cancelled())
+    {
+        return NULL;
+    }
+
+    // Deduplicating a large model takes a while, so first show a coarse
+    // preview clustered straight from the triangle soup (if anyone is
+    // listening for it; background loads aren't).
+    if (tri_count >= LodMinimumTriangles && isSignalConnected(QMetaMethod::fromSignal(&Loader::got_preview)))
+    {
+        float lower[3] { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        float upper[3] { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+        for (size_t i=0; i < verts.size(); i += 3)
+        {
+            for (int axis=0; axis < 3; ++axis)
+            {
+                lower[axis] = std::min(lower[axis], verts[i + axis]);
+                upper[axis] = std::max(upper[axis], verts[i + axis]);
+            }
+        }
+
+        MeshSimplifier simplifier(lower, upper, PreviewResolution);
+        simplifier.add_triangle_soup(verts.data(), tri_count);
+        Mesh* preview = simplifier.build();
+        preview->set_bounds(lower, upper);
+        emit got_preview(preview);
+    }
+
+    emit deduplicating();
+    return mesh_from_verts(tri_count, verts, *host_thread);
+}
+
+void Loader::add_levels_of_detail(Mesh* mesh)
+{
+    if (mesh->triangle_count() < LodMinimumTriangles || !mesh->levels_of_detail().empty())
+    {
+        return;
+    }
+
+    const float lower[3] { mesh->xmin(), mesh->ymin(), mesh->zmin() };
+    const float upper[3] { mesh->xmax(), mesh->ymax(), mesh->zmax() };
+
+    size_t previous = mesh->triangle_count();
+    for (auto resolution : LodResolutions)
+    {
+        if (cancelled())
+        {
+            return;
+        }
+        Mesh* level = MeshSimplifier::simplify(*mesh, resolution);
+
+        // Only keep levels that are a real saving over the previous one
+        if (level->triangle_count() * 2 > previous)
+        {
+            delete level;
+            continue;
+        }
+        previous = level->triangle_count();
+        level->set_bounds(lower, upper);
+        mesh->add_level_of_detail(level);
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -116,67 +667,95 @@ Mesh* Loader::load_stl()
         return NULL;
     }
 
-    // First, try to read the stl as an ASCII file
-    if (file.read(5) == "solid")
+    // Compressed files are decoded as they are decompressed
+    if (CompressedFileReader::isCompressedFileName(filename) &&
+        CompressedFileReader::detectFormat(file.peek(4)) != CompressionFormat::None)
     {
-        file.readLine(); // skip solid name
-        const auto line = file.readLine().trimmed();
-        if (line.startsWith("facet") ||
-            line.startsWith("endsolid"))
-        {
-            file.seek(0);
-            return read_stl_ascii(file);
-        }
-        confusing_stl = true;
+        file.close();
+        return read_stl_compressed();
     }
-    else
+
+    // First, try to read the stl as an ASCII file
+    if (is_ascii_stl(file.peek(stl_head_length), &confusing_stl))
     {
-        confusing_stl = false;
+        return read_stl_ascii(file);
     }
 
     // Otherwise, skip the rest of the header material and read as binary
-    file.seek(0);
     return read_stl_binary(file);
 }
 
+bool Loader::is_ascii_stl(const QByteArray& head, bool* confusing)
+{
+    bool ascii = false;
+    if (head.startsWith("solid"))
+    {
+        const int eol = head.indexOf('\n');
+        const QByteArray line = eol < 0 ? QByteArray() : head.mid(eol + 1).trimmed();
+        ascii = line.startsWith("facet") || line.startsWith("endsolid");
+    }
+
+    if (confusing)
+    {
+        *confusing = !ascii && head.startsWith("solid");
+    }
+    return ascii;
+}
+
 Mesh* Loader::read_stl_binary(QFile& file)
 {
-    QDataStream data(&file);
-    data.setByteOrder(QDataStream::LittleEndian);
-    data.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    const qint64 file_size = file.size();
+    if (file_size < 84)
+    {
+        emit error_bad_stl();
+        return NULL;
+    }
+
+    // Map the file into memory so that triangles can be decoded straight
+    // out of the page cache.
+    QByteArray fallback;
+    const uchar* data = map_file(file, fallback);
+    if (!data)
+    {
+        emit error_bad_stl();
+        return NULL;
+    }
 
     // Load the triangle count from the .stl file
-    file.seek(80);
-    uint32_t tri_count;
-    data >> tri_count;
+    const uint32_t tri_count = qFromLittleEndian<quint32>(data + 80);
 
     // Verify that the file is the right size
-    if (file.size() != 84 + tri_count*50)
+    if (file_size != 84 + qint64(tri_count) * 50)
     {
         emit error_bad_stl();
         return NULL;
     }
 
-    // Extract vertices into an array of xyz, unsigned pairs
-    QVector<Vertex> verts(tri_count*3);
-
-    // Dummy array, because readRawData is faster than skipRawData
-    std::unique_ptr<uint8_t> buffer(new uint8_t[tri_count * 50]);
-    data.readRawData((char*)buffer.get(), tri_count * 50);
+    // Extract vertices into a flat array of xyz triples
+    std::vector<GLfloat> verts(size_t(tri_count) * 9);
 
-    // Store vertices in the array, processing one triangle at a time.
-    auto b = buffer.get() + 3 * sizeof(float);
-    for (auto v=verts.begin(); v != verts.end(); v += 3)
+    // Decode ranges of triangles in parallel, each worker writing directly
+    // into its own slice of the vertex array.
+    const uchar* facets = data + 84;
+    const size_t block_facets = ProgressBlockSize / 50;
+    parallel_for(tri_count, tri_count < 65536 ? 1 : hardware_threads(), [&](size_t first, size_t last)
     {
-        // Load vertex data from .stl file into vertices
-        for (unsigned i=0; i < 3; ++i)
+        for (size_t block = first; block < last && !cancelled(); block += block_facets)
         {
-            memcpy(&v[i], b, 3*sizeof(float));
-            b += 3 * sizeof(float);
+            const size_t block_last = std::min(block + block_facets, last);
+            decode_binary_triangles(facets, block, block_last, verts.data());
+            report_reading(bytes_parsed += qint64(block_last - block) * 50, file_size - 84);
         }
+    });
+
+    if (fallback.isEmpty())
+    {
+        file.unmap(const_cast<uchar*>(data));
+    }
 
-        // Skip face attribute and next face's normal vector
-        b += 3 * sizeof(float) + sizeof(uint16_t);
+    if (cancelled())
+    {
+        return NULL;
     }
 
     if (confusing_stl)
@@ -184,60 +763,305 @@ Mesh* Loader::read_stl_binary(QFile& file)
         emit warning_confusing_stl();
     }
 
-    return mesh_from_verts(tri_count, verts);
+    return build_mesh(tri_count, verts);
 }
 
 Mesh* Loader::read_stl_ascii(QFile& file)
 {
-    file.readLine();
-    uint32_t tri_count = 0;
-    QVector<Vertex> verts(tri_count*3);
+    QByteArray fallback;
+    auto data = reinterpret_cast<const char*>(map_file(file, fallback));
+    if (!data)
+    {
+        emit error_bad_stl();
+        return NULL;
+    }
+    const char* end = data + file.size();
+
+    // Skip the "solid" line, then split the rest of the file into one
+    // range per thread, each starting on a facet boundary. Anything after
+    // the first "endsolid" is ignored, so it's cut off before splitting;
+    // otherwise whether it got parsed would depend on the thread count.
+    const char* begin = static_cast<const char*>(memchr(data, '\n', end - data));
+    begin = begin ? begin + 1 : end;
+    end = find_endsolid(begin, end);
 
-    bool okay = true;
-    while (!file.atEnd() && okay)
+    const size_t size = end - begin;
+    const unsigned threads = size < (1 << 20) ? 1 : hardware_threads();
+    std::vector<const char*> splits { begin };
+    for (unsigned i = 1; i < threads; ++i)
     {
-        const auto line = file.readLine().simplified();
-        if (line.startsWith("endsolid"))
+        const char* split = find_facet(std::max(begin + size / threads * i, splits.back()), begin, end);
+        if (split > splits.back() && split < end)
         {
-            break;
+            splits.push_back(split);
         }
-        else if (!line.startsWith("facet normal") ||
-                 !file.readLine().simplified().startsWith("outer loop"))
+    }
+    splits.push_back(end);
+
+    // Parse each range into its own buffer; roughly 250 bytes of text
+    // describe one facet, which is a good starting guess for reserve().
+    const size_t chunk_count = splits.size() - 1;
+    std::vector<std::vector<GLfloat>> chunks(chunk_count);
+    std::vector<char> results(chunk_count);
+    // Each range is itself parsed a block at a time, again split on facet
+    // boundaries, so that progress can be reported along the way.
+    parallel_for(chunk_count, chunk_count, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
         {
-            okay = false;
-            break;
+            chunks[i].reserve((splits[i + 1] - splits[i]) / 250 * 9);
+            results[i] = true;
+            for (const char* block = splits[i]; block < splits[i + 1] && results[i]; )
+            {
+                if (cancelled())
+                {
+                    return;
+                }
+                const char* block_end = splits[i + 1] - block > ProgressBlockSize
+                    ? find_facet(block + ProgressBlockSize, block, splits[i + 1])
+                    : splits[i + 1];
+                results[i] = parse_ascii_facets(block, block_end, chunks[i]);
+                report_reading(bytes_parsed += block_end - block, size);
+                block = block_end;
+            }
         }
+    });
 
-        for (int i=0; i < 3; ++i)
+    if (fallback.isEmpty())
+    {
+        file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+    }
+
+    if (cancelled())
+    {
+        return NULL;
+    }
+
+    if (std::find(results.begin(), results.end(), false) != results.end())
+    {
+        emit error_bad_stl();
+        return NULL;
+    }
+
+    // Stitch the ranges back together, in file order
+    size_t float_count = 0;
+    for (auto const& chunk : chunks)
+    {
+        float_count += chunk.size();
+    }
+    std::vector<GLfloat> verts(float_count);
+    auto out = verts.begin();
+    for (auto& chunk : chunks)
+    {
+        out = std::copy(chunk.begin(), chunk.end(), out);
+        std::vector<GLfloat>().swap(chunk);
+    }
+
+    return build_mesh(uint32_t(float_count / 9), verts);
+}
+
+Mesh* Loader::read_stl_compressed()
+{
+    CompressedFileReader reader(filename);
+    if (!reader.open(QIODevice::ReadOnly))
+    {
+        debug( "+ Loader::read_stl_compressed: couldn't open '%s': %s\n", filename.toUtf8( ).data( ), reader.errorString( ).toUtf8( ).data( ) );
+        emit error_bad_stl();
+        return NULL;
+    }
+
+    if (is_ascii_stl(reader.peek(stl_head_length), &confusing_stl))
+    {
+        return read_stl_compressed_ascii(reader);
+    }
+
+    QByteArray header = reader.read(84);
+    if (header.size() != 84)
+    {
+        emit error_bad_stl();
+        return NULL;
+    }
+    const uint32_t tri_count = qFromLittleEndian<quint32>(header.constData() + 80);
+
+    // Only trust the triangle count enough to reserve memory up front if
+    // it is plausible for the compressed size (deflate tops out at ~1000:1)
+    std::vector<GLfloat> verts;
+    if (qint64(tri_count) * 50 / 1024 <= reader.compressedSize())
+    {
+        verts.reserve(size_t(tri_count) * 9);
+    }
+
+    // Decompress a block of whole facets at a time straight into the decoder
+    const uint32_t facets_per_block = 20000;
+    std::vector<uchar> block(facets_per_block * 50);
+    for (uint32_t decoded = 0; decoded < tri_count; )
+    {
+        if (cancelled())
+        {
+            return NULL;
+        }
+        const uint32_t count = std::min(facets_per_block, tri_count - decoded);
+        if (reader.read(reinterpret_cast<char*>(block.data()), qint64(count) * 50) != qint64(count) * 50)
+        {
+            emit error_bad_stl();
+            return NULL;
+        }
+        verts.resize(size_t(decoded + count) * 9);
+        decode_binary_triangles(block.data(), 0, count, verts.data() + size_t(decoded) * 9);
+        decoded += count;
+        report_reading(reader.compressedBytesConsumed(), reader.compressedSize());
+    }
+
+    // As with uncompressed files, the size must match the triangle count exactly
+    char extra;
+    if (reader.read(&extra, 1) != 0)
+    {
+        emit error_bad_stl();
+        return NULL;
+    }
+
+    if (confusing_stl)
+    {
+        emit warning_confusing_stl();
+    }
+
+    return build_mesh(tri_count, verts);
+}
+
+/*
+ *  Reads an ASCII stl from a stream a block at a time: everything up to the
+ *  last complete facet in the buffer is parsed into verts, and the tail is
+ *  carried over.  block_done is called after each block has been parsed
+ *  and returns false to stop.  An empty read is taken as the end of the
+ *  stream, so the caller checks for read errors afterwards.
+ */
+static bool read_ascii_blocks(QIODevice& device, std::vector<GLfloat>& verts, const std::function<bool()>& block_done)
+{
+    QByteArray pending;
+    bool skipped_solid_line = false;
+
+    for (;;)
+    {
+        const QByteArray block = device.read(ProgressBlockSize);
+        const bool at_end = block.isEmpty();
+        pending.append(block);
+
+        if (!skipped_solid_line)
         {
-            auto line = file.readLine().simplified().split(' ');
-            if (line[0] != "vertex")
+            const int eol = pending.indexOf('\n');
+            if (eol < 0 && !at_end)
             {
-                okay = false;
-                break;
+                continue;
             }
-            const float x = line[1].toFloat(&okay);
-            const float y = line[2].toFloat(&okay);
-            const float z = line[3].toFloat(&okay);
-            verts.push_back(Vertex(x, y, z));
+            pending.remove(0, eol < 0 ? pending.size() : eol + 1);
+            skipped_solid_line = true;
         }
-        if (!file.readLine().trimmed().startsWith("endloop") ||
-            !file.readLine().trimmed().startsWith("endfacet"))
+
+        int boundary = pending.size();
+        if (!at_end)
         {
-            okay = false;
-            break;
+            const int last = pending.lastIndexOf("endfacet");
+            if (last < 0)
+            {
+                continue;
+            }
+            boundary = last + 8;
+        }
+
+        if (!parse_ascii_facets(pending.constData(), pending.constData() + boundary, verts))
+        {
+            return false;
+        }
+        pending.remove(0, boundary);
+
+        if (!block_done())
+        {
+            return false;
+        }
+        if (at_end)
+        {
+            return true;
         }
-        tri_count++;
     }
+}
 
-    if (okay)
+Mesh* Loader::read_stl_compressed_ascii(CompressedFileReader& reader)
+{
+    std::vector<GLfloat> verts;
+    const bool parsed = read_ascii_blocks(reader, verts, [&]()
     {
-        return mesh_from_verts(tri_count, verts);
+        report_reading(reader.compressedBytesConsumed(), reader.compressedSize());
+        return !cancelled();
+    });
+    if (cancelled())
+    {
+        return NULL;
     }
-    else
+    if (!parsed || reader.hasError())
     {
         emit error_bad_stl();
         return NULL;
     }
+
+    return build_mesh(uint32_t(verts.size() / 9), verts);
 }
 
+bool Loader::stream_triangles(const TriangleFunction& add, const ProgressFunction& progress)
+{
+    QFile file(filename);
+    CompressedFileReader reader(filename);
+    const bool compressed = CompressedFileReader::detectFormat(filename) != CompressionFormat::None;
+    QIODevice& device = compressed ? static_cast<QIODevice&>(reader) : static_cast<QIODevice&>(file);
+    if (!device.open(QIODevice::ReadOnly))
+    {
+        debug( "+ Loader::stream_triangles: couldn't open '%s': %s\n", filename.toUtf8( ).data( ), device.errorString( ).toUtf8( ).data( ) );
+        return false;
+    }
+
+    // Progress is measured in bytes of the file on disk
+    auto read_so_far = [&]()
+    {
+        return compressed ? reader.compressedBytesConsumed() : file.pos();
+    };
+    const qint64 total = compressed ? reader.compressedSize() : file.size();
+
+    std::vector<GLfloat> verts;
+    if (is_ascii_stl(device.peek(stl_head_length)))
+    {
+        const bool parsed = read_ascii_blocks(device, verts, [&]()
+        {
+            add(verts.data(), verts.size() / 9);
+            verts.clear();
+            return !progress || progress(read_so_far(), total);
+        });
+        return parsed && !(compressed && reader.hasError());
+    }
+
+    const QByteArray header = device.read(84);
+    if (header.size() != 84)
+    {
+        return false;
+    }
+    const uint32_t tri_count = qFromLittleEndian<quint32>(header.constData() + 80);
+
+    const uint32_t facets_per_block = ProgressBlockSize / 50;
+    std::vector<uchar> block(facets_per_block * 50);
+    verts.resize(size_t(facets_per_block) * 9);
+    for (uint32_t decoded = 0; decoded < tri_count; )
+    {
+        const uint32_t count = std::min(facets_per_block, tri_count - decoded);
+        if (device.read(reinterpret_cast<char*>(block.data()), qint64(count) * 50) != qint64(count) * 50)
+        {
+            return false;
+        }
+        decode_binary_triangles(block.data(), 0, count, verts.data());
+        add(verts.data(), count);
+        decoded += count;
+
+        if (progress && !progress(read_so_far(), total))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -3,6 +3,8 @@
 
 #include "mesh.h"
 
+class CompressedFileReader;
+
 class Loader : public QThread
 {
     Q_OBJECT
@@ -10,17 +12,74 @@ public:
     Loader(QString const& filename, QObject* parent = nullptr);
     void run();
 
+    /*  Asks a running load to stop as soon as it can.  A cancelled load
+     *  emits nothing but finished(). */
+    void cancel() { requestInterruption(); }
+
+    /*  Hashes the model a block at a time, so that hashing can be cancelled */
+    QString hash_model();
+
+    /*  Does the work of run() on the calling thread, for use by other
+     *  background workers: returns the mesh, or nullptr if it couldn't be
+     *  read or the calling thread was interrupted.  Errors are still
+     *  signalled.  The model's hash can be passed in if already known. */
+    Mesh* load_mesh(QString model_hash = QString());
+
+    /*  Called with each block of triangles (nine floats apiece) as it is
+     *  read; the buffer is reused for the next block */
+    using TriangleFunction = std::function<void(const GLfloat* verts, size_t tri_count)>;
+    /*  Called with the bytes of the file read so far after each block;
+     *  returns false to stop reading */
+    using ProgressFunction = std::function<bool(qint64 done, qint64 total)>;
+
+    /*  Reads the file's triangles on the calling thread a block at a time,
+     *  without building a mesh or writing the mesh cache, for workers that
+     *  only need to look at each triangle once.  Returns false if the file
+     *  couldn't be read or progress asked to stop; no signals are sent. */
+    bool stream_triangles(const TriangleFunction& add, const ProgressFunction& progress);
+
+    /*  Number of bytes from the start of an stl that is_ascii_stl needs */
+    static const int stl_head_length = 1024;
+    /*  Tells an ASCII stl from a binary one by the start of the file: an
+     *  ASCII stl starts with "solid" and a name, then "facet" or "endsolid"
+     *  on the next line.  Sets confusing (if given) for a binary stl that
+     *  nevertheless starts with "solid". */
+    static bool is_ascii_stl(const QByteArray& head, bool* confusing = nullptr);
+
 protected:
+    /*  True once the thread doing the load has been asked to stop */
+    bool cancelled() const { return host_thread && host_thread->isInterruptionRequested(); }
+
     Mesh* load_stl();
 
-    /*  Reads an ASCII stl, starting from the start of the file*/
+    /*  Reads an ASCII stl by mapping it into memory and parsing it in parallel */
     Mesh* read_stl_ascii(QFile& file);
-    /*  Reads a binary stl, assuming we're at the end of the header */
+    /*  Reads a binary stl by mapping it into memory and decoding it in parallel */
     Mesh* read_stl_binary(QFile& file);
+    /*  Reads a gzip- or zstd-compressed stl, decoding it as it is
+     *  decompressed rather than unpacking it to a temporary file */
+    Mesh* read_stl_compressed();
+    Mesh* read_stl_compressed_ascii(CompressedFileReader& reader);
+
+    /*  Deduplicates a triangle soup, showing a preview first if it's large */
+    Mesh* build_mesh(uint32_t tri_count, std::vector<GLfloat>& verts);
+    /*  Attaches coarser versions of a large mesh for interactive display */
+    void add_levels_of_detail(Mesh* mesh);
+
+    /*  Emits reading(), but only when the percentage has moved on; safe to
+     *  call from the worker threads */
+    void report_reading(qint64 done, qint64 total);
 
 signals:
     void loaded_file(QString filename);
     void got_mesh(Mesh* m);
+    void got_preview(Mesh* m);
+
+    /*  Progress while the file is hashed, then while it is parsed */
+    void hashing(qint64 done, qint64 total);
+    void reading(qint64 done, qint64 total);
+    /*  Sent when parsing is finished and vertices are being merged */
+    void deduplicating();
 
     void error_bad_stl();
     void error_empty_mesh();
@@ -33,6 +92,15 @@ private:
     /*  Used to warn on binary STLs that begin with the word 'solid'" */
     bool confusing_stl;
 
+    /*  Thread the load is running on (this, unless load_mesh was called
+     *  directly) */
+    QThread* host_thread;
+
+    /*  Last percentage passed to reading(), and the bytes parsed so far
+     *  by the worker threads */
+    std::atomic<int> reading_percent;
+    std::atomic<qint64> bytes_parsed;
+
 };
 
 #endif // LOADER_H
@@ -1,4 +1,3 @@
-#include <magick/api.h>
 #include "pch.h"
 
 void _initializeOpenGL( ) {
@@ -11,7 +10,6 @@ void _initializeOpenGL( ) {
 
 int main( int argc, char* argv[] ) {
     _initializeOpenGL( );
-    InitializeMagick(argv[0]);
 
     return App( argc, argv ).exec( );
 }
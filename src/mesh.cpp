@@ -1,68 +1,211 @@
 #include "pch.h"
 
+#include <array>
+
 #include "mesh.h"
+#include "parallel.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
 Mesh::Mesh(std::vector<GLfloat>&& v, std::vector<GLuint>&& i)
-    : vertices(std::move(v)), indices(std::move(i))
+    : vertex_storage(std::move(v)), index_storage(std::move(i)),
+      vertices(vertex_storage.data()), vertex_float_count(vertex_storage.size()),
+      indices(index_storage.data()), index_total(index_storage.size())
+{
+    // Nothing to do here
+}
+
+Mesh::Mesh(QFile* file, const GLfloat* v, size_t v_count, const GLuint* i, size_t i_count)
+    : mapped_file(file),
+      vertices(v), vertex_float_count(v_count),
+      indices(i), index_total(i_count)
 {
     // Nothing to do here
 }
 
+Mesh::~Mesh()
+{
+    for (auto level : levels)
+    {
+        delete level;
+    }
+
+    // Closing the file also unmaps it
+    delete mapped_file;
+}
+
+void Mesh::compute_bounds() const
+{
+    for (size_t axis=0; axis < 3; ++axis)
+    {
+        lower[axis] = std::numeric_limits<float>::max();
+        upper[axis] = std::numeric_limits<float>::lowest();
+    }
+
+    for (size_t i=0; i + 2 < vertex_float_count; i += 3)
+    {
+        for (size_t axis=0; axis < 3; ++axis)
+        {
+            lower[axis] = std::min(lower[axis], vertices[i + axis]);
+            upper[axis] = std::max(upper[axis], vertices[i + axis]);
+        }
+    }
+    has_bounds = true;
+}
+
+void Mesh::set_bounds(const float l[3], const float u[3])
+{
+    std::copy(l, l + 3, lower);
+    std::copy(u, u + 3, upper);
+    has_bounds = true;
+}
+
 float Mesh::min(size_t start) const
 {
-    if (start >= vertices.size())
+    if (start >= vertex_float_count)
     {
         return -1;
     }
-    float v = vertices[start];
-    for (size_t i=start; i < vertices.size(); i += 3)
+    if (!has_bounds)
     {
-        v = fmin(v, vertices[i]);
+        compute_bounds();
     }
-    return v;
+    return lower[start % 3];
 }
 
 float Mesh::max(size_t start) const
 {
-    if (start >= vertices.size())
+    if (start >= vertex_float_count)
     {
         return 1;
     }
-    float v = vertices[start];
-    for (size_t i=start; i < vertices.size(); i += 3)
+    if (!has_bounds)
     {
-        v = fmax(v, vertices[i]);
+        compute_bounds();
     }
-    return v;
+    return upper[start % 3];
 }
 
-void Mesh::bounds( size_t& count, Coordinate& x, Coordinate& y, Coordinate& z ) {
-    float minX, minY, minZ;
-    float maxX, maxY, maxZ;
-    minX = minY = minZ = std::numeric_limits<float>::max( );
-    maxX = maxY = maxZ = std::numeric_limits<float>::min( );
-
-    size_t limit = count = vertices.size( );
-    for ( size_t i = 0; ( i + 2 ) < limit; i += 3 ) {
-        float x = vertices[i];
-        float y = vertices[i + 1];
-        float z = vertices[i + 2];
-        minX = std::min( x, minX );
-        minY = std::min( y, minY );
-        minZ = std::min( z, minZ );
-        maxX = std::max( x, maxX );
-        maxY = std::max( y, maxY );
-        maxZ = std::max( z, maxZ );
+void Mesh::bounds( size_t& count, Coordinate& x, Coordinate& y, Coordinate& z ) const {
+    if ( !has_bounds ) {
+        compute_bounds( );
+    }
+
+    count = vertex_float_count;
+    x = { lower[0], upper[0] };
+    y = { lower[1], upper[1] };
+    z = { lower[2], upper[2] };
+}
+
+const MeshStatistics& Mesh::statistics() const
+{
+    if (!has_statistics)
+    {
+        compute_statistics();
+    }
+    return stats;
+}
+
+void Mesh::compute_statistics() const
+{
+    const size_t vertex_count = vertex_float_count / 3;
+    const size_t triangle_count = index_total / 3;
+    const unsigned threads = triangle_count < 65536 ? 1 : hardware_threads();
+
+    // Bounds: each worker reduces a contiguous run of vertices.  The loop
+    // body is branch-free min/max so the compiler can vectorize it.
+    if (!has_bounds)
+    {
+        std::vector<std::array<float, 6>> partial_bounds(threads, {{
+            std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+            std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()
+        }});
+        const size_t vertex_chunk = std::max<size_t>(1, (vertex_count + threads - 1) / threads);
+        parallel_for(vertex_count, threads, [&](size_t first, size_t last)
+        {
+            float lo_x = std::numeric_limits<float>::max(),    lo_y = lo_x, lo_z = lo_x;
+            float hi_x = std::numeric_limits<float>::lowest(), hi_y = hi_x, hi_z = hi_x;
+            const GLfloat* v = vertices + first * 3;
+            for (size_t i = first; i < last; ++i, v += 3)
+            {
+                lo_x = std::min(lo_x, v[0]);  hi_x = std::max(hi_x, v[0]);
+                lo_y = std::min(lo_y, v[1]);  hi_y = std::max(hi_y, v[1]);
+                lo_z = std::min(lo_z, v[2]);  hi_z = std::max(hi_z, v[2]);
+            }
+            partial_bounds[first / vertex_chunk] = {{ lo_x, lo_y, lo_z, hi_x, hi_y, hi_z }};
+        });
+
+        for (size_t axis=0; axis < 3; ++axis)
+        {
+            lower[axis] = std::numeric_limits<float>::max();
+            upper[axis] = std::numeric_limits<float>::lowest();
+            for (auto const& partial : partial_bounds)
+            {
+                lower[axis] = std::min(lower[axis], partial[axis]);
+                upper[axis] = std::max(upper[axis], partial[axis + 3]);
+            }
+        }
+        has_bounds = true;
+    }
+
+    // Volume and area: sum the signed volumes of the tetrahedra formed by
+    // each triangle and the centre of the bounding box (which keeps the
+    // terms small and the sum accurate), and the triangle areas.
+    const double cx = (double(lower[0]) + upper[0]) / 2;
+    const double cy = (double(lower[1]) + upper[1]) / 2;
+    const double cz = (double(lower[2]) + upper[2]) / 2;
+
+    // Each run's sums go in the slot for its position in the mesh, not in
+    // the order the runs finish, so that they're always added up in the
+    // same order and the totals don't change from one call to the next.
+    // parallel_for hands out runs of this many triangles.
+    std::vector<std::array<double, 2>> partial_sums(threads, {{ 0.0, 0.0 }});
+    const size_t triangle_chunk = std::max<size_t>(1, (triangle_count + threads - 1) / threads);
+    parallel_for(triangle_count, threads, [&](size_t first, size_t last)
+    {
+        double volume = 0.0;
+        double area = 0.0;
+        for (size_t t = first; t < last; ++t)
+        {
+            const GLfloat* a = vertices + size_t(indices[t * 3    ]) * 3;
+            const GLfloat* b = vertices + size_t(indices[t * 3 + 1]) * 3;
+            const GLfloat* c = vertices + size_t(indices[t * 3 + 2]) * 3;
+
+            const double ax = a[0] - cx, ay = a[1] - cy, az = a[2] - cz;
+            const double bx = b[0] - cx, by = b[1] - cy, bz = b[2] - cz;
+            const double qx = c[0] - cx, qy = c[1] - cy, qz = c[2] - cz;
+
+            // b x c, for the triple product a . (b x c)
+            volume += ax * (by * qz - bz * qy) + ay * (bz * qx - bx * qz) + az * (bx * qy - by * qx);
+
+            // |(b - a) x (c - a)| is twice the triangle's area
+            const double ux = bx - ax, uy = by - ay, uz = bz - az;
+            const double wx = qx - ax, wy = qy - ay, wz = qz - az;
+            const double nx = uy * wz - uz * wy, ny = uz * wx - ux * wz, nz = ux * wy - uy * wx;
+            area += std::sqrt(nx * nx + ny * ny + nz * nz);
+        }
+        partial_sums[first / triangle_chunk] = {{ volume, area }};
+    });
+
+    double volume = 0.0;
+    double area = 0.0;
+    for (auto const& partial : partial_sums)
+    {
+        volume += partial[0];
+        area += partial[1];
     }
 
-    x = { minX, maxX };
-    y = { minY, maxY };
-    z = { minZ, maxZ };
+    stats.vertex_count = vertex_count;
+    stats.triangle_count = triangle_count;
+    stats.x = { lower[0], upper[0] };
+    stats.y = { lower[1], upper[1] };
+    stats.z = { lower[2], upper[2] };
+    stats.volume = std::fabs(volume) / 6.0;
+    stats.surface_area = area / 2.0;
+    has_statistics = true;
 }
 
 bool Mesh::empty() const
 {
-    return vertices.size() == 0;
+    return vertex_float_count == 0;
 }
@@ -3,11 +3,39 @@
 
 #include "coordinate.h"
 
+class QFile;
+
+/*
+ *  Summary measurements of a mesh, in model units (mm).  The volume is
+ *  only meaningful for closed, consistently wound meshes.
+ */
+struct MeshStatistics
+{
+    size_t vertex_count = 0;
+    size_t triangle_count = 0;
+    Coordinate x;
+    Coordinate y;
+    Coordinate z;
+    double volume = 0.0;
+    double surface_area = 0.0;
+};
+
 class Mesh
 {
 public:
     Mesh(std::vector<GLfloat>&& vertices, std::vector<GLuint>&& indices);
 
+    /*  Wraps vertex and index arrays that live in a memory-mapped file.
+     *  The mesh takes ownership of the file and unmaps it when destroyed. */
+    Mesh(QFile* mapped_file, const GLfloat* vertices, size_t vertex_float_count,
+         const GLuint* indices, size_t index_count);
+    ~Mesh();
+
+    /*  A mesh points into its own storage or a mapped file and owns its
+     *  levels of detail, so it can't be copied */
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
     float min(size_t start) const;
     float max(size_t start) const;
 
@@ -18,17 +46,52 @@ public:
     float ymax() const { return max(1); }
     float zmax() const { return max(2); }
 
-    void bounds( size_t& count, Coordinate& x, Coordinate& y, Coordinate& z );
+    void bounds( size_t& count, Coordinate& x, Coordinate& y, Coordinate& z ) const;
+
+    /*  Supplies bounds that are already known (e.g. from the mesh cache),
+     *  so that they don't have to be recomputed */
+    void set_bounds(const float lower[3], const float upper[3]);
+
+    size_t count( ) const { return vertex_float_count; }
 
-    size_t count( ) const { return vertices.size( ); }
+    /*  Computes bounds, volume and surface area in one parallel pass the
+     *  first time it's called; later calls return the cached result */
+    const MeshStatistics& statistics() const;
+
+    const GLfloat* vertex_data() const { return vertices; }
+    const GLuint* index_data() const { return indices; }
+    size_t index_count() const { return index_total; }
 
     bool empty() const;
 
+    size_t triangle_count() const { return index_total / 3; }
+
+    /*  Coarser versions of this mesh for interactive display, finest
+     *  first.  The mesh takes ownership of each level. */
+    void add_level_of_detail(Mesh* level) { levels.push_back(level); }
+    const std::vector<Mesh*>& levels_of_detail() const { return levels; }
+
 private:
-    std::vector<GLfloat> vertices;
-    std::vector<GLuint> indices;
+    void compute_bounds() const;
+    void compute_statistics() const;
+
+    std::vector<GLfloat> vertex_storage;
+    std::vector<GLuint> index_storage;
+    QFile* mapped_file = nullptr;
+
+    const GLfloat* vertices;
+    size_t vertex_float_count;
+    const GLuint* indices;
+    size_t index_total;
+
+    mutable bool has_bounds = false;
+    mutable float lower[3];
+    mutable float upper[3];
+
+    mutable bool has_statistics = false;
+    mutable MeshStatistics stats;
 
-    friend class GLMesh;
+    std::vector<Mesh*> levels;
 };
 
 #endif // MESH_H
@@ -0,0 +1,116 @@
+#include "pch.h"
+
+#include "meshcache.h"
+
+#include "mesh.h"
+#include "slicecache.h"
+
+namespace {
+
+    char     const MeshCacheMagic[8]   { 'L', 'F', 'M', 'E', 'S', 'H', '\r', '\n' };
+    uint32_t const MeshCacheVersion    { 1 };
+
+    struct MeshCacheHeader {
+        char     magic[8];
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t reserved;
+        float    lower[3];
+        float    upper[3];
+    };
+
+    static_assert( sizeof( MeshCacheHeader ) % sizeof( float ) == 0, "mesh cache header must keep the arrays that follow it aligned" );
+
+}
+
+QString MeshCache::cacheFilePath( QString const& modelHash ) {
+    return JobWorkingDirectoryPath % Slash % modelHash % QString { ".mesh" };
+}
+
+Mesh* MeshCache::load( QString const& modelHash ) {
+    QString const fileName { cacheFilePath( modelHash ) };
+    if ( !QFile::exists( fileName ) ) {
+        return nullptr;
+    }
+
+    auto file = new QFile { fileName };
+    uchar const* data { };
+    if ( file->open( QIODevice::ReadOnly ) && ( file->size( ) >= static_cast<qint64>( sizeof( MeshCacheHeader ) ) ) ) {
+        data = file->map( 0, file->size( ) );
+    }
+    if ( !data ) {
+        debug( "+ MeshCache::load: couldn't map cache file '%s': %s\n", fileName.toUtf8( ).data( ), file->errorString( ).toUtf8( ).data( ) );
+        delete file;
+        QFile::remove( fileName );
+        return nullptr;
+    }
+
+    auto header = reinterpret_cast<MeshCacheHeader const*>( data );
+    qint64 const expectedSize =
+        static_cast<qint64>( sizeof( MeshCacheHeader ) )
+        + static_cast<qint64>( header->vertexCount ) * 3 * sizeof( GLfloat )
+        + static_cast<qint64>( header->indexCount )      * sizeof( GLuint  );
+    if ( memcmp( header->magic, MeshCacheMagic, sizeof( MeshCacheMagic ) ) || ( header->version != MeshCacheVersion ) || ( file->size( ) != expectedSize ) ) {
+        debug( "+ MeshCache::load: cache file '%s' is stale or corrupt, discarding\n", fileName.toUtf8( ).data( ) );
+        delete file;
+        QFile::remove( fileName );
+        return nullptr;
+    }
+
+    auto vertices = reinterpret_cast<GLfloat const*>( data + sizeof( MeshCacheHeader ) );
+    auto indices  = reinterpret_cast<GLuint  const*>( vertices + static_cast<size_t>( header->vertexCount ) * 3 );
+
+    // A bad index would send the renderer and slicer past the vertex array,
+    // so the file is only trusted if every index is in range
+    if ( ( header->indexCount % 3 ) || std::any_of( indices, indices + header->indexCount, [ header ] ( GLuint const index ) { return index >= header->vertexCount; } ) ) {
+        debug( "+ MeshCache::load: cache file '%s' has indices out of range, discarding\n", fileName.toUtf8( ).data( ) );
+        delete file;
+        QFile::remove( fileName );
+        return nullptr;
+    }
+
+    auto mesh = new Mesh { file, vertices, static_cast<size_t>( header->vertexCount ) * 3, indices, header->indexCount };
+    mesh->set_bounds( header->lower, header->upper );
+
+    debug( "+ MeshCache::load: mapped %u vertices, %u indices from '%s'\n", header->vertexCount, header->indexCount, fileName.toUtf8( ).data( ) );
+    SliceCache::touch( fileName );
+    return mesh;
+}
+
+bool MeshCache::save( QString const& modelHash, Mesh const* mesh ) {
+    if ( !QDir { }.mkpath( JobWorkingDirectoryPath ) ) {
+        debug( "+ MeshCache::save: couldn't create directory '%s'\n", JobWorkingDirectoryPath.toUtf8( ).data( ) );
+        return false;
+    }
+
+    MeshCacheHeader header { };
+    memcpy( header.magic, MeshCacheMagic, sizeof( MeshCacheMagic ) );
+    header.version     = MeshCacheVersion;
+    header.vertexCount = static_cast<uint32_t>( mesh->count( ) / 3 );
+    header.indexCount  = static_cast<uint32_t>( mesh->index_count( ) );
+    for ( size_t axis = 0; axis < 3; ++axis ) {
+        header.lower[axis] = mesh->min( axis );
+        header.upper[axis] = mesh->max( axis );
+    }
+
+    // QSaveFile writes to a temporary file and renames it into place on commit, so
+    // a reader never sees a partially-written cache entry.
+    QSaveFile file { cacheFilePath( modelHash ) };
+    if ( !file.open( QIODevice::WriteOnly ) ) {
+        debug( "+ MeshCache::save: couldn't create cache file '%s': %s\n", file.fileName( ).toUtf8( ).data( ), file.errorString( ).toUtf8( ).data( ) );
+        return false;
+    }
+
+    file.write( reinterpret_cast<char const*>( &header ),               sizeof( header ) );
+    file.write( reinterpret_cast<char const*>( mesh->vertex_data( ) ), mesh->count( )       * sizeof( GLfloat ) );
+    file.write( reinterpret_cast<char const*>( mesh->index_data( ) ),  mesh->index_count( ) * sizeof( GLuint  ) );
+    if ( !file.commit( ) ) {
+        debug( "+ MeshCache::save: couldn't write cache file '%s': %s\n", file.fileName( ).toUtf8( ).data( ), file.errorString( ).toUtf8( ).data( ) );
+        return false;
+    }
+
+    // Counts against the slice cache's budget
+    SliceCache::update( file.fileName( ) );
+    return true;
+}
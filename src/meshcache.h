@@ -0,0 +1,31 @@
+#ifndef __MESHCACHE_H__
+#define __MESHCACHE_H__
+
+class Mesh;
+
+//
+// Persistent cache of deduplicated, indexed meshes, keyed by the hash of
+// the model file. Cached meshes live next to the slice directories in
+// JobWorkingDirectoryPath, under SliceCache's budget, and are memory-mapped
+// straight into Mesh.
+//
+// File layout (native byte order):
+//   MeshCacheHeader
+//   float  vertices[vertexCount * 3]
+//   uint32 indices[indexCount]
+//
+
+class MeshCache {
+
+public:
+
+    static QString cacheFilePath( QString const& modelHash );
+
+    // Returns nullptr if there is no usable cache entry for the hash.
+    static Mesh*   load( QString const& modelHash );
+
+    static bool    save( QString const& modelHash, Mesh const* mesh );
+
+};
+
+#endif // __MESHCACHE_H__
@@ -0,0 +1,143 @@
+#include "pch.h"
+
+#include "meshsimplifier.h"
+#include "mesh.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+MeshSimplifier::MeshSimplifier(const float lower[3], const float upper[3], unsigned resolution)
+{
+    resolution = std::max(1u, std::min(resolution, MaximumResolution));
+
+    float longest = 0;
+    for (int axis=0; axis < 3; ++axis)
+    {
+        longest = std::max(longest, upper[axis] - lower[axis]);
+    }
+    if (!(longest > 0))
+    {
+        longest = 1;
+    }
+
+    // Dimensions are at most resolution + 1 per axis, so with the cap on
+    // resolution a cluster index always fits in 21 bits.
+    inverse_cell_size = resolution / longest;
+    for (int axis=0; axis < 3; ++axis)
+    {
+        origin[axis] = lower[axis];
+        dims[axis] = std::min(unsigned((upper[axis] - lower[axis]) * inverse_cell_size) + 1, resolution + 1);
+    }
+    cells.assign(size_t(dims[0]) * dims[1] * dims[2], 0);
+}
+
+GLuint MeshSimplifier::cell_of(const GLfloat* v) const
+{
+    unsigned c[3];
+    for (int axis=0; axis < 3; ++axis)
+    {
+        const float f = (v[axis] - origin[axis]) * inverse_cell_size;
+        c[axis] = f > 0 ? std::min(unsigned(f), dims[axis] - 1) : 0;
+    }
+    return (c[2] * dims[1] + c[1]) * dims[0] + c[0];
+}
+
+GLuint MeshSimplifier::cluster_of(const GLfloat* v)
+{
+    GLuint& cell = cells[cell_of(v)];
+    if (!cell)
+    {
+        sums.insert(sums.end(), { 0.0, 0.0, 0.0 });
+        counts.push_back(0);
+        cell = GLuint(counts.size());
+    }
+
+    const GLuint cluster = cell - 1;
+    sums[cluster * 3    ] += v[0];
+    sums[cluster * 3 + 1] += v[1];
+    sums[cluster * 3 + 2] += v[2];
+    ++counts[cluster];
+    return cluster;
+}
+
+void MeshSimplifier::add_indexed_triangle(GLuint a, GLuint b, GLuint c)
+{
+    if (a == b || b == c || c == a)
+    {
+        return;
+    }
+
+    // Rotate so that the smallest index comes first; this keeps the
+    // winding, so the two faces of a thin wall are both kept.
+    if (b < a && b < c)
+    {
+        std::tie(a, b, c) = std::make_tuple(b, c, a);
+    }
+    else if (c < a && c < b)
+    {
+        std::tie(a, b, c) = std::make_tuple(c, a, b);
+    }
+
+    const uint64_t key = (uint64_t(a) << 42) | (uint64_t(b) << 21) | uint64_t(c);
+    if (triangles.insert(key).second)
+    {
+        indices.insert(indices.end(), { a, b, c });
+    }
+}
+
+void MeshSimplifier::add_triangle(const GLfloat* a, const GLfloat* b, const GLfloat* c)
+{
+    add_indexed_triangle(cluster_of(a), cluster_of(b), cluster_of(c));
+}
+
+void MeshSimplifier::add_triangle_soup(const GLfloat* verts, size_t tri_count, size_t stride)
+{
+    for (size_t t=0; t < tri_count; t += stride)
+    {
+        const GLfloat* v = verts + t * 9;
+        add_triangle(v, v + 3, v + 6);
+    }
+}
+
+Mesh* MeshSimplifier::build()
+{
+    std::vector<GLfloat> vertices(counts.size() * 3);
+    for (size_t i=0; i < counts.size(); ++i)
+    {
+        for (int axis=0; axis < 3; ++axis)
+        {
+            vertices[i * 3 + axis] = GLfloat(sums[i * 3 + axis] / counts[i]);
+        }
+    }
+
+    // Vertices that only belonged to collapsed triangles are left in; they
+    // are never referenced, so they cost a few bytes and nothing else.
+    std::vector<GLuint>().swap(cells);
+    std::vector<double>().swap(sums);
+    std::vector<GLuint>().swap(counts);
+    std::unordered_set<uint64_t>().swap(triangles);
+
+    return new Mesh(std::move(vertices), std::move(indices));
+}
+
+Mesh* MeshSimplifier::simplify(const Mesh& mesh, unsigned resolution)
+{
+    const float lower[3] { mesh.xmin(), mesh.ymin(), mesh.zmin() };
+    const float upper[3] { mesh.xmax(), mesh.ymax(), mesh.zmax() };
+    MeshSimplifier simplifier(lower, upper, resolution);
+
+    // Cluster each unique vertex once, then remap the triangles
+    const GLfloat* vertices = mesh.vertex_data();
+    std::vector<GLuint> clusters(mesh.count() / 3);
+    for (size_t i=0; i < clusters.size(); ++i)
+    {
+        clusters[i] = simplifier.cluster_of(vertices + i * 3);
+    }
+
+    const GLuint* indices = mesh.index_data();
+    for (size_t i=0; i + 2 < mesh.index_count(); i += 3)
+    {
+        simplifier.add_indexed_triangle(clusters[indices[i]], clusters[indices[i + 1]], clusters[indices[i + 2]]);
+    }
+
+    return simplifier.build();
+}
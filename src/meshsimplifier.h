@@ -0,0 +1,55 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <unordered_set>
+
+class Mesh;
+
+/*
+ *  Builds a coarse approximation of a mesh by vertex clustering: space is
+ *  divided into a grid of cubic cells, every vertex is replaced by the
+ *  average of the vertices that fall into its cell, and triangles that
+ *  collapse (or duplicate another triangle) are dropped.
+ *
+ *  This is not shape-preserving in any strict sense, but it is a single
+ *  linear pass, which is what the preview needs.
+ */
+class MeshSimplifier
+{
+public:
+    /*  resolution is the number of cells along the longest axis of the
+     *  bounding box, and is capped at MaximumResolution */
+    MeshSimplifier(const float lower[3], const float upper[3], unsigned resolution);
+
+    void add_triangle(const GLfloat* a, const GLfloat* b, const GLfloat* c);
+
+    /*  Adds every stride'th triangle of a triangle soup */
+    void add_triangle_soup(const GLfloat* verts, size_t tri_count, size_t stride = 1);
+
+    size_t triangle_count() const { return indices.size() / 3; }
+
+    Mesh* build();
+
+    /*  Returns a simplified copy of an indexed mesh */
+    static Mesh* simplify(const Mesh& mesh, unsigned resolution);
+
+    static const unsigned MaximumResolution = 127;
+
+private:
+    GLuint cell_of(const GLfloat* v) const;
+    GLuint cluster_of(const GLfloat* v);
+    void add_indexed_triangle(GLuint a, GLuint b, GLuint c);
+
+    float origin[3];
+    float inverse_cell_size;
+    unsigned dims[3];
+
+    // Dense grid of cluster index + 1 (zero marks an empty cell)
+    std::vector<GLuint> cells;
+    std::vector<double> sums;
+    std::vector<GLuint> counts;
+    std::vector<GLuint> indices;
+    std::unordered_set<uint64_t> triangles;
+};
+
+#endif // MESHSIMPLIFIER_H
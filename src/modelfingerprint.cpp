@@ -0,0 +1,323 @@
+#include "pch.h"
+
+#include "modelfingerprint.h"
+
+namespace {
+
+    QString const FingerprintIndexFileName { "model-fingerprints.json" };
+
+    // Large reads keep the disk streaming
+    qint64  const ReadBlockSize            { 4 << 20 };
+
+    // Entries beyond this many, least recently used first, are forgotten
+    int     const MaximumIndexEntries      { 1000 };
+
+    // Last-used times are written out this long after the first change, so
+    // that loading a batch of models costs one write
+    int     const FingerprintSaveDelay     { 5000 };
+
+    uint64_t const Prime1 { 11400714785074694791ULL };
+    uint64_t const Prime2 { 14029467366897019727ULL };
+    uint64_t const Prime3 {  1609587929392839161ULL };
+    uint64_t const Prime4 {  9650029242287828579ULL };
+    uint64_t const Prime5 {  2870177450012600261ULL };
+
+    inline uint64_t rotateLeft( uint64_t const value, int const bits ) {
+        return ( value << bits ) | ( value >> ( 64 - bits ) );
+    }
+
+    inline uint64_t read64( uchar const* p ) {
+        uint64_t value;
+        memcpy( &value, p, sizeof( value ) );
+        return value;
+    }
+
+    inline uint32_t read32( uchar const* p ) {
+        uint32_t value;
+        memcpy( &value, p, sizeof( value ) );
+        return value;
+    }
+
+    inline uint64_t xxhRound( uint64_t accumulator, uint64_t const input ) {
+        accumulator += input * Prime2;
+        accumulator  = rotateLeft( accumulator, 31 );
+        return accumulator * Prime1;
+    }
+
+    inline uint64_t xxhMergeRound( uint64_t accumulator, uint64_t const value ) {
+        accumulator ^= xxhRound( 0, value );
+        return accumulator * Prime1 + Prime4;
+    }
+
+    // XXH64, fed a block at a time. Assumes a little-endian machine.
+    class Xxh64 {
+
+    public:
+
+        Xxh64( uint64_t const seed ): _seed { seed } {
+            _lanes[0] = seed + Prime1 + Prime2;
+            _lanes[1] = seed + Prime2;
+            _lanes[2] = seed;
+            _lanes[3] = seed - Prime1;
+        }
+
+        void add( uchar const* data, size_t length ) {
+            _total += length;
+
+            if ( _buffered + length < sizeof( _buffer ) ) {
+                memcpy( _buffer + _buffered, data, length );
+                _buffered += length;
+                return;
+            }
+            if ( _buffered ) {
+                size_t const fill = sizeof( _buffer ) - _buffered;
+                memcpy( _buffer + _buffered, data, fill );
+                _stripe( _buffer );
+                data     += fill;
+                length   -= fill;
+                _buffered = 0;
+            }
+            while ( length >= sizeof( _buffer ) ) {
+                _stripe( data );
+                data   += sizeof( _buffer );
+                length -= sizeof( _buffer );
+            }
+            memcpy( _buffer, data, length );
+            _buffered = length;
+        }
+
+        uint64_t result( ) const {
+            uint64_t hash;
+            if ( _total >= sizeof( _buffer ) ) {
+                hash = rotateLeft( _lanes[0], 1 ) + rotateLeft( _lanes[1], 7 ) + rotateLeft( _lanes[2], 12 ) + rotateLeft( _lanes[3], 18 );
+                for ( auto const lane : _lanes ) {
+                    hash = xxhMergeRound( hash, lane );
+                }
+            } else {
+                hash = _seed + Prime5;
+            }
+            hash += _total;
+
+            size_t n = 0;
+            for ( ; n + 8 <= _buffered; n += 8 ) {
+                hash ^= xxhRound( 0, read64( _buffer + n ) );
+                hash  = rotateLeft( hash, 27 ) * Prime1 + Prime4;
+            }
+            if ( n + 4 <= _buffered ) {
+                hash ^= read32( _buffer + n ) * Prime1;
+                hash  = rotateLeft( hash, 23 ) * Prime2 + Prime3;
+                n += 4;
+            }
+            for ( ; n < _buffered; ++n ) {
+                hash ^= _buffer[n] * Prime5;
+                hash  = rotateLeft( hash, 11 ) * Prime1;
+            }
+
+            hash ^= hash >> 33;
+            hash *= Prime2;
+            hash ^= hash >> 29;
+            hash *= Prime3;
+            hash ^= hash >> 32;
+            return hash;
+        }
+
+    private:
+
+        uint64_t _seed;
+        uint64_t _lanes[4];
+        uint64_t _total    { };
+        uchar    _buffer[32];
+        size_t   _buffered { };
+
+        void _stripe( uchar const* p ) {
+            _lanes[0] = xxhRound( _lanes[0], read64( p      ) );
+            _lanes[1] = xxhRound( _lanes[1], read64( p +  8 ) );
+            _lanes[2] = xxhRound( _lanes[2], read64( p + 16 ) );
+            _lanes[3] = xxhRound( _lanes[3], read64( p + 24 ) );
+        }
+
+    };
+
+    class FingerprintEntry {
+
+    public:
+
+        QString fingerprint;
+        qint64  lastUsed { }; // ms since the epoch
+
+    };
+
+    QMutex                           indexLock;
+    QHash<QString, FingerprintEntry> entries;
+    bool                             loaded        { };
+    bool                             dirty         { };
+    bool                             saveScheduled { };
+
+    // Any change to the file changes its size or modification time; a
+    // replaced file has a new inode.
+    QString fileKey( QString const& fileName ) {
+        struct stat info;
+        if ( ::stat( fileName.toUtf8( ).data( ), &info ) != 0 ) {
+            return { };
+        }
+
+        qint64 const modified = static_cast<qint64>( info.st_mtim.tv_sec ) * 1000000000LL + info.st_mtim.tv_nsec;
+        return QString { "%1:%2:%3:%4" }
+            .arg( static_cast<qulonglong>( info.st_dev ) )
+            .arg( static_cast<qulonglong>( info.st_ino ) )
+            .arg( static_cast<qlonglong>( info.st_size ) )
+            .arg( modified );
+    }
+
+    // The functions below are called with indexLock held.
+
+    void load( ) {
+        if ( loaded ) {
+            return;
+        }
+        loaded = true;
+
+        QFile jsonFile { JobWorkingDirectoryPath % Slash % FingerprintIndexFileName };
+        if ( !jsonFile.open( QIODevice::ReadOnly ) ) {
+            return;
+        }
+
+        QJsonParseError parseError;
+        QJsonDocument const jsonDocument { QJsonDocument::fromJson( jsonFile.readAll( ), &parseError ) };
+        if ( jsonDocument.isNull( ) ) {
+            debug( "+ ModelFingerprint::load: error parsing fingerprint index: %s\n", parseError.errorString( ).toUtf8( ).data( ) );
+            return;
+        }
+
+        QJsonObject const root { jsonDocument.object( ) };
+        for ( auto iter = root.constBegin( ); iter != root.constEnd( ); ++iter ) {
+            QJsonObject const entry { iter.value( ).toObject( ) };
+
+            FingerprintEntry fingerprintEntry;
+            fingerprintEntry.fingerprint = entry.value( "fingerprint" ).toString( );
+            fingerprintEntry.lastUsed    = static_cast<qint64>( entry.value( "used" ).toDouble( ) );
+            if ( !fingerprintEntry.fingerprint.isEmpty( ) ) {
+                entries.insert( iter.key( ), fingerprintEntry );
+            }
+        }
+    }
+
+    void save( ) {
+        dirty = false;
+
+        if ( entries.count( ) > MaximumIndexEntries ) {
+            QList<QString> keys { entries.keys( ) };
+            std::sort( keys.begin( ), keys.end( ), [] ( QString const& a, QString const& b ) {
+                return entries[a].lastUsed > entries[b].lastUsed;
+            } );
+            for ( int n = MaximumIndexEntries; n < keys.count( ); ++n ) {
+                entries.remove( keys[n] );
+            }
+        }
+
+        QJsonObject root;
+        for ( auto iter = entries.constBegin( ); iter != entries.constEnd( ); ++iter ) {
+            root.insert( iter.key( ), QJsonObject {
+                { "fingerprint", iter.value( ).fingerprint                      },
+                { "used",        static_cast<double>( iter.value( ).lastUsed ) },
+            } );
+        }
+
+        QSaveFile jsonFile { JobWorkingDirectoryPath % Slash % FingerprintIndexFileName };
+        if ( !QDir { }.mkpath( JobWorkingDirectoryPath ) || !jsonFile.open( QIODevice::WriteOnly ) ) {
+            debug( "+ ModelFingerprint::save: couldn't create '%s'\n", jsonFile.fileName( ).toUtf8( ).data( ) );
+            return;
+        }
+        jsonFile.write( QJsonDocument { root }.toJson( QJsonDocument::Compact ) );
+        jsonFile.commit( );
+    }
+
+    // Writes the index out a little later, on the GUI thread
+    void scheduleSave( ) {
+        dirty = true;
+        if ( saveScheduled || !QCoreApplication::instance( ) ) {
+            return;
+        }
+        saveScheduled = true;
+
+        QMetaObject::invokeMethod( QCoreApplication::instance( ), [] ( ) {
+            QTimer::singleShot( FingerprintSaveDelay, QCoreApplication::instance( ), [] ( ) {
+                ModelFingerprint::flush( );
+            } );
+        }, Qt::QueuedConnection );
+    }
+
+}
+
+QString ModelFingerprint::cachedFingerprint( QString const& fileName ) {
+    QString const key { fileKey( fileName ) };
+    if ( key.isEmpty( ) ) {
+        return { };
+    }
+
+    QMutexLocker locker { &indexLock };
+    load( );
+    return entries.value( key ).fingerprint;
+}
+
+QString ModelFingerprint::fingerprint( QString const& fileName, ProgressFunction progress ) {
+    QString const key { fileKey( fileName ) };
+    if ( key.isEmpty( ) ) {
+        debug( "+ ModelFingerprint::fingerprint: couldn't stat file '%s'\n", fileName.toUtf8( ).data( ) );
+        return { };
+    }
+
+    {
+        QMutexLocker locker { &indexLock };
+        load( );
+
+        auto const iter = entries.find( key );
+        if ( iter != entries.end( ) ) {
+            // Kept up to date, or a model used every day would still be
+            // pruned by when it was first fingerprinted
+            iter->lastUsed = QDateTime::currentMSecsSinceEpoch( );
+            scheduleSave( );
+            return iter->fingerprint;
+        }
+    }
+
+    QFile file { fileName };
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        debug( "+ ModelFingerprint::fingerprint: couldn't open file '%s'\n", fileName.toUtf8( ).data( ) );
+        return { };
+    }
+
+    qint64 const total = file.size( );
+    Xxh64 hash { 0 };
+    QByteArray block { static_cast<int>( ReadBlockSize ), Qt::Uninitialized };
+    qint64 done = 0;
+    qint64 length;
+    while ( ( length = file.read( block.data( ), ReadBlockSize ) ) > 0 ) {
+        hash.add( reinterpret_cast<uchar const*>( block.constData( ) ), static_cast<size_t>( length ) );
+        done += length;
+        if ( progress && !progress( done, total ) ) {
+            return { };
+        }
+    }
+    if ( length < 0 ) {
+        debug( "+ ModelFingerprint::fingerprint: couldn't read file '%s': %s\n", fileName.toUtf8( ).data( ), file.errorString( ).toUtf8( ).data( ) );
+        return { };
+    }
+
+    QString const fingerprint { QString::number( hash.result( ), 16 ).rightJustified( 16, DigitZero ) };
+    debug( "+ ModelFingerprint::fingerprint: '%s': %s\n", fileName.toUtf8( ).data( ), fingerprint.toUtf8( ).data( ) );
+
+    QMutexLocker locker { &indexLock };
+    entries.insert( key, { fingerprint, QDateTime::currentMSecsSinceEpoch( ) } );
+    // A new fingerprint cost a full read, so it's written right away
+    save( );
+    return fingerprint;
+}
+
+void ModelFingerprint::flush( ) {
+    QMutexLocker locker { &indexLock };
+    saveScheduled = false;
+    if ( dirty ) {
+        save( );
+    }
+}
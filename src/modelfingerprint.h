@@ -0,0 +1,38 @@
+#ifndef __MODELFINGERPRINT_H__
+#define __MODELFINGERPRINT_H__
+
+//
+// Identifies a model file by its contents, for naming slice directories and
+// cache files. The fingerprint is XXH64 of the whole file, as 16 hex digits;
+// it isn't meant to resist tampering, only to tell models apart, and reads
+// as fast as the disk can deliver.
+//
+// Fingerprints are remembered by the file's device, inode, size and
+// modification time, in an index in JobWorkingDirectoryPath that survives
+// restarts, so a file that hasn't changed is never read twice.
+//
+// Safe to call from any thread.
+//
+
+class ModelFingerprint {
+
+public:
+
+    // Called as the file is read; returns false to give up.
+    using ProgressFunction = std::function<bool( qint64 const done, qint64 const total )>;
+
+    // Returns an empty string if the file can't be read, or reading was
+    // given up.
+    static QString fingerprint( QString const& fileName, ProgressFunction progress = nullptr );
+
+    // Returns the remembered fingerprint, or an empty string if the file
+    // hasn't been fingerprinted since it last changed.
+    static QString cachedFingerprint( QString const& fileName );
+
+    // Writes the index out now if it has changed. Otherwise last-used times
+    // are written a few seconds after they change.
+    static void flush( );
+
+};
+
+#endif // __MODELFINGERPRINT_H__
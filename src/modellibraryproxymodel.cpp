@@ -0,0 +1,94 @@
+#include "pch.h"
+
+#include "modellibraryproxymodel.h"
+
+#include "modelmetadataindex.h"
+#include "thumbnailrenderer.h"
+
+ModelLibraryProxyModel::ModelLibraryProxyModel( QFileSystemModel* fsModel, ModelMetadataIndex* metadataIndex, ThumbnailRenderer* thumbnailRenderer, QObject* parent ):
+    QIdentityProxyModel ( parent            ),
+    _fsModel            ( fsModel           ),
+    _metadataIndex      ( metadataIndex     ),
+    _thumbnailRenderer  ( thumbnailRenderer )
+{
+    setSourceModel( _fsModel );
+    QObject::connect( _metadataIndex, &ModelMetadataIndex::metadataReady, this, &ModelLibraryProxyModel::metadataIndex_metadataReady );
+    if ( _thumbnailRenderer ) {
+        QObject::connect( _thumbnailRenderer, &ThumbnailRenderer::thumbnailReady, this, &ModelLibraryProxyModel::thumbnailRenderer_thumbnailReady );
+    }
+}
+
+ModelLibraryProxyModel::~ModelLibraryProxyModel( ) {
+    /*empty*/
+}
+
+QModelIndex ModelLibraryProxyModel::indexForPath( QString const& path ) const {
+    return mapFromSource( _fsModel->index( path ) );
+}
+
+QVariant ModelLibraryProxyModel::data( QModelIndex const& index, int role ) const {
+    if ( !index.isValid( ) || ( ( role != Qt::DisplayRole ) && ( role != Qt::DecorationRole ) ) ) {
+        return QIdentityProxyModel::data( index, role );
+    }
+
+    QModelIndex const sourceIndex { mapToSource( index ) };
+    QString     const fileName    { _fsModel->filePath( sourceIndex ) };
+    if ( _fsModel->isDir( sourceIndex ) || !ModelMetadataIndex::isModelFileName( fileName ) ) {
+        return QIdentityProxyModel::data( index, role );
+    }
+    QDateTime const lastModified { _fsModel->lastModified( sourceIndex ) };
+
+    if ( role == Qt::DecorationRole ) {
+        if ( _thumbnailRenderer ) {
+            QImage const image { _thumbnailRenderer->thumbnail( fileName, lastModified ) };
+            if ( !image.isNull( ) ) {
+                return QPixmap::fromImage( image );
+            }
+
+            // The thumbnail is asked for once the model's bounds are known
+            auto const metadata = _metadataIndex->lookup( fileName, _fsModel->size( sourceIndex ), lastModified );
+            if ( metadata && metadata->valid ) {
+                _thumbnailRenderer->request( fileName, lastModified, *metadata );
+            }
+        }
+        return QIdentityProxyModel::data( index, role );
+    }
+
+    // Qt::DisplayRole: the file name, with the model's size underneath once it's known
+    QString const name { QIdentityProxyModel::data( index, role ).toString( ) };
+    auto const metadata = _metadataIndex->lookup( fileName, _fsModel->size( sourceIndex ), lastModified );
+    if ( !metadata ) {
+        return name;
+    }
+    if ( !metadata->valid ) {
+        return name % QString { "\nNot a readable STL file" };
+    }
+
+    QString const dimensions { QString { "%1 × %2 × %3 mm" }
+        .arg( metadata->x.size, 0, 'f', 1 )
+        .arg( metadata->y.size, 0, 'f', 1 )
+        .arg( metadata->z.size, 0, 'f', 1 ) };
+    return name % QString { "\n" } % dimensions % ( metadata->fitsPrinter( ) ? QString { } : QString { ", too large to print" } );
+}
+
+void ModelLibraryProxyModel::_rowChanged( QString const& fileName, int const role ) {
+    // Looking up a path makes QFileSystemModel start watching it, so leave
+    // alone paths that belong to some other model
+    if ( !fileName.startsWith( _fsModel->rootPath( ) % Slash ) ) {
+        return;
+    }
+
+    QModelIndex const index { indexForPath( fileName ) };
+    if ( index.isValid( ) ) {
+        emit dataChanged( index, index, { role } );
+    }
+}
+
+void ModelLibraryProxyModel::metadataIndex_metadataReady( QString const& fileName ) {
+    _rowChanged( fileName, Qt::DisplayRole    );
+    _rowChanged( fileName, Qt::DecorationRole );
+}
+
+void ModelLibraryProxyModel::thumbnailRenderer_thumbnailReady( QString const& fileName ) {
+    _rowChanged( fileName, Qt::DecorationRole );
+}
@@ -0,0 +1,56 @@
+#ifndef __MODELLIBRARYPROXYMODEL_H__
+#define __MODELLIBRARYPROXYMODEL_H__
+
+#include <QtCore>
+#include <QtWidgets>
+
+class ModelMetadataIndex;
+class ThumbnailRenderer;
+
+//
+// Passes a QFileSystemModel through, except that model files are shown
+// with their dimensions from a ModelMetadataIndex, and decorated with
+// thumbnails from a ThumbnailRenderer if one is given. Both are only
+// requested for rows the view actually asks about, so scrolling through a
+// large library deals with what's on screen first. Use
+// QFileSystemModel::FileNameRole, not the display text, for file names.
+//
+
+class ModelLibraryProxyModel: public QIdentityProxyModel {
+
+    Q_OBJECT
+
+public:
+
+    ModelLibraryProxyModel( QFileSystemModel* fsModel, ModelMetadataIndex* metadataIndex, ThumbnailRenderer* thumbnailRenderer, QObject* parent = nullptr );
+    virtual ~ModelLibraryProxyModel( ) override;
+
+    // Equivalent of QFileSystemModel::index( path ) for this model.
+    QModelIndex indexForPath( QString const& path ) const;
+
+    virtual QVariant data( QModelIndex const& index, int role = Qt::DisplayRole ) const override;
+
+protected:
+
+private:
+
+    QFileSystemModel*   _fsModel;
+    ModelMetadataIndex* _metadataIndex;
+    ThumbnailRenderer*  _thumbnailRenderer;
+
+    void _rowChanged( QString const& fileName, int const role );
+
+signals:
+
+public slots:
+
+protected slots:
+
+private slots:
+
+    void metadataIndex_metadataReady( QString const& fileName );
+    void thumbnailRenderer_thumbnailReady( QString const& fileName );
+
+};
+
+#endif // __MODELLIBRARYPROXYMODEL_H__
@@ -0,0 +1,244 @@
+#include "pch.h"
+
+#include "modelmetadataindex.h"
+
+#include "compressedfilereader.h"
+#include "loader.h"
+
+namespace {
+
+    QString const MetadataIndexFileName { "model-metadata.json" };
+
+    // Entries beyond this many, least recently used first, are forgotten
+    int     const MaximumIndexEntries   { 5000 };
+
+    class BoundsAccumulator {
+
+    public:
+
+        void add( float const x, float const y, float const z ) {
+            lower[0] = std::min( lower[0], x ); upper[0] = std::max( upper[0], x );
+            lower[1] = std::min( lower[1], y ); upper[1] = std::max( upper[1], y );
+            lower[2] = std::min( lower[2], z ); upper[2] = std::max( upper[2], z );
+        }
+
+        void store( ModelMetadata& metadata ) const {
+            if ( metadata.triangleCount ) {
+                metadata.x = { lower[0], upper[0] };
+                metadata.y = { lower[1], upper[1] };
+                metadata.z = { lower[2], upper[2] };
+            }
+        }
+
+    private:
+
+        float lower[3] { std::numeric_limits<float>::max( ),    std::numeric_limits<float>::max( ),    std::numeric_limits<float>::max( )    };
+        float upper[3] { std::numeric_limits<float>::lowest( ), std::numeric_limits<float>::lowest( ), std::numeric_limits<float>::lowest( ) };
+
+    };
+
+    bool isInterrupted( ) {
+        return QThread::currentThread( )->isInterruptionRequested( );
+    }
+
+    QJsonArray toJsonArray( double const a, double const b, double const c ) {
+        return QJsonArray { a, b, c };
+    }
+
+}
+
+bool ModelMetadata::fitsPrinter( ) const {
+    return ( x.size <= PrinterMaximumX ) && ( y.size <= PrinterMaximumY ) && ( z.size <= PrinterMaximumZ );
+}
+
+ModelMetadataIndex::ModelMetadataIndex( QObject* parent ): QObject( parent ) {
+    _load( );
+}
+
+ModelMetadataIndex::~ModelMetadataIndex( ) {
+    if ( _thread ) {
+        QObject::disconnect( _thread, nullptr, this, nullptr );
+        _thread->requestInterruption( );
+        _thread->wait( );
+    }
+    _save( );
+}
+
+bool ModelMetadataIndex::isModelFileName( QString const& fileName ) {
+    return fileName.endsWith( ".stl", Qt::CaseInsensitive ) || ( CompressedFileReader::isCompressedFileName( fileName ) && fileName.contains( ".stl.", Qt::CaseInsensitive ) );
+}
+
+ModelMetadata ModelMetadataIndex::readMetadata( QString const& fileName ) {
+    QFileInfo const info { fileName };
+    ModelMetadata metadata;
+    metadata.size         = info.size( );
+    metadata.lastModified = info.lastModified( );
+
+    // Loader reads the file, compressed or not, the same way it does when
+    // the model is opened; only the bounds are kept
+    BoundsAccumulator bounds;
+    Loader loader { fileName };
+    metadata.valid = loader.stream_triangles( [ &bounds, &metadata ] ( GLfloat const* verts, size_t const count ) {
+        for ( size_t i = 0; i < count * 3; ++i, verts += 3 ) {
+            bounds.add( verts[0], verts[1], verts[2] );
+        }
+        metadata.triangleCount += count;
+    }, [ ] ( qint64, qint64 ) {
+        return !isInterrupted( );
+    } );
+    bounds.store( metadata );
+    return metadata;
+}
+
+ModelMetadata const* ModelMetadataIndex::lookup( QString const& fileName, qint64 const size, QDateTime const& lastModified ) {
+    auto const iter = _entries.constFind( fileName );
+    if ( ( iter != _entries.constEnd( ) ) && ( iter->size == size ) && ( iter->lastModified == lastModified ) ) {
+        _lastUsed[fileName] = QDateTime::currentMSecsSinceEpoch( );
+        return &*iter;
+    }
+
+    _enqueue( fileName );
+    return nullptr;
+}
+
+void ModelMetadataIndex::indexDirectory( QString const& path ) {
+    for ( auto const& info : QDir { path }.entryInfoList( QDir::Files ) ) {
+        if ( !isModelFileName( info.fileName( ) ) ) {
+            continue;
+        }
+
+        auto const iter = _entries.constFind( info.absoluteFilePath( ) );
+        if ( ( iter == _entries.constEnd( ) ) || ( iter->size != info.size( ) ) || ( iter->lastModified != info.lastModified( ) ) ) {
+            _enqueue( info.absoluteFilePath( ) );
+        } else {
+            _lastUsed[info.absoluteFilePath( )] = QDateTime::currentMSecsSinceEpoch( );
+        }
+    }
+}
+
+void ModelMetadataIndex::_enqueue( QString const& fileName ) {
+    if ( !_queue.contains( fileName ) ) {
+        _queue.append( fileName );
+        _startNext( );
+    }
+}
+
+void ModelMetadataIndex::_startNext( ) {
+    if ( _thread || _queue.isEmpty( ) ) {
+        if ( !_thread && _dirty ) {
+            _save( );
+        }
+        return;
+    }
+
+    // Hand the whole queue to the worker; anything queued meanwhile waits
+    // for the next batch
+    QStringList const fileNames { _queue };
+    _thread = QThread::create( std::bind( &ModelMetadataIndex::_index, this, fileNames ) );
+    QObject::connect( _thread, &QThread::finished, _thread, &QThread::deleteLater );
+    QObject::connect( _thread, &QThread::finished, this, [ this, fileNames ] ( ) {
+        _thread = nullptr;
+        for ( auto const& fileName : fileNames ) {
+            _queue.removeOne( fileName );
+        }
+        _startNext( );
+    } );
+    _thread->start( QThread::LowPriority );
+}
+
+// Runs on the worker thread.
+void ModelMetadataIndex::_index( QStringList const fileNames ) {
+    for ( auto const& fileName : fileNames ) {
+        ModelMetadata const metadata { readMetadata( fileName ) };
+        if ( isInterrupted( ) ) {
+            return;
+        }
+
+        QMetaObject::invokeMethod( this, [ this, fileName, metadata ] ( ) {
+            _indexed( fileName, metadata );
+        }, Qt::QueuedConnection );
+    }
+}
+
+void ModelMetadataIndex::_indexed( QString const& fileName, ModelMetadata const& metadata ) {
+    debug( "+ ModelMetadataIndex::_indexed: '%s': valid? %s; %zu triangles; %.2f × %.2f × %.2f mm\n", fileName.toUtf8( ).data( ), YesNoString( metadata.valid ), metadata.triangleCount, metadata.x.size, metadata.y.size, metadata.z.size );
+    _entries[fileName]  = metadata;
+    _lastUsed[fileName] = QDateTime::currentMSecsSinceEpoch( );
+    _dirty = true;
+    emit metadataReady( fileName );
+}
+
+void ModelMetadataIndex::_load( ) {
+    QFile jsonFile { JobWorkingDirectoryPath % Slash % MetadataIndexFileName };
+    if ( !jsonFile.open( QIODevice::ReadOnly ) ) {
+        return;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument const jsonDocument { QJsonDocument::fromJson( jsonFile.readAll( ), &parseError ) };
+    if ( jsonDocument.isNull( ) ) {
+        debug( "+ ModelMetadataIndex::_load: error parsing metadata index: %s\n", parseError.errorString( ).toUtf8( ).data( ) );
+        return;
+    }
+
+    QJsonObject const root { jsonDocument.object( ) };
+    for ( auto iter = root.constBegin( ); iter != root.constEnd( ); ++iter ) {
+        QJsonObject const entry { iter.value( ).toObject( ) };
+        QJsonArray  const lower { entry.value( "min" ).toArray( ) };
+        QJsonArray  const upper { entry.value( "max" ).toArray( ) };
+        if ( ( lower.count( ) != 3 ) || ( upper.count( ) != 3 ) ) {
+            continue;
+        }
+
+        ModelMetadata metadata;
+        metadata.size          = static_cast<qint64>( entry.value( "size" ).toDouble( ) );
+        metadata.lastModified  = QDateTime::fromMSecsSinceEpoch( static_cast<qint64>( entry.value( "modified" ).toDouble( ) ) );
+        metadata.valid         = entry.value( "valid" ).toBool( );
+        metadata.triangleCount = static_cast<size_t>( entry.value( "triangles" ).toDouble( ) );
+        metadata.x             = { lower[0].toDouble( ), upper[0].toDouble( ) };
+        metadata.y             = { lower[1].toDouble( ), upper[1].toDouble( ) };
+        metadata.z             = { lower[2].toDouble( ), upper[2].toDouble( ) };
+        _entries.insert( iter.key( ), metadata );
+        _lastUsed.insert( iter.key( ), static_cast<qint64>( entry.value( "used" ).toDouble( ) ) );
+    }
+}
+
+void ModelMetadataIndex::_save( ) {
+    // Entries for files that can't be seen right now are kept, since they're
+    // likely on a USB stick that will be back; an entry for a file that has
+    // changed is caught by its size and modification time instead
+    if ( _entries.count( ) > MaximumIndexEntries ) {
+        QStringList fileNames { _entries.keys( ) };
+        std::sort( fileNames.begin( ), fileNames.end( ), [ this ] ( QString const& a, QString const& b ) {
+            return _lastUsed.value( a ) > _lastUsed.value( b );
+        } );
+        for ( int n = MaximumIndexEntries; n < fileNames.count( ); ++n ) {
+            _entries.remove( fileNames[n] );
+            _lastUsed.remove( fileNames[n] );
+        }
+    }
+
+    QJsonObject root;
+    for ( auto iter = _entries.constBegin( ); iter != _entries.constEnd( ); ++iter ) {
+        ModelMetadata const& metadata = iter.value( );
+        root.insert( iter.key( ), QJsonObject {
+            { "size",      static_cast<double>( metadata.size )                         },
+            { "modified",  static_cast<double>( metadata.lastModified.toMSecsSinceEpoch( ) ) },
+            { "valid",     metadata.valid                                               },
+            { "triangles", static_cast<double>( metadata.triangleCount )                },
+            { "min",       toJsonArray( metadata.x.min, metadata.y.min, metadata.z.min ) },
+            { "max",       toJsonArray( metadata.x.max, metadata.y.max, metadata.z.max ) },
+            { "used",      static_cast<double>( _lastUsed.value( iter.key( ) ) )         },
+        } );
+    }
+
+    QSaveFile jsonFile { JobWorkingDirectoryPath % Slash % MetadataIndexFileName };
+    if ( !QDir { }.mkpath( JobWorkingDirectoryPath ) || !jsonFile.open( QIODevice::WriteOnly ) ) {
+        debug( "+ ModelMetadataIndex::_save: couldn't create '%s'\n", jsonFile.fileName( ).toUtf8( ).data( ) );
+        return;
+    }
+    jsonFile.write( QJsonDocument { root }.toJson( QJsonDocument::Compact ) );
+    if ( jsonFile.commit( ) ) {
+        _dirty = false;
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef __MODELMETADATAINDEX_H__
+#define __MODELMETADATAINDEX_H__
+
+#include "coordinate.h"
+
+class ModelMetadata {
+
+public:
+
+    qint64     size          { };
+    QDateTime  lastModified;
+
+    // False if the file couldn't be read as an STL file.
+    bool       valid         { };
+    size_t     triangleCount { };
+    Coordinate x;
+    Coordinate y;
+    Coordinate z;
+
+    bool fitsPrinter( ) const;
+
+};
+
+//
+// Index of model files' triangle counts and bounding boxes. These are
+// gathered by streaming once through the file's triangles with
+// Loader::stream_triangles, without building a mesh. Entries are keyed by path and stay
+// valid while the file's size and modification time are unchanged. The
+// index is saved in JobWorkingDirectoryPath so that it survives restarts,
+// and holds a bounded number of entries, forgetting the least recently used.
+//
+
+class ModelMetadataIndex: public QObject {
+
+    Q_OBJECT
+
+public:
+
+    ModelMetadataIndex( QObject* parent = nullptr );
+    virtual ~ModelMetadataIndex( ) override;
+
+    static bool isModelFileName( QString const& fileName );
+
+    // Reads a model's metadata on the calling thread.
+    static ModelMetadata readMetadata( QString const& fileName );
+
+    // Returns the file's metadata if it's indexed and up to date; otherwise
+    // returns nullptr and queues the file for indexing.
+    ModelMetadata const* lookup( QString const& fileName, qint64 const size, QDateTime const& lastModified );
+
+    // Queues every model file in the directory that isn't already indexed.
+    void indexDirectory( QString const& path );
+
+protected:
+
+private:
+
+    QHash<QString, ModelMetadata> _entries;
+    QHash<QString, qint64>        _lastUsed; // ms since the epoch
+    QStringList                   _queue;
+    QThread*                      _thread { };
+    bool                          _dirty  { };
+
+    void _load( );
+    void _save( );
+    void _enqueue( QString const& fileName );
+    void _startNext( );
+    void _index( QStringList const fileNames );
+    void _indexed( QString const& fileName, ModelMetadata const& metadata );
+
+signals:
+
+    void metadataReady( QString const& fileName );
+
+public slots:
+
+protected slots:
+
+private slots:
+
+};
+
+#endif // __MODELMETADATAINDEX_H__
@@ -3,6 +3,7 @@
 #include <QtWidgets>
 #include "constants.h"
 #include "debug.h"
+#include "layerarchive.h"
 #include "ordermanifestmanager.h"
 
 using namespace std;
@@ -169,6 +170,7 @@ bool OrderManifestManager::save() {
     QJsonArray jsonArray;
     QString fileName;
     QImage calculationImage;
+    QHash<QString, unsigned int> activePixelCounts;
     int activeTreshold = QColor("white").value() / 2;
     int i = 0;
     int total = _fileNameList.count();
@@ -181,13 +183,20 @@ bool OrderManifestManager::save() {
             unsigned int activePixels = 0;
 
             if (_calculateArea) {
-                calculationImage.load(_dirPath % Slash % fileName);
-                for (int size_y=0; size_y < calculationImage.height(); size_y++) {
-                    for (int size_x=0; size_x < calculationImage.width(); size_x++) {
-                        QColor tempColor = calculationImage.pixel(size_x, size_y);
-                        if (tempColor.value() >= activeTreshold)
-                            activePixels++;
+                /* repeated layers share an image, so it's only counted once */
+                QString identity = LayerImageIdentity(_dirPath % Slash % fileName);
+                if (activePixelCounts.contains(identity)) {
+                    activePixels = activePixelCounts.value(identity);
+                } else {
+                    calculationImage = LoadLayerImage(_dirPath % Slash % fileName);
+                    for (int size_y=0; size_y < calculationImage.height(); size_y++) {
+                        for (int size_x=0; size_x < calculationImage.width(); size_x++) {
+                            QColor tempColor = calculationImage.pixel(size_x, size_y);
+                            if (tempColor.value() >= activeTreshold)
+                                activePixels++;
+                        }
                     }
+                    activePixelCounts.insert(identity, activePixels);
                 }
 
                 _estimatedVolume += ProjectorPixelSize * ProjectorPixelSize *
@@ -4,6 +4,7 @@
 #include <QString>
 #include <QStringList>
 #include <QFile>
+#include <atomic>
 #include "constants.h"
 
 enum class ManifestParseResult {
@@ -241,12 +242,37 @@ public:
         _dirPath = "";
         _estimatedVolume = 0;
         _calculateArea = false;
+        _rendering = false;
+        _renderFailed = false;
     }
 
     Iterator iterator() {
         return Iterator(_fileNameList);
     }
 
+    /* A print can start while the layer images are still being rendered.
+     * The file list is complete from the start, but until finishRendering()
+     * only the first renderedCount() images exist. */
+    void startRendering() {
+        _renderedCount = 0;
+        _renderFailed = false;
+        _rendering = true;
+    }
+
+    void setRenderedCount(int count) {
+        _renderedCount = count;
+    }
+
+    void finishRendering(bool success) {
+        _renderFailed = !success;
+        _rendering = false;
+    }
+
+    inline int renderedCount() { return _renderedCount; }
+    inline bool isRendering() { return _rendering; }
+    inline bool isRendered(int position) { return (!_rendering && !_renderFailed) || position < _renderedCount; }
+    inline bool renderFailedAt(int position) { return _renderFailed && position >= _renderedCount; }
+
     inline bool contains( QString fileName ) { return this->_fileNameList.contains(fileName); }
     inline bool initialized ( ) { return this->_initialized; }
 
@@ -277,6 +303,9 @@ private:
     bool                _calculateArea     {false};
     bool                _zeroTilingBase    {false};
     bool                _zeroTilingBody    {false};
+    std::atomic<int>    _renderedCount     { };
+    std::atomic<bool>   _rendering         {false};
+    std::atomic<bool>   _renderFailed      {false};
 };
 
 #endif // ORDERMANIFESTMANAGER_H
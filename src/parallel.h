@@ -0,0 +1,45 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <vector>
+
+/*  Returns the number of threads the hardware can run concurrently */
+inline unsigned hardware_threads()
+{
+    // This may return 0 if the property can't be read, so we should check
+    // for that too.
+    auto threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+    {
+        threads = 8;
+    }
+    return threads;
+}
+
+/*  Splits [0, count) into one contiguous range per thread and calls
+ *  f(first, last) on each range concurrently */
+template<typename F>
+void parallel_for(size_t count, unsigned threads, F f)
+{
+    if (threads < 2 || count < 2)
+    {
+        f(size_t(0), count);
+        return;
+    }
+
+    const size_t chunk = (count + threads - 1) / threads;
+    std::vector<std::future<void>> workers;
+    for (size_t first = 0; first < count; first += chunk)
+    {
+        workers.push_back(std::async(std::launch::async, f, first, std::min(first + chunk, count)));
+    }
+    for (auto& worker : workers)
+    {
+        worker.wait();
+    }
+}
+
+#endif // PARALLEL_H
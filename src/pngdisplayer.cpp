@@ -1,6 +1,7 @@
 #include "pch.h"
 
 #include "pngdisplayer.h"
+#include "layerarchive.h"
 #include "printjob.h"
 
 PngDisplayer::PngDisplayer( QWidget* parent ): QMainWindow( parent ) {
@@ -49,7 +50,8 @@ void PngDisplayer::clear( ) {
 }
 
 bool PngDisplayer::loadImageFile( QString const& fileName ) {
-    if ( !image.load(fileName) ) {
+    image = LoadLayerImage( fileName );
+    if ( image.isNull( ) ) {
         _label->clear( );
         image = QImage();
         return false;
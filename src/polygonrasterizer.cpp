@@ -0,0 +1,204 @@
+#include "pch.h"
+
+#include "polygonrasterizer.h"
+
+namespace {
+
+    // Horizontal coverage is measured in 1/256ths of a pixel.
+    int const CoverageShift { 8 };
+    int const CoverageOne   { 1 << CoverageShift };
+
+    // Sixteen sub-rows of full coverage still fit in 16 bits.
+    int const MaximumSubRows { 16 };
+
+    class Edge {
+
+    public:
+
+        double yTop;
+        double yBottom;
+        double xTop;
+        double dxdy;
+        int    winding;
+
+    };
+
+    class Crossing {
+
+    public:
+
+        double x;
+        int    winding;
+
+        bool operator<( Crossing const& other ) const {
+            return x < other.x;
+        }
+
+    };
+
+    // Working storage, kept per thread so that render workers don't
+    // reallocate it for every layer.
+    class Scratch {
+
+    public:
+
+        std::vector<Edge>     edges;
+        std::vector<size_t>   active;
+        std::vector<Crossing> crossings;
+        std::vector<quint16>  coverage;
+
+    };
+
+    thread_local Scratch scratch;
+
+    void buildEdges( QVector<QPolygonF> const& polygons, std::vector<Edge>& edges ) {
+        edges.clear( );
+        for ( auto const& polygon : polygons ) {
+            int const count = polygon.count( );
+            for ( int n = 0; n < count; ++n ) {
+                QPointF const& a = polygon[n];
+                QPointF const& b = polygon[( n + 1 ) % count];
+                if ( a.y( ) == b.y( ) ) {
+                    continue;
+                }
+
+                QPointF const& top    = ( a.y( ) < b.y( ) ) ? a : b;
+                QPointF const& bottom = ( a.y( ) < b.y( ) ) ? b : a;
+                edges.push_back( Edge {
+                    top.y( ), bottom.y( ), top.x( ),
+                    ( bottom.x( ) - top.x( ) ) / ( bottom.y( ) - top.y( ) ),
+                    ( a.y( ) < b.y( ) ) ? 1 : -1
+                } );
+            }
+        }
+
+        std::sort( edges.begin( ), edges.end( ), [] ( Edge const& a, Edge const& b ) {
+            return a.yTop < b.yTop;
+        } );
+    }
+
+    // Adds the coverage of the span [left, right), in fixed point, to a
+    // row of counts that has one spare slot at the end.
+    void accumulateSpan( quint16* coverage, int const left, int const right ) {
+        int const first = left  >> CoverageShift;
+        int const last  = right >> CoverageShift;
+        if ( first == last ) {
+            coverage[first] += right - left;
+            return;
+        }
+
+        coverage[first] += CoverageOne - ( left & ( CoverageOne - 1 ) );
+        for ( int x = first + 1; x < last; ++x ) {
+            coverage[x] += CoverageOne;
+        }
+        coverage[last] += right & ( CoverageOne - 1 );
+    }
+
+}
+
+PolygonRasterizer::PolygonRasterizer( QSize const& size, FillRule const fillRule, int const subRows ):
+    _size     ( size                                    ),
+    _fillRule ( fillRule                                ),
+    _subRows  ( qBound( 1, subRows, MaximumSubRows )    )
+{
+    /*empty*/
+}
+
+QImage PolygonRasterizer::rasterize( QVector<QPolygonF> const& polygons ) const {
+    int const width   = _size.width( );
+    int const height  = _size.height( );
+    int const subRows = _antialiasing ? _subRows : 1;
+
+    QImage image { _size, QImage::Format_Grayscale8 };
+    if ( image.isNull( ) ) {
+        return image;
+    }
+    image.fill( 0 );
+
+    std::vector<Edge>&     edges     = scratch.edges;
+    std::vector<size_t>&   active    = scratch.active;
+    std::vector<Crossing>& crossings = scratch.crossings;
+    std::vector<quint16>&  coverage  = scratch.coverage;
+    size_t                 nextEdge  = 0;
+
+    buildEdges( polygons, edges );
+    active.clear( );
+    coverage.resize( width + 1 );
+
+    // Converts a row of counts to 0-255 with a multiply and a shift
+    quint32 const scale     = ( 255u << 16 ) / ( CoverageOne * subRows );
+    double  const rightEdge = width;
+
+    for ( int row = 0; row < height; ++row ) {
+        if ( ( nextEdge == edges.size( ) ) && active.empty( ) ) {
+            break;
+        }
+
+        std::fill( coverage.begin( ), coverage.end( ), 0 );
+        bool rowIsEmpty = true;
+
+        for ( int subRow = 0; subRow < subRows; ++subRow ) {
+            double const y = row + ( subRow + 0.5 ) / subRows;
+
+            // Edges cover [yTop, yBottom), so each vertex is crossed once
+            active.erase( std::remove_if( active.begin( ), active.end( ), [&edges, y] ( size_t const n ) {
+                return edges[n].yBottom <= y;
+            } ), active.end( ) );
+            while ( ( nextEdge < edges.size( ) ) && ( edges[nextEdge].yTop <= y ) ) {
+                if ( edges[nextEdge].yBottom > y ) {
+                    active.push_back( nextEdge );
+                }
+                ++nextEdge;
+            }
+            if ( active.empty( ) ) {
+                continue;
+            }
+
+            crossings.clear( );
+            for ( auto const n : active ) {
+                Edge const& edge = edges[n];
+                crossings.push_back( Crossing { edge.xTop + ( y - edge.yTop ) * edge.dxdy, edge.winding } );
+            }
+            std::sort( crossings.begin( ), crossings.end( ) );
+
+            int    winding = 0;
+            double left    = 0.0;
+            for ( auto const& crossing : crossings ) {
+                bool const wasInside = ( _fillRule == FillRule::NonZero ) ? ( winding != 0 ) : ( winding & 1 );
+                winding += crossing.winding;
+                bool const isInside  = ( _fillRule == FillRule::NonZero ) ? ( winding != 0 ) : ( winding & 1 );
+
+                if ( !wasInside && isInside ) {
+                    left = crossing.x;
+                } else if ( wasInside && !isInside ) {
+                    double right = crossing.x;
+                    double start = left;
+                    if ( !_antialiasing ) {
+                        // Whole pixels whose centres are inside the span
+                        start = std::ceil( start - 0.5 );
+                        right = std::ceil( right - 0.5 );
+                    }
+
+                    int const fixedLeft  = static_cast<int>( std::lround( qBound( 0.0, start, rightEdge ) * CoverageOne ) );
+                    int const fixedRight = static_cast<int>( std::lround( qBound( 0.0, right, rightEdge ) * CoverageOne ) );
+                    if ( fixedRight > fixedLeft ) {
+                        accumulateSpan( coverage.data( ), fixedLeft, fixedRight );
+                        rowIsEmpty = false;
+                    }
+                }
+            }
+        }
+
+        if ( rowIsEmpty ) {
+            continue;
+        }
+
+        uchar*   const pixels = image.scanLine( row );
+        quint16* const counts = coverage.data( );
+        for ( int x = 0; x < width; ++x ) {
+            pixels[x] = static_cast<uchar>( ( counts[x] * scale + 0x8000u ) >> 16 );
+        }
+    }
+
+    return image;
+}
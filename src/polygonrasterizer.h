@@ -0,0 +1,47 @@
+#ifndef __POLYGONRASTERIZER_H__
+#define __POLYGONRASTERIZER_H__
+
+enum class FillRule {
+    NonZero,
+    EvenOdd
+};
+
+//
+// Scanline rasterizer for layer outlines. Polygons are given in pixel
+// coordinates, with (0, 0) at the top left corner of the image, and are
+// filled white on black into an 8-bit grayscale image.
+//
+// With antialiasing on, each pixel row is sampled on several sub-rows, and
+// each span's horizontal coverage is measured exactly (to 1/256 of a pixel)
+// and summed into a row of coverage counts. The inner loops only add and
+// scale runs of counts, which the compiler vectorizes. With antialiasing
+// off, a pixel is white if its centre is inside the outline.
+//
+// rasterize() may run on several threads at once; each thread keeps its
+// own working buffers between calls.
+//
+
+class PolygonRasterizer {
+
+public:
+
+    PolygonRasterizer( QSize const& size, FillRule const fillRule = FillRule::NonZero, int const subRows = DefaultSubRows );
+
+    void   setAntialiasing( bool const antialiasing ) { _antialiasing = antialiasing; }
+
+    QImage rasterize( QVector<QPolygonF> const& polygons ) const;
+
+    static int const DefaultSubRows = 4;
+
+protected:
+
+private:
+
+    QSize    _size;
+    FillRule _fillRule;
+    int      _subRows;
+    bool     _antialiasing { true };
+
+};
+
+#endif // __POLYGONRASTERIZER_H__
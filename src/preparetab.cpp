@@ -8,9 +8,12 @@
 #include "preparetab.h"
 
 #include "hasher.h"
+#include "layerarchive.h"
 #include "printjob.h"
 #include "printmanager.h"
 #include "printprofile.h"
+#include "projectorcontroller.h"
+#include "slicecache.h"
 #include "shepherd.h"
 #include "slicesorderpopup.h"
 #include "thicknesswindow.h"
@@ -175,11 +178,11 @@ PrepareTab::PrepareTab(QWidget* parent ): InitialShowEventMixin<PrepareTab, TabB
 
         if(toggled) {
             _pngDisplayer->loadImageFile(printJob.getLayerPath(_visibleLayer));
-            QProcess::startDetached( SetProjectorPowerCommand, { QString { "%1" }.arg( PercentagePowerLevelToRawLevel( activeProfileRef->baseLayerParameters().powerLevel() )) } );
+            App::projectorController( )->setPowerLevel( PercentagePowerLevelToRawLevel( activeProfileRef->baseLayerParameters().powerLevel() ) );
 
         } else {
             _pngDisplayer->clear();
-            QProcess::startDetached( SetProjectorPowerCommand, { QString { "%1" }.arg( PercentagePowerLevelToRawLevel( 0 )) } );
+            App::projectorController( )->setPowerLevel( PercentagePowerLevelToRawLevel( 0 ) );
         }
 
     });
@@ -386,31 +389,26 @@ bool PrepareTab::_checkPreSlicedFiles(const QString &directory, bool isBody)
 {
     debug( "+ PrepareTab::_checkPreSlicedFiles\n" );
 
-    // check that the sliced SVG file is newer than the STL file
     auto modelFile = QFileInfo {printJob.getModelFilename()};
     if ( !modelFile.exists( ) ) {
         debug( "  + Fail: model file does not exist\n" );
         return false;
     }
-    auto slicedSvgFile = QFileInfo { directory + Slash + SlicedSvgFileName };
-    if ( !slicedSvgFile.exists( ) ) {
-        debug( "  + Fail: sliced SVG file does not exist\n" );
+
+    // The manifest is only saved once every layer has been rendered, so a
+    // directory without one was never finished
+    auto manifestFile = QFileInfo { directory + Slash + ManifestFilename };
+    if ( !manifestFile.exists( ) ) {
+        debug( "  + Fail: manifest file does not exist\n" );
         return false;
     }
 
-    // check that the sliced SVG file is newer than the STL file
-    // disabled
-    //auto slicedSvgFileLastModified = slicedSvgFile.lastModified( );
     if ( !printJob.getModelFilename().isEmpty( ) ) {
         auto modelFile = QFileInfo { printJob.getModelFilename() };
         if ( !modelFile.exists( ) ) {
             debug( "  + Fail: model file does not exist\n" );
             return false;
         }
-        /*if ( !printJob.getModelFilename().isEmpty( ) && ( modelFile.lastModified( ) > slicedSvgFileLastModified ) ) {
-            debug( "  + Fail: model file is newer than sliced SVG file\n" );
-            return false;
-        }*/
     }
 
     int layerNumber     = -1;
@@ -450,16 +448,20 @@ bool PrepareTab::_checkPreSlicedFiles(const QString &directory, bool isBody)
 
     OrderManifestManager::Iterator iter = manifestMgr->iterator();
 
+    // Layers rendered into an archive are checked against its index; only
+    // loose PNGs need a stat each
+    QSet<QString> const archivedLayers { ArchivedLayerNames(directory) };
+
     while (iter.hasNext()) {
-        QFileInfo entry(directory % Slash % *iter);
+        QString const fileName { *iter };
         ++iter;
 
-        if (!entry.exists()) {
-            debug( "  + Fail: layer PNG file %s does not exist\n", entry.fileName().toUtf8().data());
+        if (!archivedLayers.contains(fileName) && !QFileInfo::exists(directory % Slash % fileName)) {
+            debug( "  + Fail: layer PNG file %s does not exist\n", fileName.toUtf8().data());
             return false;
         }
 
-        layerNumber = RemoveFileExtension(entry.baseName()).toInt();
+        layerNumber = RemoveFileExtension(fileName).toInt();
         if ( layerNumber != ( prevLayerNumber + 1 ) ) {
             debug("  + Fail: gap in layer numbers between %d and %d\n", prevLayerNumber, layerNumber);
             return false;
@@ -482,12 +484,13 @@ bool PrepareTab::_checkOneSliceDirectory(const QString &directory, bool isBody)
 {
     bool isPreSliced;
 
-    QDir slicesDir { directory };
     isPreSliced = _checkPreSlicedFiles(directory, isBody);
     debug("  + pre-sliced layers are %sgood\n", isPreSliced ? "" : "NOT ");
 
-    if (!isPreSliced) {
-        slicesDir.removeRecursively();
+    if (isPreSliced) {
+        SliceCache::touch(directory);
+    } else {
+        SliceCache::remove(directory);
     }
 
     return isPreSliced;
@@ -527,6 +530,8 @@ bool PrepareTab::_checkSliceDirectories()
         bodySliceDirectory.toUtf8().data()
     );
 
+    SliceCache::protectPrintJob();
+
     if(printJob.hasBaseLayers())
         preSliced &= _checkOneSliceDirectory(baseSliceDirectory, false);
     preSliced &= _checkOneSliceDirectory(bodySliceDirectory, true);
@@ -622,7 +627,7 @@ void PrepareTab::_showLayerImage(int const layer)
 void PrepareTab::_showLayerImage(const QString &path)
 {
     debug("+ PrepareTab::_showLayerImage by path %s\n", path.toUtf8().data());
-    QPixmap pixmap_orig { path };
+    QPixmap pixmap_orig { QPixmap::fromImage( LoadLayerImage( path ) ) };
     QTransform rotate_transform;
     QPixmap pixmap;
 
@@ -742,7 +747,9 @@ void PrepareTab::sliceButton_clicked(bool)
         .arg(sliceDirectoryBase)
         .arg(printJob.getSelectedBodyLayerThickness());
 
-    _sliceStatus->setText("starting base layers");
+    _sliceStreamStatus.clear();
+    _renderStreamStatus.clear();
+    _sliceStatus->setText("starting");
     _imageGeneratorStatus->setText( "waiting");
     _setNavigationButtonsEnabled(false);
 
@@ -755,8 +762,9 @@ void PrepareTab::sliceButton_clicked(bool)
         bodySliceDirectory, !bodyPresliced || _reslice) };
     QObject::connect(task, &SlicerTask::sliceStatus, this, &PrepareTab::slicingStatusUpdate);
     QObject::connect(task, &SlicerTask::renderStatus, this, &PrepareTab::renderingStatusUpdate);
-    QObject::connect(task, &SlicerTask::layerCount, this, &PrepareTab::layerCountUpdate);
+    QObject::connect(task, &SlicerTask::managersReady, this, &PrepareTab::slicingManagersReady);
     QObject::connect(task, &SlicerTask::layerDone, this, &PrepareTab::layerDoneUpdate);
+    QObject::connect(task, &SlicerTask::layersReady, this, &PrepareTab::slicingLayersReady);
     QObject::connect(task, &SlicerTask::done, this, &PrepareTab::slicingDone);
     _threadPool.start(task);
 
@@ -790,15 +798,33 @@ void PrepareTab::hasher_resultReady(QString const hash)
     update();
 }
 
-void PrepareTab::slicingStatusUpdate(const QString &status)
+void PrepareTab::_showStreamStatus(QLabel* label, QMap<QString, QString>& streams, const QString &stream, const QString &status)
 {
-    _sliceStatus->setText(status);
+    /* Base and body layers may be sliced and rendered side by side; each
+     * keeps its own entry until the task as a whole reports again */
+    if (stream.isEmpty()) {
+        streams.clear();
+        label->setText(status);
+        return;
+    }
+
+    streams[stream] = status;
+
+    QStringList parts;
+    for (auto iter = streams.cbegin(); iter != streams.cend(); ++iter)
+        parts.append(QString("%1 %2").arg(iter.key()).arg(iter.value()));
+    label->setText(parts.join(", "));
+}
+
+void PrepareTab::slicingStatusUpdate(const QString &stream, const QString &status)
+{
+    _showStreamStatus(_sliceStatus, _sliceStreamStatus, stream, status);
     update();
 }
 
-void PrepareTab::renderingStatusUpdate(const QString &status)
+void PrepareTab::renderingStatusUpdate(const QString &stream, const QString &status)
 {
-    _imageGeneratorStatus->setText(status);
+    _showStreamStatus(_imageGeneratorStatus, _renderStreamStatus, stream, status);
     update();
 }
 
@@ -815,15 +841,55 @@ void PrepareTab::layerDoneUpdate(int layer, QString path)
     _showLayerImage(path);
 }
 
+void PrepareTab::slicingManagersReady(QSharedPointer<OrderManifestManager> baseManager,
+    QSharedPointer<OrderManifestManager> bodyManager)
+{
+    debug("+ PrepareTab::slicingManagersReady\n");
+
+    /* The print may start from these while rendering goes on */
+    if (baseManager)
+        printJob.setBaseManager(baseManager);
+    if (bodyManager)
+        printJob.setBodyManager(bodyManager);
+    SliceCache::protectPrintJob();
+    layerCountUpdate(printJob.totalLayerCount());
+}
+
+void PrepareTab::slicingLayersReady()
+{
+    debug("+ PrepareTab::slicingLayersReady: printing can start while rendering continues\n");
+
+    /* The slice controls stay off until rendering is done */
+    _renderingInBackground = true;
+    _orderButton->setEnabled(false);
+    emit uiStateChanged(TabIndex::Prepare, UiState::PrintJobReady);
+    emit uiStateChanged(TabIndex::Prepare, UiState::SliceCompleted);
+}
+
 void PrepareTab::slicingDone(bool success)
 {
+    bool wasReady = _renderingInBackground;
+    _renderingInBackground = false;
+
+    /* A print started on the first layers keeps using the managers it
+     * started with, and the tabs already know the job is ready */
+    if (wasReady && !_isPrinterAvailable) {
+        debug("+ PrepareTab::slicingDone: rendering finished during print; success? %s\n", YesNoString(success));
+        return;
+    }
+
     _setSliceControlsEnabled(true);
 
     if (success) {
         _checkSliceDirectories();
         _restartPreview();
-        emit uiStateChanged(TabIndex::Prepare, UiState::SliceCompleted);
+        if (!wasReady)
+            emit uiStateChanged(TabIndex::Prepare, UiState::SliceCompleted);
     } else {
+        /* Takes back the go-ahead given on the first layers */
+        if (wasReady)
+            _checkSliceDirectories();
+
         QMessageBox msgbox { QMessageBox::Icon::Critical, "Error", "Slicing error" };
         msgbox.exec();
     }
@@ -1037,7 +1103,7 @@ void PrepareTab::tab_uiStateChanged( TabIndex const sender, UiState const state
 
             _hasher = new Hasher;
             QObject::connect(_hasher, &Hasher::resultReady, this, &PrepareTab::hasher_resultReady, Qt::QueuedConnection);
-            _hasher->hash(printJob.getModelFilename(), QCryptographicHash::Md5);
+            _hasher->fingerprint(printJob.getModelFilename());
 
         } else {
             _setSliceControlsEnabled(false);
@@ -1051,7 +1117,7 @@ void PrepareTab::tab_uiStateChanged( TabIndex const sender, UiState const state
         break;
 
     case UiState::SliceCompleted:
-        if (!printJob.getDirectoryMode())
+        if (!printJob.getDirectoryMode() && !_renderingInBackground)
             _setSliceControlsEnabled(true);
         break;
 
@@ -1069,7 +1135,7 @@ void PrepareTab::tab_uiStateChanged( TabIndex const sender, UiState const state
         break;
 
     case UiState::PrintCompleted:
-        _setSliceControlsEnabled(!printJob.getDirectoryMode() && !printJob.isTiled());
+        _setSliceControlsEnabled(!printJob.getDirectoryMode() && !printJob.isTiled() && !_renderingInBackground);
         _orderButton->setEnabled(printJob.getDirectoryMode());
         setPrinterAvailable(true);
         emit printerAvailabilityChanged(true);
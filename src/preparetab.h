@@ -11,7 +11,7 @@
 #include "pngdisplayer.h"
 
 class Hasher;
-class SvgRenderer;
+class LayerRenderer;
 
 
 class PrepareTab: public InitialShowEventMixin<PrepareTab, TabBase> {
@@ -40,12 +40,13 @@ protected:
 private:
 
     QThreadPool       _threadPool;
-    SvgRenderer*      _svgRenderer                 { };
+    LayerRenderer*    _layerRenderer               { };
     Hasher*           _hasher                      { };
     int               _visibleLayer                { };
     int               _renderedLayers              { };
     bool              _isPrinterOnline             { false };
     bool              _isPrinterAvailable          { true  };
+    bool              _renderingInBackground       { false };
     bool              _reslice                     { false };
     bool              _initAfterSelect             { true  };
 
@@ -61,6 +62,8 @@ private:
     QLabel*           _sliceStatus                 { new QLabel           };
     QLabel*           _imageGeneratorStatusLabel   { new QLabel           };
     QLabel*           _imageGeneratorStatus        { new QLabel           };
+    QMap<QString, QString> _sliceStreamStatus;
+    QMap<QString, QString> _renderStreamStatus;
 
     QGroupBox*        _prepareGroup                { new QGroupBox        };
     QLabel*           _prepareMessage              { new QLabel           };
@@ -127,6 +130,7 @@ private:
     void _handlePrepareFailed( );
     void _loadDirectoryManifest();
     void _restartPreview();
+    void _showStreamStatus(QLabel* label, QMap<QString, QString>& streams, const QString &stream, const QString &status);
 
 signals:
     void slicingNeeded(bool const needed);
@@ -170,10 +174,13 @@ private slots:
 
     void hasher_resultReady( QString const hash );
 
-    void slicingStatusUpdate(const QString &status);
-    void renderingStatusUpdate(const QString &status);
+    void slicingStatusUpdate(const QString &stream, const QString &status);
+    void renderingStatusUpdate(const QString &stream, const QString &status);
     void layerCountUpdate(int count);
     void layerDoneUpdate(int layer, QString path);
+    void slicingManagersReady(QSharedPointer<OrderManifestManager> baseManager,
+        QSharedPointer<OrderManifestManager> bodyManager);
+    void slicingLayersReady();
     void slicingDone(bool success);
 
     void prepareButton_clicked( bool );
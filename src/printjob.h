@@ -359,6 +359,33 @@ public:
         return QString("%1/%2").arg(getLayerDirectory(layer)).arg(getLayerFileName(layer));
     }
 
+    /**
+     * @brief isLayerRendered
+     * @param layer layer number
+     * @return whether the image of requested layer exists yet; a print may
+     * start while later layers are still being rendered
+     */
+    bool isLayerRendered(int layer) const
+    {
+        int position;
+        OrderManifestManager* manager = _managerForLayer(layer, position);
+
+        return !manager || manager->isRendered(position);
+    }
+
+    /**
+     * @brief hasLayerRenderingFailed
+     * @param layer layer number
+     * @return whether rendering stopped before requested layer was done
+     */
+    bool hasLayerRenderingFailed(int layer) const
+    {
+        int position;
+        OrderManifestManager* manager = _managerForLayer(layer, position);
+
+        return manager && manager->renderFailedAt(position);
+    }
+
     /**
      * @brief getTimeForElementAt
      * @param layer layer number in context of current print
@@ -653,6 +680,22 @@ protected:
     QSharedPointer<PrintProfile>&        _printProfile;
     double                               _estimatedVolume { 0 };
 
+    OrderManifestManager* _managerForLayer(int layer, int &position) const
+    {
+        if(isTiled() || _directoryMode) {
+            position = layer;
+            return _bodyManager.data();
+        }
+
+        if(isBaseLayer(layer)) {
+            position = layer;
+            return _baseManager.data();
+        }
+
+        position = bodyLayerStart() + layer - _baseLayerCount;
+        return _bodyManager.data();
+    }
+
     int baseLayerStart() const
     {
 
@@ -5,7 +5,7 @@
 #include "ordermanifestmanager.h"
 #include "pngdisplayer.h"
 #include "printjob.h"
-#include "processrunner.h"
+#include "projectorcontroller.h"
 #include "shepherd.h"
 #include "timinglogger.h"
 
@@ -21,12 +21,12 @@
 // == Section B: For each base layer ==
 // ====================================
 //
-// B1. Start projection: "set-projector-power ${printJob.powerLevel}".
+// B1. Start projection: set projector power level to ${printJob.powerLevel}.
 // B2. Pause for layer projection time.
 //     -> if current job has multi-tiled elements
 //     B2a. change image - loop over tiled variants
 //     -> end if
-// B3. Stop projection: "set-projector-power 0".
+// B3. Stop projection: set projector power level to 0.
 // B4a1. Pause before "pumping" manoeuvre.
 // B4a2. Perform the "pumping" manoeuvre.
 // B4b1. Pause before projection.
@@ -38,12 +38,12 @@
 // == Section C: For each body layer ==
 // ====================================
 //
-// C1. Start projection: "set-projector-power ${printJob.powerLevel}".
+// C1. Start projection: set projector power level to ${printJob.powerLevel}.
 // C2. Pause for layer projection time.
 //     -> if current job has multi-tiled elements
 //     C2a. change image - loop over tiled variants
 //     -> end if
-// C3. Stop projection: "set-projector-power 0".
+// C3. Stop projection: set projector power level to 0.
 // C4a1. Pause before "pumping" manoeuvre.
 // C4a2. Perform the "pumping" manoeuvre.
 // C4b1. Pause before projection.
@@ -80,6 +80,13 @@ namespace {
     auto const PauseBeforeLift                  = 2000; // ms
 #endif // defined ICEBUG
 
+    // How often to look again for a layer that's still being rendered
+    auto const LayerRenderedPollInterval        =  250; // ms
+
+    // How far ahead of the layer being printed rendering has to be; the
+    // same margin SlicerTask waits for before the print starts
+    auto const LayersRenderedAhead              =   20;
+
     char const* PrintStepStrings[] {
         "none",
         "A1", "A2", "A3",
@@ -116,8 +123,7 @@ PrintManager::PrintManager( Shepherd* shepherd, QObject* parent ):
     QObject   ( parent   ),
     _shepherd ( shepherd )
 {
-    _movementSequencer        = new MovementSequencer { shepherd, this };
-    _setProjectorPowerProcess = new ProcessRunner     { this };
+    _movementSequencer = new MovementSequencer { shepherd, this };
 
     QObject::connect( _shepherd, &Shepherd::printer_positionReport, this, &PrintManager::printer_positionReport );
 }
@@ -147,6 +153,23 @@ void PrintManager::_stopAndCleanUpTimer( QTimer*& timer ) {
     timer = nullptr;
 }
 
+// Calls func with the result once the projector has been told the new power
+// level. The controller is shared, so other callers' results are ignored.
+void PrintManager::_setProjectorPowerLevel( int const powerLevel, void ( PrintManager::*func )( bool const ) ) {
+    auto const projectorController = App::projectorController( );
+
+    // Results arrive through the event loop, so connecting first can't miss ours
+    QObject::disconnect( _projectorConnection );
+    _projectorConnection = QObject::connect( projectorController, &ProjectorController::powerLevelSet, this, [ this, func ] ( int const requestId, bool const success ) {
+        if ( requestId != _projectorRequestId ) {
+            return;
+        }
+        QObject::disconnect( _projectorConnection );
+        ( this->*func )( success );
+    } );
+    _projectorRequestId = projectorController->setPowerLevel( powerLevel );
+}
+
 void PrintManager::_pausePrinting( ) {
     debug( "+ PrintManager::_pausePrinting: step: %s; position: %.2f mm\n", ToString( _step ), _position );
     _pausedPosition = _position;
@@ -154,6 +177,39 @@ void PrintManager::_pausePrinting( ) {
     stepE1_start( );
 }
 
+// Layers may still be rendering when the print starts. If the current layer
+// isn't ready, wait between layers, with the projector off, and then start
+// the step over. Once waiting, keep waiting until rendering is a margin
+// ahead of the current layer; so if rendering falls behind, the print
+// stalls once per margin's worth of layers rather than at every layer. Once
+// rendering has stopped, only the current layer has to exist.
+bool PrintManager::_waitForLayerRendered( void ( PrintManager::*step )( ) ) {
+    int const lookaheadLayer = std::max( _currentLayer, std::min( _currentLayer + LayersRenderedAhead, printJob.totalLayerCount( ) - 1 ) );
+    int const neededLayer    = _waitingForRendering ? lookaheadLayer : _currentLayer;
+    if ( printJob.isLayerRendered( neededLayer ) ) {
+        _waitingForRendering = false;
+        return false;
+    }
+
+    if ( printJob.hasLayerRenderingFailed( _currentLayer ) ) {
+        debug( "+ PrintManager::_waitForLayerRendered: layer %d will not be rendered\n", _currentLayer );
+        _printResult = PrintResult::Failure;
+        stepD1_start( );
+        return true;
+    }
+
+    // Rendering stopped short of the margin, but not short of this layer
+    if ( printJob.hasLayerRenderingFailed( neededLayer ) ) {
+        _waitingForRendering = false;
+        return false;
+    }
+
+    _waitingForRendering = true;
+    debug( "+ PrintManager::_waitForLayerRendered: layer %d is not rendered yet (printing layer %d)\n", neededLayer, _currentLayer );
+    _layerRenderedTimer = _makeAndStartTimer( LayerRenderedPollInterval, step );
+    return true;
+}
+
 void PrintManager::_cleanUp( ) {
     QObject::disconnect( this );
 
@@ -162,14 +218,9 @@ void PrintManager::_cleanUp( ) {
     _stopAndCleanUpTimer( _preProjectionTimer );
     _stopAndCleanUpTimer( _layerExposureTimer );
     _stopAndCleanUpTimer( _preLiftTimer       );
+    _stopAndCleanUpTimer( _layerRenderedTimer );
 
-    if ( _setProjectorPowerProcess ) {
-        if ( _setProjectorPowerProcess->state( ) != QProcess::NotRunning ) {
-            _setProjectorPowerProcess->kill( );
-        }
-        _setProjectorPowerProcess->deleteLater( );
-        _setProjectorPowerProcess = nullptr;
-    }
+    QObject::disconnect( _projectorConnection );
 }
 
 // ================================
@@ -266,16 +317,20 @@ void PrintManager::stepA3_completed( bool const success ) {
 // == Section B: For each base layer ==
 // ====================================
 
-// B1. Start projection: "set-projector-power ${printJob.powerLevel}".
+// B1. Start projection: set projector power level to ${printJob.powerLevel}.
 void PrintManager::stepB1_start( ) {
     _step = PrintStep::B1;
+    _stopAndCleanUpTimer( _layerRenderedTimer );
     if ( _paused ) {
         _pausePrinting( );
         return;
     }
+    if ( _waitForLayerRendered( &PrintManager::stepB1_start ) ) {
+        return;
+    }
 
     auto powerLevel = PercentagePowerLevelToRawLevel(printJob.baseLayerParameters().powerLevel());
-    debug( "+ PrintManager::stepB1_start: running 'set-projector-power %d'\n", powerLevel );
+    debug( "+ PrintManager::stepB1_start: setting projector power level to %d\n", powerLevel );
 
     QString pngFileName = printJob.getLayerPath( _currentLayer );
     if ( !_pngDisplayer->loadImageFile( pngFileName ) ) {
@@ -284,17 +339,13 @@ void PrintManager::stepB1_start( ) {
         return;
     }
 
-    QObject::connect( _setProjectorPowerProcess, &ProcessRunner::succeeded, this, &PrintManager::stepB1_completed );
-    QObject::connect( _setProjectorPowerProcess, &ProcessRunner::failed,    this, &PrintManager::stepB1_failed    );
-    _setProjectorPowerProcess->start( SetProjectorPowerCommand, { QString( "%1" ).arg( powerLevel ) } );
+    _setProjectorPowerLevel( powerLevel, &PrintManager::stepB1_completed );
 
     emit startingLayer( _currentLayer );
 }
 
-void PrintManager::stepB1_completed( ) {
-    debug( "+ PrintManager::stepB1_completed\n" );
-
-    QObject::disconnect( _setProjectorPowerProcess, nullptr, this, nullptr );
+void PrintManager::stepB1_completed( bool const success ) {
+    debug( "+ PrintManager::stepB1_completed: %s\n", SucceededString( success ) );
 
     if ( IsBadPrintResult( _printResult ) ) {
         stepD1_start( );
@@ -307,11 +358,6 @@ void PrintManager::stepB1_completed( ) {
     stepB2_start( );
 }
 
-void PrintManager::stepB1_failed( int const exitCode, QProcess::ProcessError const error ) {
-    debug( "+ PrintManager::stepB1_completed: exitCode: %d, error: %s [%d]\n", exitCode, ToString( error ), static_cast<int>( error ) );
-    stepB1_completed( );
-}
-
 // B2. Pause for layer projection time.
 void PrintManager::stepB2_start( ) {
     debug( "+ PrintManager::stepB2_start\n" );
@@ -378,24 +424,20 @@ void PrintManager::stepB2a_start( ){
 
 }
 
-// B3. Stop projection: "set-projector-power 0".
+// B3. Stop projection: set projector power level to 0.
 void PrintManager::stepB3_start( ) {
     debug( "+ PrintManager::stepB3_start\n" );
     _step = PrintStep::B3;
 
-    debug( "+ PrintManager::stepB3_start: running 'set-projector-power 0'\n" );
+    debug( "+ PrintManager::stepB3_start: setting projector power level to 0\n" );
 
     _pngDisplayer->clear( );
 
-    QObject::connect( _setProjectorPowerProcess, &ProcessRunner::succeeded, this, &PrintManager::stepB3_completed );
-    QObject::connect( _setProjectorPowerProcess, &ProcessRunner::failed,    this, &PrintManager::stepB3_failed    );
-    _setProjectorPowerProcess->start( SetProjectorPowerCommand, { "0" } );
+    _setProjectorPowerLevel( 0, &PrintManager::stepB3_completed );
 }
 
-void PrintManager::stepB3_completed( ) {
-    debug( "+ PrintManager::stepB3_completed\n" );
-
-    QObject::disconnect( _setProjectorPowerProcess, nullptr, this, nullptr );
+void PrintManager::stepB3_completed( bool const success ) {
+    debug( "+ PrintManager::stepB3_completed: %s\n", SucceededString( success ) );
 
     if ( IsBadPrintResult( _printResult ) ) {
         stepD1_start( );
@@ -412,10 +454,6 @@ void PrintManager::stepB3_completed( ) {
     }
 }
 
-void PrintManager::stepB3_failed( int const, QProcess::ProcessError const ) {
-    stepB3_completed( );
-}
-
 // B4a1. Pause before "pumping" manoeuvre.
 void PrintManager::stepB4a1_start( ) {
     debug( "+ PrintManager::stepB4a1_start\n" );
@@ -596,16 +634,20 @@ void PrintManager::stepB4b2_completed( bool const success ) {
 // == Section C: For each body layer ==
 // ====================================
 
-// C1. Start projection: "set-projector-power ${printJob.powerLevel}".
+// C1. Start projection: set projector power level to ${printJob.powerLevel}.
 void PrintManager::stepC1_start( ) {
     _step = PrintStep::C1;
+    _stopAndCleanUpTimer( _layerRenderedTimer );
     if ( _paused ) {
         _pausePrinting( );
         return;
     }
+    if ( _waitForLayerRendered( &PrintManager::stepC1_start ) ) {
+        return;
+    }
 
     auto powerLevel = PercentagePowerLevelToRawLevel(printJob.bodyLayerParameters().powerLevel());
-    debug( "+ PrintManager::stepC1_start: running 'set-projector-power %d'\n", powerLevel );
+    debug( "+ PrintManager::stepC1_start: setting projector power level to %d\n", powerLevel );
 
     QString pngFileName = printJob.getLayerPath( _currentLayer );
     if ( !_pngDisplayer->loadImageFile( pngFileName ) ) {
@@ -614,17 +656,13 @@ void PrintManager::stepC1_start( ) {
         return;
     }
 
-    QObject::connect( _setProjectorPowerProcess, &ProcessRunner::succeeded, this, &PrintManager::stepC1_completed );
-    QObject::connect( _setProjectorPowerProcess, &ProcessRunner::failed,    this, &PrintManager::stepC1_failed    );
-    _setProjectorPowerProcess->start( SetProjectorPowerCommand, { QString( "%1" ).arg( powerLevel ) } );
+    _setProjectorPowerLevel( powerLevel, &PrintManager::stepC1_completed );
 
     emit startingLayer( _currentLayer );
 }
 
-void PrintManager::stepC1_completed( ) {
-    debug( "+ PrintManager::stepC1_completed\n" );
-
-    QObject::disconnect( _setProjectorPowerProcess, nullptr, this, nullptr );
+void PrintManager::stepC1_completed( bool const success ) {
+    debug( "+ PrintManager::stepC1_completed: %s\n", SucceededString( success ) );
 
     if ( IsBadPrintResult( _printResult ) ) {
         stepD1_start( );
@@ -637,11 +675,6 @@ void PrintManager::stepC1_completed( ) {
     stepC2_start( );
 }
 
-void PrintManager::stepC1_failed( int const exitCode, QProcess::ProcessError const error ) {
-    debug( "+ PrintManager::stepC1_failed: exitCode: %d, error: %s [%d]\n", exitCode, ToString( error ), static_cast<int>( error ) );
-    stepC1_completed( );
-}
-
 // C2. Pause for layer projection time.
 void PrintManager::stepC2_start( ) {
     _step = PrintStep::C2;
@@ -704,23 +737,19 @@ void PrintManager::stepC2a_start( ){
 
 }
 
-// C3. Stop projection: "set-projector-power 0".
+// C3. Stop projection: set projector power level to 0.
 void PrintManager::stepC3_start( ) {
     _step = PrintStep::C3;
 
-    debug( "+ PrintManager::stepC3_start: running 'set-projector-power 0'\n" );
+    debug( "+ PrintManager::stepC3_start: setting projector power level to 0\n" );
 
     _pngDisplayer->clear( );
 
-    QObject::connect( _setProjectorPowerProcess, &ProcessRunner::succeeded, this, &PrintManager::stepC3_completed );
-    QObject::connect( _setProjectorPowerProcess, &ProcessRunner::failed,    this, &PrintManager::stepC3_failed    );
-    _setProjectorPowerProcess->start( SetProjectorPowerCommand, { "0" } );
+    _setProjectorPowerLevel( 0, &PrintManager::stepC3_completed );
 }
 
-void PrintManager::stepC3_completed( ) {
-    debug( "+ PrintManager::stepC3_completed\n" );
-
-    QObject::disconnect( _setProjectorPowerProcess, nullptr, this, nullptr );
+void PrintManager::stepC3_completed( bool const success ) {
+    debug( "+ PrintManager::stepC3_completed: %s\n", SucceededString( success ) );
 
     if (IsBadPrintResult(_printResult)) {
         stepD1_start();
@@ -736,10 +765,6 @@ void PrintManager::stepC3_completed( ) {
         stepC4b1_start();
 }
 
-void PrintManager::stepC3_failed( int const, QProcess::ProcessError const ) {
-    stepC3_completed( );
-}
-
 // C4a1. Pause before "pumping" manoeuvre.
 void PrintManager::stepC4a1_start( ) {
     _step = PrintStep::C4a1;
@@ -895,7 +920,7 @@ void PrintManager::stepD1_start()
     if ( _lampOn ) {
         debug( "+ PrintManager::stepD1_start: Turning off lamp\n" );
 
-        QProcess::startDetached( SetProjectorPowerCommand, { "0" } );
+        App::projectorController( )->setPowerLevel( 0 );
         _lampOn = false;
         emit lampStatusChange( false );
     }
@@ -1110,6 +1135,13 @@ void PrintManager::abort( ) {
         return;
     }
 
+    if ( _layerRenderedTimer ) {
+        debug( "  + Interrupting wait for layer to be rendered\n" );
+        _stopAndCleanUpTimer( _layerRenderedTimer );
+        stepD1_start( );
+        return;
+    }
+
     switch ( _step ) {
         case PrintStep::none:
             debug( "  + Going directly to step D1\n" );
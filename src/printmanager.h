@@ -8,7 +8,6 @@ class MovementInfo;
 class MovementSequencer;
 class PngDisplayer;
 class PrintJob;
-class ProcessRunner;
 class Shepherd;
 class OrderManifestManager;
 
@@ -61,7 +60,6 @@ private:
     Shepherd*           _shepherd                 { };
     MovementSequencer*  _movementSequencer        { };
     PngDisplayer*       _pngDisplayer             { };
-    ProcessRunner*      _setProjectorPowerProcess { };
     PrintResult         _printResult              { };
 
     bool                _lampOn                   { };
@@ -75,6 +73,7 @@ private:
     bool                _isTiled                  { false };
     bool                _running                  { false };
     bool                _paused                   { false };
+    bool                _waitingForRendering      { false };
     double              _position                 { };
     double              _pausedPosition           { };
     double              _threshold                { PrinterHighSpeedThresholdZ };
@@ -82,15 +81,21 @@ private:
     QTimer*             _preProjectionTimer       { };
     QTimer*             _layerExposureTimer       { };
     QTimer*             _preLiftTimer             { };
+    QTimer*             _layerRenderedTimer       { };
 
     QList<MovementInfo> _stepA1_movements;
     QList<MovementInfo> _stepA3_movements;
     QList<MovementInfo> _stepB4b2_movements;
     QList<MovementInfo> _stepC4b2_movements;
 
+    QMetaObject::Connection _projectorConnection;
+    int                     _projectorRequestId       { };
+
     QTimer* _makeAndStartTimer( int const duration, void ( PrintManager::*func )( ) );
     void    _stopAndCleanUpTimer( QTimer*& timer );
+    void    _setProjectorPowerLevel( int const powerLevel, void ( PrintManager::*func )( bool const ) );
     void    _pausePrinting( );
+    bool    _waitForLayerRendered( void ( PrintManager::*step )( ) );
     void    _cleanUp( );
     bool    _hasLayerMoreElementsBase();
     bool    _hasLayerMoreElementsBody();
@@ -132,8 +137,7 @@ private slots:
 
 
     void stepB1_start( );
-    void stepB1_completed( );
-    void stepB1_failed( int const exitCode, QProcess::ProcessError const error );
+    void stepB1_completed( bool const success );
 
     void stepB2_start( );
     void stepB2_completed( );
@@ -141,8 +145,7 @@ private slots:
     void stepB2a_start( );
 
     void stepB3_start( );
-    void stepB3_completed( );
-    void stepB3_failed( int const exitCode, QProcess::ProcessError const error );
+    void stepB3_completed( bool const success );
 
     void stepB4a1_start( );
     void stepB4a1_completed( );
@@ -157,8 +160,7 @@ private slots:
     void stepB4b2_completed( bool const success );
 
     void stepC1_start( );
-    void stepC1_completed( );
-    void stepC1_failed( int const exitCode, QProcess::ProcessError const error );
+    void stepC1_completed( bool const success );
 
     void stepC2_start( );
     void stepC2_completed( );
@@ -166,8 +168,7 @@ private slots:
     void stepC2a_start( );
 
     void stepC3_start( );
-    void stepC3_completed( );
-    void stepC3_failed( int const exitCode, QProcess::ProcessError const error );
+    void stepC3_completed( bool const success );
 
     void stepC4a1_start( );
     void stepC4a1_completed( );
@@ -0,0 +1,284 @@
+#include "pch.h"
+
+#include <sys/select.h>
+#include <termios.h>
+
+#include "projectorcontroller.h"
+
+namespace {
+
+#if defined DLP4710 || defined XDLP471020UM
+
+    char const ProjectorDevicePath[] { "/dev/lumen-projector" };
+    int  const ResponseTimeout       { 5 }; // seconds
+    int  const ResponseMaximumLength { 4096 };
+    int  const CommandAttempts       { 3 };
+
+    //
+    // The DLP4710's controller board, over its serial port: the same
+    // commands set-projector-power sends, without reopening and
+    // reconfiguring the port and redoing the handshake every time.
+    //
+
+    class SerialProjectorBackend: public ProjectorBackend {
+
+    public:
+
+        virtual ~SerialProjectorBackend( ) override {
+            close( );
+        }
+
+        virtual bool isOpen( ) const override { return _fd != -1; }
+        virtual bool open( ) override;
+        virtual void close( ) override;
+
+        virtual bool setPowerLevel( int const powerLevel ) override;
+
+    private:
+
+        int _fd         { -1 };
+        int _ledEnabled { -1 }; // -1 until known
+
+        bool _sendCommand( QByteArray const& command );
+        bool _readResponse( QByteArray& response );
+
+    };
+
+    bool SerialProjectorBackend::open( ) {
+        _fd = ::open( ProjectorDevicePath, O_RDWR | O_NOCTTY );
+        if ( -1 == _fd ) {
+            debug( "+ SerialProjectorBackend::open: couldn't open '%s': %s\n", ProjectorDevicePath, strerror( errno ) );
+            return false;
+        }
+
+        termios term { };
+        if ( ( -1 == tcgetattr( _fd, &term ) ) || ( -1 == cfsetispeed( &term, B115200 ) ) || ( -1 == cfsetospeed( &term, B115200 ) ) ) {
+            debug( "+ SerialProjectorBackend::open: couldn't get port settings: %s\n", strerror( errno ) );
+            close( );
+            return false;
+        }
+
+        cfmakeraw( &term );
+        term.c_cc[VMIN]  = 1;
+        term.c_cc[VTIME] = 5;
+
+        if ( -1 == tcsetattr( _fd, TCSANOW, &term ) ) {
+            debug( "+ SerialProjectorBackend::open: couldn't set port settings: %s\n", strerror( errno ) );
+            close( );
+            return false;
+        }
+        tcflush( _fd, TCIOFLUSH );
+
+        if ( !_sendCommand( "WT+PWRE=1" ) ) {
+            close( );
+            return false;
+        }
+
+        debug( "+ SerialProjectorBackend::open: connected to projector\n" );
+        return true;
+    }
+
+    void SerialProjectorBackend::close( ) {
+        if ( -1 != _fd ) {
+            ::close( _fd );
+            _fd = -1;
+        }
+        _ledEnabled = -1;
+    }
+
+    bool SerialProjectorBackend::setPowerLevel( int const powerLevel ) {
+        int const ledEnabled = ( powerLevel > 0 ) ? 1 : 0;
+        if ( ledEnabled != _ledEnabled ) {
+            if ( !_sendCommand( "WT+LEDE=" + QByteArray::number( ledEnabled ) ) ) {
+                close( );
+                return false;
+            }
+            _ledEnabled = ledEnabled;
+        }
+
+        if ( !_sendCommand( "WT+LEDS=" + QByteArray::number( powerLevel ) ) ) {
+            close( );
+            return false;
+        }
+        return true;
+    }
+
+    bool SerialProjectorBackend::_sendCommand( QByteArray const& command ) {
+        QByteArray const line { command + "\r\n" };
+        QByteArray response;
+
+        for ( int attempt = 0; attempt < CommandAttempts; ++attempt ) {
+            auto const rc = ::write( _fd, line.constData( ), line.length( ) );
+            if ( rc != line.length( ) ) {
+                debug( "+ SerialProjectorBackend::_sendCommand: command %s: write failed: %s\n", command.data( ), ( rc < 0 ) ? strerror( errno ) : "short write" );
+                continue;
+            }
+            if ( !_readResponse( response ) ) {
+                debug( "+ SerialProjectorBackend::_sendCommand: command %s: no response\n", command.data( ) );
+                continue;
+            }
+
+            if ( response == "ERROR" ) {
+                debug( "+ SerialProjectorBackend::_sendCommand: command %s: got negative response\n", command.data( ) );
+                return false;
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    bool SerialProjectorBackend::_readResponse( QByteArray& response ) {
+        response.clear( );
+
+        while ( response.length( ) < ResponseMaximumLength ) {
+            fd_set readFds;
+            FD_ZERO( &readFds );
+            FD_SET( _fd, &readFds );
+            timeval timeout { ResponseTimeout, 0 };
+            if ( 1 != select( _fd + 1, &readFds, nullptr, nullptr, &timeout ) ) {
+                return false;
+            }
+
+            char ch;
+            if ( 1 != ::read( _fd, &ch, 1 ) ) {
+                return false;
+            }
+            response.append( ch );
+
+            if ( response.endsWith( "\r\n" ) ) {
+                response.chop( 2 );
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+#else
+
+    //
+    // The DLPC350 is driven over USB HID by set-projector-power, which
+    // LightField isn't linked against; so it's still run once per change,
+    // but the controller's queue and cache save running it needlessly.
+    //
+
+    class ProcessProjectorBackend: public ProjectorBackend {
+
+    public:
+
+        virtual bool isOpen( ) const override { return true; }
+        virtual bool open( ) override { return true; }
+        virtual void close( ) override { /*empty*/ }
+
+        virtual bool setPowerLevel( int const powerLevel ) override {
+            QProcess process;
+            process.start( SetProjectorPowerCommand, { QString::number( powerLevel ) } );
+            if ( !process.waitForFinished( -1 ) || ( process.exitStatus( ) != QProcess::NormalExit ) || ( process.exitCode( ) != 0 ) ) {
+                debug( "+ ProcessProjectorBackend::setPowerLevel: '%s %d' failed: exit code %d, error %s\n", SetProjectorPowerCommand.toUtf8( ).data( ), powerLevel, process.exitCode( ), ToString( process.error( ) ) );
+                return false;
+            }
+            return true;
+        }
+
+    };
+
+#endif // defined DLP4710 || defined XDLP471020UM
+
+}
+
+ProjectorBackend* ProjectorBackend::create( ) {
+#if defined DLP4710 || defined XDLP471020UM
+    return new SerialProjectorBackend;
+#else
+    return new ProcessProjectorBackend;
+#endif // defined DLP4710 || defined XDLP471020UM
+}
+
+bool MockProjectorBackend::open( ) {
+    debug( "+ MockProjectorBackend::open\n" );
+    _isOpen = true;
+    return true;
+}
+
+void MockProjectorBackend::close( ) {
+    debug( "+ MockProjectorBackend::close\n" );
+    _isOpen = false;
+}
+
+bool MockProjectorBackend::setPowerLevel( int const powerLevel ) {
+    debug( "+ MockProjectorBackend::setPowerLevel: %d\n", powerLevel );
+    _powerLevels.append( powerLevel );
+    return true;
+}
+
+ProjectorController::ProjectorController( ProjectorBackend* backend, QObject* parent ):
+    QObject  ( parent  ),
+    _backend { backend }
+{
+    _thread = QThread::create( std::bind( &ProjectorController::_run, this ) );
+    _thread->start( );
+}
+
+// Commands already queued are carried out first, so that the projector is
+// left in the state last asked for.
+ProjectorController::~ProjectorController( ) {
+    {
+        QMutexLocker locker { &_lock };
+        _stopping = true;
+        _wakeUp.wakeOne( );
+    }
+    _thread->wait( );
+
+    delete _thread;
+    delete _backend;
+}
+
+int ProjectorController::setPowerLevel( int const powerLevel ) {
+    QMutexLocker locker { &_lock };
+    int const requestId = _nextRequestId++;
+    _requests.enqueue( { requestId, powerLevel } );
+    _wakeUp.wakeOne( );
+    return requestId;
+}
+
+// Runs on the controller's thread.
+void ProjectorController::_run( ) {
+    while ( true ) {
+        Request request;
+        {
+            QMutexLocker locker { &_lock };
+            while ( _requests.isEmpty( ) && !_stopping ) {
+                _wakeUp.wait( &_lock );
+            }
+            if ( _requests.isEmpty( ) ) {
+                break;
+            }
+            request = _requests.dequeue( );
+        }
+
+        emit powerLevelSet( request.id, _apply( request.powerLevel ) );
+    }
+
+    _backend->close( );
+}
+
+// Runs on the controller's thread.
+bool ProjectorController::_apply( int const powerLevel ) {
+    if ( powerLevel == _powerLevel ) {
+        debug( "+ ProjectorController::_apply: power level is already %d\n", powerLevel );
+        return true;
+    }
+
+    // After a failure the LED's state is anyone's guess, so the next
+    // command always goes through
+    if ( ( !_backend->isOpen( ) && !_backend->open( ) ) || !_backend->setPowerLevel( powerLevel ) ) {
+        debug( "+ ProjectorController::_apply: couldn't set power level to %d\n", powerLevel );
+        _powerLevel = -1;
+        return false;
+    }
+
+    debug( "+ ProjectorController::_apply: power level set to %d\n", powerLevel );
+    _powerLevel = powerLevel;
+    return true;
+}
@@ -0,0 +1,123 @@
+#ifndef __PROJECTORCONTROLLER_H__
+#define __PROJECTORCONTROLLER_H__
+
+#include <QtCore>
+
+//
+// Talks to the projector's LED. A backend does the actual talking; it's only
+// ever used from the controller's own thread, so it needn't be thread-safe.
+//
+
+class ProjectorBackend {
+
+public:
+
+    virtual ~ProjectorBackend( ) {
+        /*empty*/
+    }
+
+    // The backend for the projector this build is for.
+    static ProjectorBackend* create( );
+
+    // Opening does whatever handshaking the projector needs; the link then
+    // stays open until close( ) or a failed command.
+    virtual bool isOpen( ) const = 0;
+    virtual bool open( ) = 0;
+    virtual void close( ) = 0;
+
+    // Raw LED power level, 0..1023; 0 turns the LED off.
+    virtual bool setPowerLevel( int const powerLevel ) = 0;
+
+};
+
+//
+// A backend that remembers what it was told instead of talking to hardware,
+// for running without a projector.
+//
+
+class MockProjectorBackend: public ProjectorBackend {
+
+public:
+
+    virtual bool isOpen( ) const override { return _isOpen; }
+    virtual bool open( ) override;
+    virtual void close( ) override;
+
+    virtual bool setPowerLevel( int const powerLevel ) override;
+
+    // Power levels set, in order; read only while the controller is idle.
+    QList<int> const& powerLevels( ) const { return _powerLevels; }
+
+protected:
+
+private:
+
+    bool       _isOpen { };
+    QList<int> _powerLevels;
+
+};
+
+//
+// Owns a backend and a thread to run it on. Commands queue up and run in
+// order, without blocking the caller; a command that wouldn't change the
+// LED's state is answered without bothering the projector.
+//
+
+class ProjectorController: public QObject {
+
+    Q_OBJECT
+
+public:
+
+    // Takes ownership of the backend.
+    ProjectorController( ProjectorBackend* backend, QObject* parent = nullptr );
+    virtual ~ProjectorController( ) override;
+
+    // Queues a change of LED power level; the returned request number comes
+    // back with powerLevelSet when the change has been made.
+    int setPowerLevel( int const powerLevel );
+
+    // The LED power level last set successfully, or -1 if it isn't known.
+    int powerLevel( ) const { return _powerLevel; }
+
+protected:
+
+private:
+
+    class Request {
+
+    public:
+
+        int id         { };
+        int powerLevel { };
+
+    };
+
+    ProjectorBackend* _backend;
+    QThread*          _thread;
+
+    QMutex            _lock;
+    QWaitCondition    _wakeUp;
+    QQueue<Request>   _requests;
+    int               _nextRequestId { 1 };
+    bool              _stopping      { };
+
+    // Only touched on the controller's thread; readable from anywhere.
+    std::atomic_int   _powerLevel    { -1 };
+
+    void _run( );
+    bool _apply( int const powerLevel );
+
+signals:
+
+    void powerLevelSet( int const requestId, bool const success );
+
+public slots:
+
+protected slots:
+
+private slots:
+
+};
+
+#endif // __PROJECTORCONTROLLER_H__
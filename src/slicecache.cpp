@@ -0,0 +1,317 @@
+#include "pch.h"
+
+#include "slicecache.h"
+
+#include "ordermanifestmanager.h"
+#include "printjob.h"
+
+namespace {
+
+    QString            const SliceCacheIndexFileName    { "slice-cache.json" };
+
+    // Kept free for whatever gets written before the next trim
+    qint64             const SliceCacheFreeSpaceReserve { 256LL * 1024 * 1024 };
+
+    QRegularExpression const JobDirectoryPattern        { "^([0-9A-Fa-f]+-\\d+|tiled-.+|[0-9A-Fa-f]+\\.mesh|[0-9A-Fa-f]+\\.thumbnail\\.png)$" };
+
+    // Changes to the index are written out this long after the first one,
+    // so that a burst of them costs one write
+    int                const SliceCacheSaveDelay        { 5000 };
+
+    // JobWorkingDirectoryPath is walked at most this often, except when
+    // making room for new slices
+    qint64             const SliceCacheRescanInterval   { 10LL * 60 * 1000 };
+
+    class SliceCacheEntry {
+
+    public:
+
+        qint64 size     { -1 }; // -1 until measured
+        qint64 lastUsed {    }; // ms since the epoch
+
+    };
+
+    QMutex                          cacheLock;
+    QHash<QString, SliceCacheEntry> entries;
+    QSet<QString>                   protectedEntries;
+    bool                            loaded        { };
+    bool                            dirty         { };
+    bool                            saveScheduled { };
+    qint64                          lastScan      { };
+
+    // Entries are named by the directory's or file's name in
+    // JobWorkingDirectoryPath. Returns an empty string for anything that
+    // isn't a job directory or cache file.
+    QString entryName( QString const& path ) {
+        QFileInfo const info { QDir::cleanPath( path ) };
+        if ( ( QDir::cleanPath( info.path( ) ) != QDir::cleanPath( JobWorkingDirectoryPath ) ) || !JobDirectoryPattern.match( info.fileName( ) ).hasMatch( ) ) {
+            return { };
+        }
+        return info.fileName( );
+    }
+
+    qint64 entrySize( QString const& path ) {
+        QFileInfo const info { path };
+        if ( !info.isDir( ) ) {
+            return info.exists( ) ? info.size( ) : 0;
+        }
+
+        qint64 size = 0;
+        QDirIterator iter { path, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories };
+        while ( iter.hasNext( ) ) {
+            iter.next( );
+            size += iter.fileInfo( ).size( );
+        }
+        return size;
+    }
+
+    // The functions below are called with cacheLock held.
+
+    void load( ) {
+        if ( loaded ) {
+            return;
+        }
+        loaded = true;
+
+        QFile jsonFile { JobWorkingDirectoryPath % Slash % SliceCacheIndexFileName };
+        if ( !jsonFile.open( QIODevice::ReadOnly ) ) {
+            return;
+        }
+
+        QJsonParseError parseError;
+        QJsonDocument const jsonDocument { QJsonDocument::fromJson( jsonFile.readAll( ), &parseError ) };
+        if ( jsonDocument.isNull( ) ) {
+            debug( "+ SliceCache::load: error parsing slice cache index: %s\n", parseError.errorString( ).toUtf8( ).data( ) );
+            return;
+        }
+
+        QJsonObject const root { jsonDocument.object( ) };
+        for ( auto iter = root.constBegin( ); iter != root.constEnd( ); ++iter ) {
+            QJsonObject const entry { iter.value( ).toObject( ) };
+
+            SliceCacheEntry cacheEntry;
+            cacheEntry.size     = static_cast<qint64>( entry.value( "size" ).toDouble( -1.0 ) );
+            cacheEntry.lastUsed = static_cast<qint64>( entry.value( "used" ).toDouble( ) );
+            entries.insert( iter.key( ), cacheEntry );
+        }
+    }
+
+    void save( ) {
+        QJsonObject root;
+        for ( auto iter = entries.constBegin( ); iter != entries.constEnd( ); ++iter ) {
+            root.insert( iter.key( ), QJsonObject {
+                { "size", static_cast<double>( iter.value( ).size     ) },
+                { "used", static_cast<double>( iter.value( ).lastUsed ) },
+            } );
+        }
+
+        QSaveFile jsonFile { JobWorkingDirectoryPath % Slash % SliceCacheIndexFileName };
+        if ( !QDir { }.mkpath( JobWorkingDirectoryPath ) || !jsonFile.open( QIODevice::WriteOnly ) ) {
+            debug( "+ SliceCache::save: couldn't create '%s'\n", jsonFile.fileName( ).toUtf8( ).data( ) );
+            return;
+        }
+        jsonFile.write( QJsonDocument { root }.toJson( QJsonDocument::Compact ) );
+        jsonFile.commit( );
+    }
+
+    // Writes the index out a little later, on the GUI thread
+    void scheduleSave( ) {
+        dirty = true;
+        if ( saveScheduled || !QCoreApplication::instance( ) ) {
+            return;
+        }
+        saveScheduled = true;
+
+        QMetaObject::invokeMethod( QCoreApplication::instance( ), [] ( ) {
+            QTimer::singleShot( SliceCacheSaveDelay, QCoreApplication::instance( ), [] ( ) {
+                SliceCache::flush( );
+            } );
+        }, Qt::QueuedConnection );
+    }
+
+    void removeEntry( QString const& name ) {
+        // Tiled directories are linked into the model library
+        if ( name.startsWith( "tiled-" ) ) {
+            QString const libraryLink { StlModelLibraryPath % Slash % name };
+            if ( QFileInfo { libraryLink }.isSymLink( ) ) {
+                QFile::remove( libraryLink );
+            }
+        }
+
+        QString const path { JobWorkingDirectoryPath % Slash % name };
+        if ( QFileInfo { path }.isDir( ) ) {
+            QDir { path }.removeRecursively( );
+        } else {
+            QFile::remove( path );
+        }
+        entries.remove( name );
+    }
+
+    // Picks up entries the index doesn't know about, and forgets the ones
+    // that have gone away
+    void scanEntries( ) {
+        QHash<QString, SliceCacheEntry> current;
+        QDirIterator iter { JobWorkingDirectoryPath, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot };
+        while ( iter.hasNext( ) ) {
+            iter.next( );
+            QString const name { iter.fileName( ) };
+            if ( !JobDirectoryPattern.match( name ).hasMatch( ) ) {
+                continue;
+            }
+
+            SliceCacheEntry entry { entries.value( name ) };
+            if ( entry.size < 0 ) {
+                entry.size = entrySize( iter.filePath( ) );
+            }
+            if ( !entry.lastUsed ) {
+                entry.lastUsed = iter.fileInfo( ).lastModified( ).toMSecsSinceEpoch( );
+            }
+            current.insert( name, entry );
+        }
+        entries  = current;
+        lastScan = QDateTime::currentMSecsSinceEpoch( );
+    }
+
+    void trimEntries( qint64 const neededBytes, bool const rescan ) {
+        if ( rescan || ( QDateTime::currentMSecsSinceEpoch( ) - lastScan >= SliceCacheRescanInterval ) ) {
+            scanEntries( );
+        }
+
+        qint64 total = 0;
+        for ( auto const& entry : entries ) {
+            total += entry.size;
+        }
+
+        qint64 const budget = static_cast<qint64>( g_settings.sliceCacheBudget ) * 1024 * 1024;
+        qint64 const wanted = neededBytes + SliceCacheFreeSpaceReserve;
+        QStorageInfo const storage { JobWorkingDirectoryPath };
+        qint64 available = storage.isValid( ) ? storage.bytesAvailable( ) : wanted;
+
+        QStringList names { entries.keys( ) };
+        std::sort( names.begin( ), names.end( ), [] ( QString const& a, QString const& b ) {
+            return entries[a].lastUsed < entries[b].lastUsed;
+        } );
+
+        for ( auto const& name : names ) {
+            if ( ( total <= budget ) && ( available >= wanted ) ) {
+                break;
+            }
+            if ( protectedEntries.contains( name ) ) {
+                continue;
+            }
+
+            qint64 const size = entries[name].size;
+            debug( "+ SliceCache::trim: evicting '%s', %lld bytes\n", name.toUtf8( ).data( ), static_cast<long long>( size ) );
+            removeEntry( name );
+            total     -= size;
+            available += size;
+        }
+
+        if ( ( total > budget ) || ( available < wanted ) ) {
+            debug( "+ SliceCache::trim: still %lld bytes cached and %lld bytes free after evicting everything but the current job\n", static_cast<long long>( total ), static_cast<long long>( available ) );
+        }
+    }
+
+}
+
+void SliceCache::touch( QString const& path ) {
+    QString const name { entryName( path ) };
+    if ( name.isEmpty( ) ) {
+        return;
+    }
+
+    QMutexLocker locker { &cacheLock };
+    load( );
+    entries[name].lastUsed = QDateTime::currentMSecsSinceEpoch( );
+    scheduleSave( );
+}
+
+bool SliceCache::prepare( QString const& path ) {
+    QString const name { entryName( path ) };
+    if ( name.isEmpty( ) ) {
+        QDir { path }.removeRecursively( );
+        return QDir { }.mkpath( path );
+    }
+
+    QMutexLocker locker { &cacheLock };
+    load( );
+
+    // The new output will be about as big as what it replaces
+    qint64 const expectedSize = std::max<qint64>( entries.value( name ).size, 0 );
+    removeEntry( name );
+    trimEntries( expectedSize, true );
+
+    bool const created = QDir { }.mkpath( path );
+    if ( created ) {
+        entries[name].lastUsed = QDateTime::currentMSecsSinceEpoch( );
+    } else {
+        debug( "+ SliceCache::prepare: couldn't create directory '%s'\n", path.toUtf8( ).data( ) );
+    }
+    scheduleSave( );
+    return created;
+}
+
+void SliceCache::update( QString const& path ) {
+    QString const name { entryName( path ) };
+    if ( name.isEmpty( ) ) {
+        return;
+    }
+
+    QMutexLocker locker { &cacheLock };
+    load( );
+
+    SliceCacheEntry& entry = entries[name];
+    entry.size     = entrySize( path );
+    entry.lastUsed = QDateTime::currentMSecsSinceEpoch( );
+    trimEntries( 0, false );
+    scheduleSave( );
+}
+
+void SliceCache::remove( QString const& path ) {
+    QString const name { entryName( path ) };
+    if ( name.isEmpty( ) ) {
+        QDir { path }.removeRecursively( );
+        return;
+    }
+
+    QMutexLocker locker { &cacheLock };
+    load( );
+    removeEntry( name );
+    scheduleSave( );
+}
+
+void SliceCache::trim( qint64 const neededBytes ) {
+    QMutexLocker locker { &cacheLock };
+    load( );
+    trimEntries( neededBytes, true );
+    scheduleSave( );
+}
+
+void SliceCache::protectPrintJob( ) {
+    QSet<QString> active;
+
+    if ( printJob.getBaseManager( ) ) {
+        active.insert( entryName( printJob.getBaseManager( )->path( ) ) );
+    }
+    if ( printJob.getBodyManager( ) ) {
+        active.insert( entryName( printJob.getBodyManager( )->path( ) ) );
+    }
+    if ( !printJob.getModelHash( ).isEmpty( ) ) {
+        active.insert( QString { "%1-%2" }.arg( printJob.getModelHash( ) ).arg( printJob.getSelectedBaseLayerThickness( ) ) );
+        active.insert( QString { "%1-%2" }.arg( printJob.getModelHash( ) ).arg( printJob.getSelectedBodyLayerThickness( ) ) );
+        active.insert( printJob.getModelHash( ) % QString { ".mesh" } );
+    }
+    active.remove( QString { } );
+
+    QMutexLocker locker { &cacheLock };
+    protectedEntries = active;
+}
+
+void SliceCache::flush( ) {
+    QMutexLocker locker { &cacheLock };
+    saveScheduled = false;
+    if ( dirty ) {
+        dirty = false;
+        save( );
+    }
+}
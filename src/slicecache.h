@@ -0,0 +1,55 @@
+#ifndef __SLICECACHE_H__
+#define __SLICECACHE_H__
+
+//
+// Keeps the job directories in JobWorkingDirectoryPath (slice directories,
+// named "<model hash>-<layer thickness>", and "tiled-*" directories) and
+// the cache files next to them ("<model hash>.mesh" and
+// "<model hash>.thumbnail.png") within a disk budget,
+// g_settings.sliceCacheBudget. Each entry's size and last use are kept in an
+// index there, so trimming doesn't have to walk every directory; entries
+// the index doesn't know yet are measured once.
+//
+// When the entries add up to more than the budget, or the disk is running
+// out of room for new output, the least recently used ones are removed
+// first. The directories and mesh cache file of the current print job are
+// never removed.
+//
+// Safe to call from any thread, except protectPrintJob().
+//
+
+class SliceCache {
+
+public:
+
+    // Marks a job directory or cache file as just used, so that it's the
+    // last to go.
+    static void touch( QString const& path );
+
+    // Clears out (or creates) a job directory for new output, first making
+    // room for it. Returns false if the directory couldn't be created.
+    static bool prepare( QString const& path );
+
+    // Measures a job directory or cache file once it has been written.
+    static void update( QString const& path );
+
+    // Removes a job directory and forgets it.
+    static void remove( QString const& path );
+
+    // Evicts directories until the cache is within budget and the disk has
+    // room for the given number of bytes.
+    static void trim( qint64 const neededBytes = 0 );
+
+    // Remembers the current print job's directories and mesh cache file,
+    // whether they've been made yet or not, so that they're never evicted.
+    // printJob belongs to the GUI thread, so this has to be called from there
+    // whenever the job's model, layer thicknesses or slices change.
+    static void protectPrintJob( );
+
+    // Writes the index out now if it has changed. Otherwise changes are
+    // written a few seconds after they're made.
+    static void flush( );
+
+};
+
+#endif // __SLICECACHE_H__
@@ -0,0 +1,310 @@
+#include "pch.h"
+
+#include <unordered_map>
+
+#include "slicer.h"
+
+#include "mesh.h"
+#include "parallel.h"
+
+namespace {
+
+    // Layers each worker cuts per batch. Larger batches keep the workers
+    // busier; smaller ones hand layers to the consumer sooner.
+    int const LayersPerWorker { 8 };
+
+    // A point where a layer's plane crosses a mesh edge. Edges are named by
+    // their upper and lower vertices, so the two triangles that share an
+    // edge agree on its name (and on the crossing point).
+    class Segment {
+
+    public:
+
+        quint64 fromEdge;
+        quint64 toEdge;
+        QPointF from;
+        QPointF to;
+
+    };
+
+    quint64 edgeKey( GLuint const upper, GLuint const lower ) {
+        return ( static_cast<quint64>( upper ) << 32 ) | lower;
+    }
+
+    class EdgeKeyHash {
+
+    public:
+
+        size_t operator()( quint64 const key ) const {
+            // Fibonacci hashing spreads the vertex numbers over the buckets
+            return static_cast<size_t>( ( key * 0x9E3779B97F4A7C15ULL ) >> 16 );
+        }
+
+    };
+
+    QPointF crossing( GLfloat const* vertices, GLuint const upper, GLuint const lower, double const z ) {
+        GLfloat const* a = vertices + static_cast<size_t>( upper ) * 3;
+        GLfloat const* b = vertices + static_cast<size_t>( lower ) * 3;
+        double  const  t = ( z - b[2] ) / ( static_cast<double>( a[2] ) - b[2] );
+        return { b[0] + ( a[0] - b[0] ) * t, b[1] + ( a[1] - b[1] ) * t };
+    }
+
+}
+
+Slicer::Slicer( Mesh const* mesh, double const layerThickness ):
+    _mesh           ( mesh                ),
+    _layerThickness ( layerThickness      ),
+    _threadCount    ( hardware_threads( ) )
+{
+    auto const& statistics = _mesh->statistics( );
+    if ( ( _layerThickness <= 0.0 ) || ( statistics.triangle_count == 0 ) ) {
+        return;
+    }
+
+    // Round the layer count up, so that the top of the model always lands
+    // in a layer; sliceHeight() keeps the last plane inside the model.
+    _layerCount = static_cast<int>( std::ceil( statistics.z.size / _layerThickness - 1e-6 ) );
+}
+
+double Slicer::sliceHeight( int const layer ) const {
+    double const zMin   = _mesh->zmin( );
+    double const bottom = zMin + layer * _layerThickness;
+    double const top    = std::min<double>( bottom + _layerThickness, _mesh->zmax( ) );
+    return ( bottom + top ) / 2.0;
+}
+
+bool Slicer::slice( LayerConsumer consume ) const {
+    unsigned const threads       = _threadCount;
+    int      const batchSize     = static_cast<int>( threads ) * LayersPerWorker;
+    size_t   const triangleCount = _mesh->triangle_count( );
+    GLfloat  const* vertices     = _mesh->vertex_data( );
+    GLuint   const* indices      = _mesh->index_data( );
+
+    if ( !_layerCount ) {
+        return true;
+    }
+
+    // The sweep index: each triangle's vertical extent, and the triangles
+    // in order of their lowest point
+    std::vector<float>  triangleMinZ( triangleCount );
+    std::vector<float>  triangleMaxZ( triangleCount );
+    std::vector<GLuint> sweepOrder( triangleCount );
+    parallel_for( triangleCount, triangleCount < 65536 ? 1 : threads, [&] ( size_t first, size_t last ) {
+        for ( size_t t = first; t < last; ++t ) {
+            float const z0 = vertices[static_cast<size_t>( indices[t * 3    ] ) * 3 + 2];
+            float const z1 = vertices[static_cast<size_t>( indices[t * 3 + 1] ) * 3 + 2];
+            float const z2 = vertices[static_cast<size_t>( indices[t * 3 + 2] ) * 3 + 2];
+            triangleMinZ[t] = std::min( { z0, z1, z2 } );
+            triangleMaxZ[t] = std::max( { z0, z1, z2 } );
+            sweepOrder[t]   = static_cast<GLuint>( t );
+        }
+    } );
+    std::sort( sweepOrder.begin( ), sweepOrder.end( ), [&triangleMinZ] ( GLuint const a, GLuint const b ) {
+        return triangleMinZ[a] < triangleMinZ[b];
+    } );
+
+    // Triangles that span some layer of the current batch, still in order
+    // of their lowest point
+    std::vector<GLuint> batchTriangles;
+    size_t nextTriangle = 0;
+
+    for ( int firstLayer = 0; firstLayer < _layerCount; firstLayer += batchSize ) {
+        int    const lastLayer = std::min( firstLayer + batchSize, _layerCount );
+        double const bottomZ   = sliceHeight( firstLayer );
+        double const topZ      = sliceHeight( lastLayer - 1 );
+
+        // A triangle crosses the plane at z when at least one vertex is
+        // above it and at least one is on or below it.
+        batchTriangles.erase( std::remove_if( batchTriangles.begin( ), batchTriangles.end( ), [&triangleMaxZ, bottomZ] ( GLuint const t ) {
+            return triangleMaxZ[t] <= bottomZ;
+        } ), batchTriangles.end( ) );
+        while ( ( nextTriangle < triangleCount ) && ( triangleMinZ[sweepOrder[nextTriangle]] <= topZ ) ) {
+            GLuint const t = sweepOrder[nextTriangle++];
+            if ( triangleMaxZ[t] > bottomZ ) {
+                batchTriangles.push_back( t );
+            }
+        }
+
+        std::vector<SliceLayer> layers( lastLayer - firstLayer );
+        parallel_for( layers.size( ), threads, [&] ( size_t first, size_t last ) {
+            // Each worker sweeps its own run of layers through the batch
+            std::vector<GLuint> triangles;
+            size_t next = 0;
+            for ( size_t n = first; n < last; ++n ) {
+                int    const layer = firstLayer + static_cast<int>( n );
+                double const z     = sliceHeight( layer );
+
+                triangles.erase( std::remove_if( triangles.begin( ), triangles.end( ), [&triangleMaxZ, z] ( GLuint const t ) {
+                    return triangleMaxZ[t] <= z;
+                } ), triangles.end( ) );
+                while ( ( next < batchTriangles.size( ) ) && ( triangleMinZ[batchTriangles[next]] <= z ) ) {
+                    GLuint const t = batchTriangles[next++];
+                    if ( triangleMaxZ[t] > z ) {
+                        triangles.push_back( t );
+                    }
+                }
+
+                layers[n] = _sliceLayer( layer, z, triangles );
+            }
+        } );
+
+        for ( auto& layer : layers ) {
+            if ( !consume( std::move( layer ) ) ) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+SliceLayer Slicer::_sliceLayer( int const layer, double const z, std::vector<GLuint> const& triangles ) const {
+    GLfloat const* vertices = _mesh->vertex_data( );
+    GLuint  const* indices  = _mesh->index_data( );
+
+    SliceLayer slice;
+    slice.index = layer;
+    slice.z     = z;
+
+    // Cut each triangle. Seen from outside the model, a triangle's vertices
+    // run counterclockwise; walking from the edge where it goes down
+    // through the plane to the edge where it comes back up keeps the
+    // material on the left, which makes outer loops counterclockwise.
+    std::vector<Segment> segments;
+    segments.reserve( triangles.size( ) );
+    for ( auto const t : triangles ) {
+        GLuint const* v = indices + static_cast<size_t>( t ) * 3;
+        bool const above[3] {
+            vertices[static_cast<size_t>( v[0] ) * 3 + 2] > z,
+            vertices[static_cast<size_t>( v[1] ) * 3 + 2] > z,
+            vertices[static_cast<size_t>( v[2] ) * 3 + 2] > z,
+        };
+
+        Segment segment;
+        for ( int k = 0; k < 3; ++k ) {
+            int const j = ( k + 1 ) % 3;
+            if ( above[k] && !above[j] ) {
+                segment.fromEdge = edgeKey( v[k], v[j] );
+                segment.from     = crossing( vertices, v[k], v[j], z );
+            } else if ( !above[k] && above[j] ) {
+                segment.toEdge   = edgeKey( v[j], v[k] );
+                segment.to       = crossing( vertices, v[j], v[k], z );
+            }
+        }
+        segments.push_back( segment );
+    }
+
+    std::unordered_map<quint64, size_t, EdgeKeyHash> segmentsByStart;
+    segmentsByStart.reserve( segments.size( ) );
+    for ( size_t n = 0; n < segments.size( ); ++n ) {
+        segmentsByStart.emplace( segments[n].fromEdge, n );
+    }
+
+    // Open chains (from holes in the mesh) have to be followed from their
+    // first segment, or they'd come out in pieces; everything else is a
+    // closed loop and can be started anywhere.
+    std::vector<bool> hasPredecessor( segments.size( ) );
+    for ( auto const& segment : segments ) {
+        auto const iter = segmentsByStart.find( segment.toEdge );
+        if ( iter != segmentsByStart.end( ) ) {
+            hasPredecessor[iter->second] = true;
+        }
+    }
+
+    std::vector<bool> used( segments.size( ) );
+    int openChains = 0;
+    auto follow = [&] ( size_t const start ) {
+        QPolygonF loop;
+        for ( size_t n = start; ; ) {
+            used[n] = true;
+            if ( loop.isEmpty( ) || ( loop.last( ) != segments[n].from ) ) {
+                loop.append( segments[n].from );
+            }
+
+            auto const iter = segmentsByStart.find( segments[n].toEdge );
+            if ( ( iter == segmentsByStart.end( ) ) || used[iter->second] ) {
+                if ( ( iter == segmentsByStart.end( ) ) || ( iter->second != start ) ) {
+                    ++openChains;
+                    loop.append( segments[n].to );
+                }
+                break;
+            }
+            n = iter->second;
+        }
+
+        if ( loop.count( ) > 2 ) {
+            slice.loops.append( loop );
+        }
+    };
+
+    for ( size_t n = 0; n < segments.size( ); ++n ) {
+        if ( !hasPredecessor[n] && !used[n] ) {
+            follow( n );
+        }
+    }
+    for ( size_t n = 0; n < segments.size( ); ++n ) {
+        if ( !used[n] ) {
+            follow( n );
+        }
+    }
+
+    if ( openChains ) {
+        debug( "+ Slicer::_sliceLayer: layer %d: %d open contours; the mesh has holes\n", layer, openChains );
+    }
+    return slice;
+}
+
+LayerSubsampler::LayerSubsampler( Slicer const& fine, Slicer const& coarse ):
+    _fine   ( fine   ),
+    _coarse ( coarse )
+{
+    /*empty*/
+}
+
+// Finds the fine layer or pair of fine layers whose planes are nearest
+// to the coarse layer's plane.
+void LayerSubsampler::_sourceLayers( int const layer, int& first, int& last ) const {
+    double const z         = _coarse.sliceHeight( layer );
+    double const thickness = _fine.layerThickness( );
+    double const tolerance = thickness / 1000.0;
+    int    const lastFine  = _fine.layerCount( ) - 1;
+
+    int const below = qBound( 0, static_cast<int>( std::floor( ( z - _fine.sliceHeight( 0 ) ) / thickness + 1e-6 ) ), lastFine );
+    double const belowZ = _fine.sliceHeight( below );
+
+    first = last = below;
+    if ( std::fabs( belowZ - z ) <= tolerance ) {
+        return;
+    }
+    if ( ( belowZ < z ) && ( below < lastFine ) ) {
+        last = below + 1;
+    } else if ( ( belowZ > z ) && ( below > 0 ) ) {
+        first = below - 1;
+    }
+}
+
+bool LayerSubsampler::add( SliceLayer const& fineLayer, Slicer::LayerConsumer const& consume ) {
+    while ( _nextLayer < _coarse.layerCount( ) ) {
+        int first, last;
+        _sourceLayers( _nextLayer, first, last );
+        if ( last > fineLayer.index ) {
+            break;
+        }
+
+        SliceLayer layer;
+        layer.index = _nextLayer;
+        layer.z     = _coarse.sliceHeight( _nextLayer );
+        if ( ( first < fineLayer.index ) && ( _previous.index == first ) ) {
+            layer.loops += _previous.loops;
+        }
+        layer.loops += fineLayer.loops;
+
+        ++_nextLayer;
+        if ( !consume( std::move( layer ) ) ) {
+            return false;
+        }
+    }
+
+    _previous = fineLayer;
+    return true;
+}
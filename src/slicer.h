@@ -0,0 +1,105 @@
+#ifndef __SLICER_H__
+#define __SLICER_H__
+
+class Mesh;
+
+//
+// One slice through a model. Each loop is a closed outline in model
+// coordinates (mm). For a closed mesh with outward-facing triangles, loops
+// around solid material run counterclockwise seen from above and loops
+// around holes run clockwise, so the layer fills correctly under the
+// nonzero winding rule without sorting out which loop is which.
+//
+
+class SliceLayer {
+
+public:
+
+    int                index { };
+    double             z     { };
+    QVector<QPolygonF> loops;
+
+};
+
+//
+// Slices an indexed mesh into layers of equal thickness, starting at the
+// bottom of the model. Each layer is cut through the middle of its slab.
+//
+// Triangles are sorted by their lowest point and swept upwards, so each
+// layer only looks at the triangles that span it. Batches of layers are
+// cut in parallel. Within a layer, the segments are joined into loops by
+// the mesh edges they cross, which is exact because Loader has already
+// merged duplicate vertices.
+//
+
+class Slicer {
+
+public:
+
+    // Receives each layer in order; returns false to stop slicing.
+    using LayerConsumer = std::function<bool( SliceLayer&& layer )>;
+
+    Slicer( Mesh const* mesh, double const layerThickness );
+
+    int    layerCount( )                    const { return _layerCount; }
+    double layerThickness( )                const { return _layerThickness; }
+
+    // Defaults to every core; lower it when something else is running
+    // alongside.
+    void   setThreadCount( unsigned const threads ) { _threadCount = std::max( 1u, threads ); }
+
+    // Height of the plane that cuts the given layer.
+    double sliceHeight( int const layer )   const;
+
+    // Hands the layers to consume on the calling thread as they're cut.
+    // Returns false if the consumer stopped early.
+    bool   slice( LayerConsumer consume )   const;
+
+protected:
+
+private:
+
+    Mesh const* _mesh;
+    double      _layerThickness;
+    int         _layerCount      { };
+    unsigned    _threadCount;
+
+    SliceLayer _sliceLayer( int const layer, double const z, std::vector<GLuint> const& triangles ) const;
+
+};
+
+//
+// Builds a coarse set of layers out of a fine one, when the coarse layer
+// thickness is a whole multiple of the fine. A coarse layer cut through
+// the same plane as a fine layer (odd multiples) copies that layer; one
+// cut on the boundary between two fine layers (even multiples) takes the
+// union of both, which under the nonzero rule is just their loops
+// together. Either way the coarse layers have the same count and heights
+// as if the model had been sliced at the coarse thickness.
+//
+
+class LayerSubsampler {
+
+public:
+
+    LayerSubsampler( Slicer const& fine, Slicer const& coarse );
+
+    // Takes the fine layers in order, and hands each coarse layer to
+    // consume as soon as the fine layers it's made from have arrived.
+    // Returns false if the consumer stopped.
+    bool add( SliceLayer const& fineLayer, Slicer::LayerConsumer const& consume );
+
+protected:
+
+private:
+
+    Slicer const& _fine;
+    Slicer const& _coarse;
+    SliceLayer    _previous;
+    int           _nextLayer { };
+
+    void _sourceLayers( int const layer, int& first, int& last ) const;
+
+};
+
+#endif // __SLICER_H__
@@ -1,8 +1,75 @@
-#include <sys/sysinfo.h>
+#include "pch.h"
+
 #include <QtCore>
-#include "svgrenderer.h"
+#include "layerrenderer.h"
+#include "loader.h"
+#include "mesh.h"
+#include "parallel.h"
+#include "slicecache.h"
+#include "slicer.h"
 #include "slicertask.h"
 
+namespace
+{
+    /* Layer images cover the model's footprint, seen from above with y
+     * pointing down the image */
+    QSize layerImageSize(const Mesh &mesh)
+    {
+        return QSize(
+            static_cast<int>((mesh.xmax() - mesh.xmin()) / ProjectorPixelSize + 0.5),
+            static_cast<int>((mesh.ymax() - mesh.ymin()) / ProjectorPixelSize + 0.5));
+    }
+
+    /* The rasterizer's finest step; coordinates are rounded to it, so that
+     * layers cut through the same walls at different heights come out
+     * identical and are only rendered once */
+    double const LayerCoordinateStep { 1.0 / 256.0 };
+
+    /* A layer's loops in projector pixels from the corner of the image.
+     * Outlines and holes wind in opposite directions, so the nonzero fill
+     * rule sorts them out. */
+    QVector<QPolygonF> layerPolygons(const Mesh &mesh, const SliceLayer &layer)
+    {
+        QVector<QPolygonF> polygons;
+        polygons.reserve(layer.loops.count());
+        for (auto const &loop : layer.loops) {
+            if (loop.count() < 3)
+                continue;
+
+            QPolygonF polygon;
+            polygon.reserve(loop.count());
+            for (auto const &point : loop) {
+                double x = (point.x() - mesh.xmin()) / ProjectorPixelSize;
+                double y = (mesh.ymax() - point.y()) / ProjectorPixelSize;
+                polygon.append(QPointF(std::round(x / LayerCoordinateStep) * LayerCoordinateStep,
+                    std::round(y / LayerCoordinateStep) * LayerCoordinateStep));
+            }
+            polygons.append(polygon);
+        }
+        return polygons;
+    }
+
+    /* Layers that have to be rendered before a print may start; after
+     * that, rendering keeps ahead of the printer, which waits with the
+     * projector off if it ever catches up */
+    int const LayersRenderedBeforePrinting { 20 };
+
+    /* Lists the images the renderer is going to write, so that the print
+     * knows every layer before they all exist */
+    QSharedPointer<OrderManifestManager> layerManifest(const QString &directory, int layerCount)
+    {
+        QSharedPointer<OrderManifestManager> manager { new OrderManifestManager };
+        QStringList fileNames;
+
+        for (int layer = 0; layer < layerCount; ++layer)
+            fileNames.append(QString("%1.png").arg(layer, 6, 10, DigitZero));
+        manager->setFileList(fileNames);
+        manager->setPath(directory);
+        manager->startRendering();
+        return manager;
+    }
+}
+
 SlicerTask::SlicerTask(QString basePath, bool sliceBase,
     QString bodyPath, bool sliceBody, QObject *parent):
     QObject(parent),
@@ -22,106 +89,226 @@ void SlicerTask::run()
     if (oneHeight)
         debug("  + base and body layers are the same height\n");
 
+    std::unique_ptr<Mesh> mesh;
+    QSharedPointer<OrderManifestManager> baseManager;
+    QSharedPointer<OrderManifestManager> bodyManager;
+
     try {
-        if (printJob.hasBaseLayers() && _sliceBase) {
-            /* Need to reslice base layers */
-            QDir dir { QDir(_basePath) };
-            QString output { QString("%1/sliced.svg").arg(dir.path()) };
+        int baseHeight = printJob.getSelectedBaseLayerThickness();
+        int bodyHeight = printJob.getSelectedBodyLayerThickness();
+        bool sliceBase = printJob.hasBaseLayers() && _sliceBase;
+        bool sliceBody = _sliceBody && !oneHeight;
 
-            debug("  + must reslice base layers into %s\n", output.toUtf8().data());
-            emit sliceStatus("base layers");
+        /* When both base and body layers need work, they run side by side
+         * with half of the cores each */
+        unsigned threads = hardware_threads();
+        unsigned baseThreads = (sliceBase && sliceBody) ? std::max(1u, threads / 2) : threads;
+        unsigned bodyThreads = (sliceBase && sliceBody) ? std::max(1u, threads - baseThreads) : threads;
+
+        if (sliceBase || sliceBody) {
+            emit sliceStatus(QString(), "loading model");
+            mesh.reset(_loadMesh());
+        }
+        if (sliceBase) {
             _createDirectory(_basePath);
-            _slice(printJob.getModelFilename(), output, printJob.getSelectedBaseLayerThickness());
+            baseManager = layerManifest(_basePath, Slicer(mesh.get(), baseHeight / 1000.0).layerCount());
         }
-
-        if (_sliceBody && !oneHeight) {
-            /* Need to reslice body layers */
-            QString output { QString("%1/sliced.svg").arg(_bodyPath) };
-
-            debug("  + must reslice body layers into %s\n", output.toUtf8().data());
-            emit sliceStatus("body layers");
+        if (sliceBody) {
             _createDirectory(_bodyPath);
-            _slice(printJob.getModelFilename(), output, printJob.getSelectedBodyLayerThickness());
+            bodyManager = layerManifest(_bodyPath, Slicer(mesh.get(), bodyHeight / 1000.0).layerCount());
         }
+        if (sliceBase || sliceBody)
+            emit managersReady(baseManager, (oneHeight && sliceBase) ? baseManager : bodyManager);
 
-        emit sliceStatus("finished");
+        /* Each layer is handed to the renderer as soon as it's cut, so
+         * rendering overlaps slicing and no layer outlines are kept */
+        if (sliceBase && sliceBody && _isWholeMultiple(baseHeight, bodyHeight)) {
+            /* The coarser layers' planes are among (or halfway between) the
+             * finer layers' planes, so one slicing pass serves both */
+            debug("  + must reslice and render base and body layers in one pass\n");
+            emit sliceStatus(QString(), "base and body layers");
 
-        if (printJob.hasBaseLayers() && _sliceBase) {
-            /* Need to render base layers */
+            LayerRenderer baseRenderer;
+            LayerRenderer bodyRenderer;
+            _startRendering(baseRenderer, *mesh, _basePath, baseManager, false, baseThreads);
+            _startRendering(bodyRenderer, *mesh, _bodyPath, bodyManager, true, bodyThreads);
+            if (baseHeight < bodyHeight)
+                _sliceOnce(*mesh, baseRenderer, baseHeight, bodyRenderer, bodyHeight);
+            else
+                _sliceOnce(*mesh, bodyRenderer, bodyHeight, baseRenderer, baseHeight);
 
-            debug("  + must render base layers\n");
-            _render(_basePath, false);
-        }
+            mesh.reset();
+            emit sliceStatus(QString(), "finished");
+
+            _finishRendering(baseRenderer, _basePath, baseManager);
+            _finishRendering(bodyRenderer, _bodyPath, bodyManager);
+        } else if (sliceBase && sliceBody) {
+            debug("  + must reslice and render base and body layers side by side\n");
+            _runConcurrently(
+                [&]() { _slice(*mesh, _basePath, baseManager, false, baseHeight, "base", baseThreads); },
+                [&]() { _slice(*mesh, _bodyPath, bodyManager, true, bodyHeight, "body", bodyThreads); });
 
-        if (oneHeight) {
-            printJob.setBodyManager(printJob.getBaseManager());
+            mesh.reset();
+            emit sliceStatus(QString(), "finished");
         } else {
-            if (_sliceBody) {
-                /* Need to render body layers */
+            if (sliceBase) {
+                /* Need to reslice and render base layers */
+                debug("  + must reslice and render base layers into %s\n", _basePath.toUtf8().data());
+                _slice(*mesh, _basePath, baseManager, false, baseHeight, "base", baseThreads);
+            }
 
-                 debug("  + must rendes body layers\n");
-                _render(_bodyPath, true);
+            if (sliceBody) {
+                /* Need to reslice and render body layers */
+                debug("  + must reslice and render body layers into %s\n", _bodyPath.toUtf8().data());
+                _slice(*mesh, _bodyPath, bodyManager, true, bodyHeight, "body", bodyThreads);
             }
-        }
 
-        emit layerCount(printJob.totalLayerCount());
+            mesh.reset();
+            emit sliceStatus(QString(), "finished");
+        }
     } catch (const std::exception &ex) {
         debug("  + caught exception: %s\n", ex.what());
+
+        /* A print that has already started stops at the first missing layer */
+        for (auto const &manager : { baseManager, bodyManager })
+            if (manager && manager->isRendering())
+                manager->finishRendering(false);
+
+        emit sliceStatus(QString(), "idle");
+        emit renderStatus(QString(), "idle");
         emit done(false);
+        return;
     }
 
     debug("  + finished successfully\n");
-    emit sliceStatus("idle");
-    emit renderStatus("idle");
+    emit sliceStatus(QString(), "idle");
+    emit renderStatus(QString(), "idle");
     emit done(true);
 }
 
-int SlicerTask::_numThreads()
+Mesh* SlicerTask::_loadMesh()
 {
-    return get_nprocs();
+    /* The mesh cache is keyed by the same hash as the slice directories, so
+     * a model that has been opened in FileTab doesn't have to be parsed
+     * again. Loader also takes care of compressed models. */
+    Loader loader { printJob.getModelFilename() };
+    Mesh* mesh = loader.load_mesh(printJob.getModelHash());
+
+    if (!mesh)
+        throw std::runtime_error("Couldn't load model");
+    if (mesh->empty()) {
+        delete mesh;
+        throw std::runtime_error("Model is empty");
+    }
+    return mesh;
 }
 
-void SlicerTask::_slice(const QString &input, const QString &output, int layerHeight)
+void SlicerTask::_slice(const Mesh &mesh, const QString &directory, QSharedPointer<OrderManifestManager> manager,
+    bool isBody, int layerHeight, const QString &stream, unsigned threads)
 {
-    QProcess* process = new QProcess();
-    QStringList slicerArgs = {
-        input,
-        "--export-svg",
-        "--threads", QString("%1").arg(_numThreads()),
-        "--first-layer-height", QString("%1").arg(layerHeight / 1000.0),
-        "--layer-height", QString("%1").arg(layerHeight / 1000.0),
-        "--output", output
-    };
-
-    process->setProcessChannelMode(QProcess::ForwardedChannels);
-    process->start("slic3r", slicerArgs);
-    process->waitForFinished(-1);
-
-    if (process->exitCode() != 0)
-        throw std::runtime_error("Slicer process crashed");
+    debug(QString("+ SlicerTask::_slice %1 at %2 µm on %3 threads\n").arg(directory).arg(layerHeight).arg(threads).toUtf8().data());
+
+    Slicer slicer { &mesh, layerHeight / 1000.0 };
+    LayerRenderer renderer;
+    int reported = -1;
+
+    _startRendering(renderer, mesh, directory, manager, isBody, threads);
+    slicer.setThreadCount(threads);
+    slicer.slice([&](SliceLayer &&layer) {
+        int percent = 100 * (layer.index + 1) / slicer.layerCount();
+        if (percent != reported) {
+            reported = percent;
+            emit sliceStatus(stream, QString("%1%").arg(percent));
+        }
+        renderer.addLayer(layerPolygons(mesh, layer));
+        return true;
+    });
+    _finishRendering(renderer, directory, manager);
+
+    debug("  + %d layers\n", slicer.layerCount());
 }
 
-void SlicerTask::_render(const QString &directory, bool isBody)
+bool SlicerTask::_isWholeMultiple(int firstHeight, int secondHeight)
 {
-    debug(QString("+ SlicerTask::_render %1\n").arg(directory).toUtf8().data());
+    int fine = std::min(firstHeight, secondHeight);
+    int coarse = std::max(firstHeight, secondHeight);
 
-    QSharedPointer<OrderManifestManager> manager { new OrderManifestManager };
-    QString sliced;
-    SvgRenderer renderer;
+    return fine > 0 && coarse % fine == 0;
+}
 
-    if (isBody)
-        QObject::connect(&renderer, &SvgRenderer::layerComplete, this, &SlicerTask::_bodyLayerDone);
-    else
-        QObject::connect(&renderer, &SvgRenderer::layerComplete, this, &SlicerTask::_baseLayerDone);
+void SlicerTask::_sliceOnce(const Mesh &mesh, LayerRenderer &fineRenderer, int fineHeight,
+    LayerRenderer &coarseRenderer, int coarseHeight)
+{
+    debug(QString("+ SlicerTask::_sliceOnce at %1 µm, deriving %2 µm\n").arg(fineHeight).arg(coarseHeight).toUtf8().data());
 
-    sliced = QString("%1/sliced.svg").arg(directory);
+    Slicer fine { &mesh, fineHeight / 1000.0 };
+    Slicer coarse { &mesh, coarseHeight / 1000.0 };
+    LayerSubsampler subsampler { fine, coarse };
+    int reported = -1;
 
-    renderer.render(sliced, directory, manager);
+    fine.slice([&](SliceLayer &&layer) {
+        int percent = 100 * (layer.index + 1) / fine.layerCount();
+        if (percent != reported) {
+            reported = percent;
+            emit sliceStatus(QString(), QString("base and body layers %1%").arg(percent));
+        }
+        if (!subsampler.add(layer, [&](SliceLayer &&coarseLayer) {
+                coarseRenderer.addLayer(layerPolygons(mesh, coarseLayer));
+                return true;
+            }))
+            return false;
+        fineRenderer.addLayer(layerPolygons(mesh, layer));
+        return true;
+    });
+
+    debug("  + %d and %d layers\n", fine.layerCount(), coarse.layerCount());
+}
+
+void SlicerTask::_startRendering(LayerRenderer &renderer, const Mesh &mesh, const QString &directory,
+    QSharedPointer<OrderManifestManager> manager, bool isBody, int threads)
+{
+    debug(QString("+ SlicerTask::_startRendering %1 on up to %2 threads\n").arg(directory).arg(threads).toUtf8().data());
+
+    renderer.setMaximumThreadCount(threads);
 
     if (isBody)
-        printJob.setBodyManager(manager);
+        QObject::connect(&renderer, &LayerRenderer::layerComplete, this, &SlicerTask::_bodyLayerDone);
     else
-        printJob.setBaseManager(manager);
+        QObject::connect(&renderer, &LayerRenderer::layerComplete, this, &SlicerTask::_baseLayerDone);
+
+    /* The manager is already in printJob; the print may be running from it */
+    renderer.begin(layerImageSize(mesh), directory, manager);
+}
+
+void SlicerTask::_finishRendering(LayerRenderer &renderer, const QString &directory,
+    QSharedPointer<OrderManifestManager> manager)
+{
+    renderer.finish();
+    manager->finishRendering(true);
+    SliceCache::update(directory);
+}
+
+void SlicerTask::_runConcurrently(std::function<void()> base, std::function<void()> body)
+{
+    /* Both sides work on run()'s locals, so neither may be abandoned when
+     * the other fails; the first error is rethrown once both are done */
+    std::future<void> baseDone { std::async(std::launch::async, base) };
+    std::exception_ptr failure;
+
+    try {
+        body();
+    } catch (...) {
+        failure = std::current_exception();
+    }
+    try {
+        baseDone.get();
+    } catch (...) {
+        if (!failure)
+            failure = std::current_exception();
+    }
+
+    if (failure)
+        std::rethrow_exception(failure);
 }
 
 void SlicerTask::_createDirectory(const QString &path)
@@ -131,19 +318,37 @@ void SlicerTask::_createDirectory(const QString &path)
     Q_ASSERT(workDir.path().length() > 0);
     Q_ASSERT(workDir.path().startsWith(JobWorkingDirectoryPath));
 
-    workDir.removeRecursively();
-    workDir.mkdir(workDir.path());
+    /* Makes room on the disk first, so rendering doesn't run out of it */
+    if (!SliceCache::prepare(workDir.path()))
+        throw std::runtime_error("Couldn't create slice directory");
 }
 
 void SlicerTask::_baseLayerDone(int layer, const QString &path)
 {
-    emit renderStatus(QString("base layer %1").arg(layer));
+    emit renderStatus("base", QString("layer %1").arg(layer));
     emit layerDone(layer, path);
+    _checkLayersReady();
 }
 
 void SlicerTask::_bodyLayerDone(int layer, const QString &path)
 {
-    emit renderStatus(QString("body layer %1").arg(layer));
+    emit renderStatus("body", QString("layer %1").arg(layer));
     emit layerDone(layer, path);
+    _checkLayersReady();
 }
 
+void SlicerTask::_checkLayersReady()
+{
+    if (_layersReady)
+        return;
+
+    int needed = std::min(LayersRenderedBeforePrinting, printJob.totalLayerCount());
+    for (int layer = 0; layer < needed; ++layer) {
+        if (!printJob.isLayerRendered(layer))
+            return;
+    }
+
+    debug("+ SlicerTask::_checkLayersReady: first %d layers are rendered\n", needed);
+    _layersReady = true;
+    emit layersReady();
+}
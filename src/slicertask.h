@@ -4,10 +4,8 @@
 #include <QtCore>
 #include "printjob.h"
 
-class Slicer
-{
-
-};
+class LayerRenderer;
+class Mesh;
 
 class SlicerTask: public QObject, public QRunnable
 {
@@ -19,24 +17,42 @@ public:
     virtual void run() override;
 
 signals:
-    void sliceStatus(const QString &status);
-    void renderStatus(const QString &status);
-    void layerCount(int count);
+    /* stream is "base" or "body" while base and body layers are being
+     * worked on side by side, and empty for the task as a whole */
+    void sliceStatus(const QString &stream, const QString &status);
+    void renderStatus(const QString &stream, const QString &status);
+    /* The manifests of the layers about to be rendered, before any of them
+     * are; either is null if those layers aren't being resliced. printJob
+     * belongs to the GUI thread, so the receiver puts them there. */
+    void managersReady(QSharedPointer<OrderManifestManager> baseManager,
+        QSharedPointer<OrderManifestManager> bodyManager);
     void layerDone(int layer, QString path);
+    /* Enough layers are rendered to start printing while the rest follow */
+    void layersReady();
     void done(bool success);
 
 protected:
-    int _numThreads();
-    void _slice(const QString &input, const QString &output, int layerHeight);
-    void _render(const QString &directory, bool isBody);
+    Mesh* _loadMesh();
+    void _slice(const Mesh &mesh, const QString &directory, QSharedPointer<OrderManifestManager> manager,
+        bool isBody, int layerHeight, const QString &stream, unsigned threads);
+    bool _isWholeMultiple(int firstHeight, int secondHeight);
+    void _sliceOnce(const Mesh &mesh, LayerRenderer &fineRenderer, int fineHeight,
+        LayerRenderer &coarseRenderer, int coarseHeight);
+    void _startRendering(LayerRenderer &renderer, const Mesh &mesh, const QString &directory,
+        QSharedPointer<OrderManifestManager> manager, bool isBody, int threads);
+    void _finishRendering(LayerRenderer &renderer, const QString &directory,
+        QSharedPointer<OrderManifestManager> manager);
+    void _runConcurrently(std::function<void()> base, std::function<void()> body);
     void _createDirectory(const QString &path);
     void _baseLayerDone(int layer, const QString &path);
     void _bodyLayerDone(int layer, const QString &path);
+    void _checkLayersReady();
 
     QString _basePath;
     QString _bodyPath;
     bool _sliceBase;
     bool _sliceBody;
+    bool _layersReady { false };
 };
 
 #endif // SLICERTASK_H
@@ -1,6 +1,7 @@
 #include <QtCore>
 #include <QtWidgets>
 #include "constants.h"
+#include "layerarchive.h"
 #include "progressdialog.h"
 #include "slicesorderpopup.h"
 #include "utils.h"
@@ -113,17 +114,30 @@ SlicesOrderPopup::SlicesOrderPopup(QSharedPointer<OrderManifestManager> manifest
 void SlicesOrderPopup::fillModel( ) {
     debug( "+ SlicesOrderPopup::fillModel \n" );
 
+    QStringList fileNames;
     QDirIterator iter { _manifestManager->path(), QDir::Files };
     debug( "+ SlicesOrderPopup::fillModel iterating over files\n" );
     while( iter.hasNext( ) )
     {
-        QString fileName = iter.next( );
-        debug( "+ SlicesOrderPopup::fillModel \"%s\"\n",  GetFileBaseName( fileName ).toUtf8().data() );
+        QString fileName = GetFileBaseName( iter.next( ) );
+        debug( "+ SlicesOrderPopup::fillModel \"%s\"\n",  fileName.toUtf8().data() );
 
-        if( GetFileBaseName(fileName ) == GetFileBaseName( ManifestFilename ) )
+        if( fileName == GetFileBaseName( ManifestFilename ) || fileName == LayerArchiveFileName )
             continue;
 
-        QStandardItem* fileNameCol = new QStandardItem { GetFileBaseName ( fileName ) };
+        fileNames.append( fileName );
+    }
+
+    /* layers packed into the directory's archive are listed like files */
+    for( auto const& fileName : ArchivedLayerNames( _manifestManager->path() ) )
+    {
+        if( !fileNames.contains( fileName ) )
+            fileNames.append( fileName );
+    }
+
+    for( auto const& fileName : fileNames )
+    {
+        QStandardItem* fileNameCol = new QStandardItem { fileName };
         QStandardItem* checkBoxCol = new QStandardItem;
 
 
@@ -133,7 +147,7 @@ void SlicesOrderPopup::fillModel( ) {
         checkBoxCol->setCheckable( true );
 
         bool initialized = _manifestManager->initialized();
-        bool contains = _manifestManager->contains( GetFileBaseName ( fileName ) );
+        bool contains = _manifestManager->contains( fileName );
         bool isPng = fileName.endsWith(QString("png"), Qt::CaseInsensitive);
 
         // Save checke state
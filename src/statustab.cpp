@@ -4,6 +4,7 @@
 
 #include "statustab.h"
 
+#include "layerarchive.h"
 #include "ordermanifestmanager.h"
 #include "printjob.h"
 #include "printmanager.h"
@@ -453,7 +454,7 @@ void StatusTab::printManager_startingLayer(int const layer)
 
     _SetTextAndShow( _percentageCompleteDisplay, QString { "%1% complete" }.arg( static_cast<int>( static_cast<double>( _printManager->currentLayer( ) ) / static_cast<double>( printJob.totalLayerCount() ) * 100.0 + 0.5 ) ) );
 
-    QPixmap pixmap_orig = QPixmap(printJob.getLayerPath(layer));
+    QPixmap pixmap_orig = QPixmap::fromImage(LoadLayerImage(printJob.getLayerPath(layer)));
     QTransform rotate_transform;
     QPixmap pixmap;
 
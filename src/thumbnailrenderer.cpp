@@ -0,0 +1,259 @@
+#include "pch.h"
+
+#include "thumbnailrenderer.h"
+
+#include "glmesh.h"
+#include "loader.h"
+#include "mesh.h"
+#include "meshsimplifier.h"
+#include "modelfingerprint.h"
+#include "slicecache.h"
+
+namespace {
+
+    // Grid resolution the models are decimated to; plenty for a picture
+    // this small, and cheap to upload and draw.
+    unsigned const ThumbnailMeshResolution { 48 };
+
+    // Camera angles, in degrees: a three-quarter view from above.
+    float    const ThumbnailTilt           { 60.0f };
+    float    const ThumbnailYaw            { 30.0f };
+    float    const ThumbnailPerspective    { 0.25f };
+
+}
+
+ThumbnailRenderer::ThumbnailRenderer( QObject* parent ): QObject( parent ) {
+    /*empty*/
+}
+
+ThumbnailRenderer::~ThumbnailRenderer( ) {
+    if ( _thread ) {
+        QObject::disconnect( _thread, nullptr, this, nullptr );
+        _thread->requestInterruption( );
+        _thread->wait( );
+    }
+
+    if ( _context ) {
+        _context->makeCurrent( _surface );
+        delete _shader;
+        delete _framebuffer;
+        _context->doneCurrent( );
+        delete _context;
+    }
+    delete _surface;
+}
+
+QString ThumbnailRenderer::cacheFilePath( QString const& modelHash ) {
+    return JobWorkingDirectoryPath % Slash % modelHash % QString { ".thumbnail.png" };
+}
+
+QImage ThumbnailRenderer::thumbnail( QString const& fileName, QDateTime const& lastModified ) const {
+    if ( _requested.value( fileName ) != lastModified ) {
+        return { };
+    }
+    return _thumbnails.value( fileName );
+}
+
+void ThumbnailRenderer::request( QString const& fileName, QDateTime const& lastModified, ModelMetadata const& metadata ) {
+    if ( _requested.contains( fileName ) && ( _requested[fileName] == lastModified ) ) {
+        return;
+    }
+
+    // The file has changed (or is new), so forget any old picture of it
+    _requested[fileName] = lastModified;
+    _metadata[fileName]  = metadata;
+    _thumbnails.remove( fileName );
+    if ( !_queue.contains( fileName ) ) {
+        _queue.append( fileName );
+    }
+    _startNext( );
+}
+
+void ThumbnailRenderer::setPaused( bool const paused ) {
+    _paused = paused;
+    _startNext( );
+}
+
+void ThumbnailRenderer::_startNext( ) {
+    if ( _paused || _thread || _queue.isEmpty( ) ) {
+        return;
+    }
+
+    QString const fileName { _queue.takeFirst( ) };
+    _thread = QThread::create( std::bind( &ThumbnailRenderer::_prepare, this, fileName, _metadata.value( fileName ) ) );
+    QObject::connect( _thread, &QThread::finished, _thread, &QThread::deleteLater );
+    QObject::connect( _thread, &QThread::finished, this, [ this ] ( ) {
+        _thread = nullptr;
+        _prepared( );
+        _startNext( );
+    } );
+    _thread->start( QThread::LowPriority );
+}
+
+// Runs on the worker thread.
+void ThumbnailRenderer::_prepare( QString const fileName, ModelMetadata const metadata ) {
+    _preparedFileName = fileName;
+    _preparedModelHash.clear( );
+    _preparedImage    = QImage { };
+    _preparedMesh.reset( );
+    _preparedStopped  = false;
+
+    // Checked as the file is read, so that pausing doesn't have to wait for
+    // a large model to finish
+    auto const keepGoing = [ this ] ( qint64 const, qint64 const ) {
+        return !_paused && !QThread::currentThread( )->isInterruptionRequested( );
+    };
+
+    QString const modelHash { ModelFingerprint::fingerprint( fileName, keepGoing ) };
+    if ( modelHash.isEmpty( ) ) {
+        _preparedStopped = _paused;
+        return;
+    }
+    _preparedModelHash = modelHash;
+
+    QImage const image { cacheFilePath( modelHash ) };
+    if ( !image.isNull( ) ) {
+        SliceCache::touch( cacheFilePath( modelHash ) );
+        _preparedImage = image;
+        return;
+    }
+
+    // Each block of triangles goes straight into the decimator as it's
+    // read, so neither the full mesh nor a mesh cache file is ever made
+    debug( "+ ThumbnailRenderer::_prepare: decimating '%s'\n", fileName.toUtf8( ).data( ) );
+    float const lower[3] { static_cast<float>( metadata.x.min ), static_cast<float>( metadata.y.min ), static_cast<float>( metadata.z.min ) };
+    float const upper[3] { static_cast<float>( metadata.x.max ), static_cast<float>( metadata.y.max ), static_cast<float>( metadata.z.max ) };
+    MeshSimplifier simplifier { lower, upper, ThumbnailMeshResolution };
+
+    Loader loader { fileName };
+    bool const streamed = loader.stream_triangles( [ &simplifier ] ( GLfloat const* verts, size_t const count ) {
+        simplifier.add_triangle_soup( verts, count );
+    }, keepGoing );
+    if ( !streamed ) {
+        _preparedStopped = _paused;
+        return;
+    }
+
+    if ( simplifier.triangle_count( ) > 0 ) {
+        _preparedMesh.reset( simplifier.build( ) );
+    }
+}
+
+void ThumbnailRenderer::_prepared( ) {
+    QString const fileName { _preparedFileName };
+
+    // Paused part way through; start the model over when resumed
+    if ( _preparedStopped ) {
+        if ( !_queue.contains( fileName ) ) {
+            _queue.prepend( fileName );
+        }
+        return;
+    }
+
+    if ( !_preparedImage.isNull( ) ) {
+        _imageLoaded( fileName, _preparedImage );
+    } else if ( _preparedMesh ) {
+        _meshLoaded( fileName, _preparedModelHash, std::move( _preparedMesh ) );
+    }
+    _preparedImage = QImage { };
+}
+
+void ThumbnailRenderer::_imageLoaded( QString const& fileName, QImage const& image ) {
+    _thumbnails[fileName] = image;
+    emit thumbnailReady( fileName );
+}
+
+void ThumbnailRenderer::_meshLoaded( QString const& fileName, QString const& modelHash, std::unique_ptr<Mesh> mesh ) {
+    QImage image;
+    if ( !mesh->empty( ) && _initializeGl( ) ) {
+        image = _render( mesh.get( ) );
+    }
+    mesh.reset( );
+    if ( image.isNull( ) ) {
+        return;
+    }
+
+    QSaveFile file { cacheFilePath( modelHash ) };
+    if ( !file.open( QIODevice::WriteOnly ) || !image.save( &file, "PNG" ) || !file.commit( ) ) {
+        debug( "+ ThumbnailRenderer::_meshLoaded: couldn't write '%s': %s\n", file.fileName( ).toUtf8( ).data( ), file.errorString( ).toUtf8( ).data( ) );
+    } else {
+        SliceCache::update( file.fileName( ) );
+    }
+
+    _imageLoaded( fileName, image );
+}
+
+bool ThumbnailRenderer::_initializeGl( ) {
+    if ( _context ) {
+        return _context->isValid( );
+    }
+
+    _surface = new QOffscreenSurface;
+    _surface->setFormat( QSurfaceFormat::defaultFormat( ) );
+    _surface->create( );
+
+    _context = new QOpenGLContext;
+    _context->setFormat( QSurfaceFormat::defaultFormat( ) );
+    if ( !_context->create( ) || !_context->makeCurrent( _surface ) ) {
+        debug( "+ ThumbnailRenderer::_initializeGl: couldn't create an OpenGL context\n" );
+        return false;
+    }
+
+    QOpenGLFramebufferObjectFormat format;
+    format.setAttachment( QOpenGLFramebufferObject::CombinedDepthStencil );
+    format.setSamples( 4 );
+    _framebuffer = new QOpenGLFramebufferObject { ModelThumbnailSize, format };
+
+    _shader = new QOpenGLShaderProgram;
+    _shader->addShaderFromSourceFile( QOpenGLShader::Vertex,   ":/gl/mesh.vert" );
+    _shader->addShaderFromSourceFile( QOpenGLShader::Fragment, ":/gl/mesh.frag" );
+    _shader->link( );
+
+    _context->doneCurrent( );
+    return true;
+}
+
+QImage ThumbnailRenderer::_render( Mesh const* mesh ) {
+    _context->makeCurrent( _surface );
+    auto gl = _context->functions( );
+
+    _framebuffer->bind( );
+    gl->glViewport( 0, 0, ModelThumbnailSize.width( ), ModelThumbnailSize.height( ) );
+    gl->glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+    gl->glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+    gl->glEnable( GL_DEPTH_TEST );
+
+    // Frame the model the way Canvas does when it first shows a model.
+    QVector3D const lower { mesh->xmin( ), mesh->ymin( ), mesh->zmin( ) };
+    QVector3D const upper { mesh->xmax( ), mesh->ymax( ), mesh->zmax( ) };
+    float     const scale { 2.0f / std::max( ( upper - lower ).length( ), 1e-6f ) };
+
+    QMatrix4x4 transform;
+    transform.rotate( ThumbnailTilt, QVector3D { 1, 0, 0 } );
+    transform.rotate( ThumbnailYaw,  QVector3D { 0, 0, 1 } );
+    transform.scale( -scale, scale, -scale );
+    transform.translate( -( lower + upper ) / 2 );
+
+    QMatrix4x4 view;
+    view.scale( -1, 1, 0.5 );
+    view( 3, 2 ) = ThumbnailPerspective;
+
+    _shader->bind( );
+    _shader->setUniformValue( "transform_matrix", transform );
+    _shader->setUniformValue( "view_matrix",      view      );
+    _shader->setUniformValue( "zoom",             1.0f      );
+
+    GLuint const vp = _shader->attributeLocation( "vertex_position" );
+    gl->glEnableVertexAttribArray( vp );
+    {
+        GLMesh glMesh { mesh };
+        glMesh.draw( *_shader, vp );
+    }
+    gl->glDisableVertexAttribArray( vp );
+    _shader->release( );
+    _framebuffer->release( );
+
+    QImage image { _framebuffer->toImage( ) };
+    _context->doneCurrent( );
+    return image;
+}
@@ -0,0 +1,88 @@
+#ifndef __THUMBNAILRENDERER_H__
+#define __THUMBNAILRENDERER_H__
+
+#include <memory>
+
+#include "modelmetadataindex.h"
+
+class Mesh;
+
+//
+// Renders small pictures of models in the background for the model
+// library list. Models are streamed through a decimator on a worker thread,
+// one at a time, without ever building the full mesh, and the decimated
+// mesh is drawn on the GUI thread into an offscreen framebuffer with the
+// same shaders Canvas uses. Thumbnails are cached on disk by model hash,
+// next to the mesh cache.
+//
+
+class ThumbnailRenderer: public QObject {
+
+    Q_OBJECT
+
+public:
+
+    ThumbnailRenderer( QObject* parent = nullptr );
+    virtual ~ThumbnailRenderer( ) override;
+
+    static QString cacheFilePath( QString const& modelHash );
+
+    // Returns the model's thumbnail, or a null image if it hasn't been rendered yet.
+    QImage thumbnail( QString const& fileName, QDateTime const& lastModified ) const;
+
+    // Queues the model for rendering, unless it's already queued or
+    // rendered. The metadata's bounding box sizes the decimation grid.
+    void   request( QString const& fileName, QDateTime const& lastModified, ModelMetadata const& metadata );
+
+    // While paused, the model being worked on is put back at the head of
+    // the queue and no new ones are started; used to keep out of the way of
+    // models being loaded in the foreground.
+    void   setPaused( bool const paused );
+
+protected:
+
+private:
+
+    QHash<QString, QDateTime>     _requested;
+    QHash<QString, QImage>        _thumbnails;
+    QHash<QString, ModelMetadata> _metadata;
+    QStringList                   _queue;
+    QThread*                      _thread        { };
+    std::atomic_bool              _paused        { };
+
+    // Written by _prepare on the worker thread; read once it has finished.
+    QString                       _preparedFileName;
+    QString                       _preparedModelHash;
+    QImage                        _preparedImage;
+    std::unique_ptr<Mesh>         _preparedMesh;
+    bool                          _preparedStopped { };
+
+    QOffscreenSurface*            _surface       { };
+    QOpenGLContext*               _context       { };
+    QOpenGLFramebufferObject*     _framebuffer   { };
+    QOpenGLShaderProgram*         _shader        { };
+
+    void   _startNext( );
+    void   _prepare( QString const fileName, ModelMetadata const metadata );
+
+    // These run on the GUI thread, once _prepare has finished with a model.
+    void   _prepared( );
+    void   _imageLoaded( QString const& fileName, QImage const& image );
+    void   _meshLoaded( QString const& fileName, QString const& modelHash, std::unique_ptr<Mesh> mesh );
+
+    bool   _initializeGl( );
+    QImage _render( Mesh const* mesh );
+
+signals:
+
+    void thumbnailReady( QString const& fileName );
+
+public slots:
+
+protected slots:
+
+private slots:
+
+};
+
+#endif // __THUMBNAILRENDERER_H__
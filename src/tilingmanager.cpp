@@ -1,8 +1,10 @@
 #include <QtCore>
 #include "constants.h"
 #include "tilingmanager.h"
+#include "layerarchive.h"
 #include "utils.h"
 #include "printjob.h"
+#include "slicecache.h"
 
 TilingManager::TilingManager()
 {
@@ -47,10 +49,16 @@ OrderManifestManager* TilingManager::processImages(int width, int height, double
 
     _path = JobWorkingDirectoryPath % Slash % dirName;
 
-    QDir dir (JobWorkingDirectoryPath);
-    dir.mkdir(dirName);
+    SliceCache::prepare(_path);
 
+    /* the tiles go into one archive in the tiled directory */
+    LayerArchiveWriter archive { _path };
+    _archive = &archive;
     tileImages();
+    _archive = nullptr;
+    if (!archive.close())
+        debug( "+ TilingManager::processImages: couldn't write tiles to %s\n", _path.toUtf8().data());
+    SliceCache::update(_path);
 
     QFile::link(_path, StlModelLibraryPath % Slash % dirName);
 
@@ -80,9 +88,7 @@ void TilingManager::tileImages()
 {
     debug( "+ TilingManager::tileImages\n");
 
-    QPixmap pixmap;
-
-    pixmap.load(printJob.getLayerDirectory(0) % Slash % printJob.getLayerFileName(0));
+    QPixmap pixmap = QPixmap::fromImage(LoadLayerImage(printJob.getLayerDirectory(0) % Slash % printJob.getLayerFileName(0)));
 
     //For now only 1 row
     //_hCount =  floor( _height / (pixmap.height() + pixmap.height() * _space ) );
@@ -92,6 +98,7 @@ void TilingManager::tileImages()
                                          _width,    _height,    pixmap.width(),  pixmap.height(),  _space);
 
     _counter = 0;
+    _tilesBySource.clear();
 
     int deltax = ( ProjectorWindowSize.width() - ( _wCount*pixmap.width() ) - ( _wCount -1 ) * ( _space / ProjectorPixelSize ) ) / 2 - TilingMargin;
 
@@ -129,38 +136,49 @@ void TilingManager::tileImages()
 void TilingManager::renderTiles ( QFileInfo info, int sequence ) {
     int overalCount = _wCount * _hCount; // overal count of tiles
 
+    /* a layer that repeats an earlier one reuses its tiles */
+    QString source = "steps:" % LayerImageIdentity( info.filePath() );
+    QStringList earlierTiles = _tilesBySource.value( source );
+    QStringList tiles;
+
+    QPixmap sprite;
+    if ( earlierTiles.isEmpty() ) {
+        debug( "+ TilingManager::renderTiles path %s\n", info.filePath().toUtf8().data() );
+        sprite = QPixmap::fromImage(LoadLayerImage(info.filePath()));
+    }
+
     /* interating over each exposure time */
     for ( int e = 1; e <= overalCount; ++e)
     {
-        /* pixmap of single tile */
-        QPixmap pixmap ( _width, _height );
-        QPainter painter ( &pixmap );
-        painter.fillRect(0,0, _width, _height, QBrush("#000000"));
+        QString filename = QString( "%1/%2.png" ).arg( _path ).arg( _counter, 6, 10, DigitZero );
 
-        int innerCount=0;
-        /* iterating over rows and columns */
-        for( int r=0; (r<_wCount) && (innerCount<e); ++r )
-        {
-            for( int c=0; (c<_hCount) && (innerCount<e); ++c )
+        if ( !earlierTiles.isEmpty() ) {
+            _archive->writeAlias( GetFileBaseName( filename ), earlierTiles[e - 1] );
+        } else {
+            /* pixmap of single tile */
+            QPixmap pixmap ( _width, _height );
+            QPainter painter ( &pixmap );
+            painter.fillRect(0,0, _width, _height, QBrush("#000000"));
+
+            int innerCount=0;
+            /* iterating over rows and columns */
+            for( int r=0; (r<_wCount) && (innerCount<e); ++r )
             {
-                debug( "+ TilingManager::renderTiles overalCount %d, e %d, innerCount %d, r %d, c %d \n",
-                                                    overalCount,    e,    innerCount,    r,    c);
-                QPixmap sprite;
-
-                debug( "+ TilingManager::renderTiles path %s\n", info.filePath().toUtf8().data() );
-                sprite.load( info.filePath() );
-                putImageAt ( sprite, &painter, r, c );
-
-                ++innerCount;
+                for( int c=0; (c<_hCount) && (innerCount<e); ++c )
+                {
+                    debug( "+ TilingManager::renderTiles overalCount %d, e %d, innerCount %d, r %d, c %d \n",
+                                                        overalCount,    e,    innerCount,    r,    c);
+                    putImageAt ( sprite, &painter, r, c );
+
+                    ++innerCount;
+                }
             }
-        }
 
-        QString filename = QString( "%1/%2.png" ).arg( _path ).arg( _counter, 6, 10, DigitZero );
-        debug( "+ TilingManager::tileImages save %s\n", filename.toUtf8().data());
+            debug( "+ TilingManager::tileImages save %s\n", filename.toUtf8().data());
 
-        QFile file ( filename );
-        file.open(QIODevice::WriteOnly);
-        pixmap.save( &file, "PNG" );
+            _archive->write( GetFileBaseName( filename ), pixmap.toImage() );
+            tiles.push_back( GetFileBaseName( filename ) );
+        }
 
         if( sequence < printJob.getBaseLayerCount() ) {
             _expoTimeList.push_back(e == _wCount ? _baseExpoTime : _baseStep );
@@ -174,30 +192,38 @@ void TilingManager::renderTiles ( QFileInfo info, int sequence ) {
 
         _counter++;
     }
+
+    if ( !tiles.isEmpty() )
+        _tilesBySource.insert( source, tiles );
 }
 
 void TilingManager::renderTiles0Step(QFileInfo info, int sequence) {
 
-    /* pixmap of single tile */
-    QPixmap pixmap ( _width, _height );
-    QPainter painter ( &pixmap );
-    painter.fillRect(0,0, _width, _height, QBrush("#000000"));
+    QString filename = QString( "%1/%2.png" ).arg( _path ).arg( _counter, 6, 10, DigitZero );
 
-    QPixmap sprite;
-    sprite.load( info.filePath() );
+    /* a layer that repeats an earlier one reuses its tile */
+    QString source = "all:" % LayerImageIdentity( info.filePath() );
+    if ( _tilesBySource.contains( source ) ) {
+        _archive->writeAlias( GetFileBaseName( filename ), _tilesBySource.value( source ).first() );
+    } else {
+        /* pixmap of single tile */
+        QPixmap pixmap ( _width, _height );
+        QPainter painter ( &pixmap );
+        painter.fillRect(0,0, _width, _height, QBrush("#000000"));
 
-    /* iterating over tiles */
-    for( int r=0; r<_wCount; ++r )
-    {
-        putImageAt (sprite, &painter, r, -1);
-    }
+        QPixmap sprite = QPixmap::fromImage(LoadLayerImage(info.filePath()));
 
-    QString filename = QString( "%1/%2.png" ).arg( _path ).arg( _counter, 6, 10, DigitZero );
-    debug( "+ TilingManager::tileImages save %s\n", filename.toUtf8().data());
+        /* iterating over tiles */
+        for( int r=0; r<_wCount; ++r )
+        {
+            putImageAt (sprite, &painter, r, -1);
+        }
+
+        debug( "+ TilingManager::tileImages save %s\n", filename.toUtf8().data());
 
-    QFile file ( filename );
-    file.open(QIODevice::WriteOnly);
-    pixmap.save( &file, "PNG" );
+        _archive->write( GetFileBaseName( filename ), pixmap.toImage() );
+        _tilesBySource.insert( source, { GetFileBaseName( filename ) } );
+    }
 
     if( sequence < printJob.getBaseLayerCount() ) {
         _expoTimeList.push_back(_baseExpoTime);
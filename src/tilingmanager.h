@@ -3,6 +3,7 @@
 
 #include <QtCore>
 #include <QtWidgets>
+#include "layerarchive.h"
 #include "ordermanifestmanager.h"
 #include "printjob.h"
 
@@ -29,6 +30,7 @@ protected:
   void putImageAt (QPixmap pixmap, QPainter* painter, int i, int j);
 private:
         QString               _path;
+        LayerArchiveWriter*   _archive { };
         int                   _width;
         int                   _height;
         double                _baseExpoTime;
@@ -46,6 +48,8 @@ private:
         QList<double>         _expoTimeList;
         QList<int>            _layerThicknessList;
         std::vector<int>      _tileSlots;
+        /* tiles already made from each distinct layer image */
+        QHash<QString, QStringList> _tilesBySource;
 };
 
 
@@ -1,12 +1,14 @@
 #include <QtCore>
 #include <QtWidgets>
 #include "progressdialog.h"
+#include "layerarchive.h"
 #include "utils.h"
 #include "tilingtab.h"
 #include "tilingmanager.h"
 #include "printmanager.h"
 #include "window.h"
 #include "printprofilemanager.h"
+#include "slicecache.h"
 
 TilingExpoTimePopup::TilingExpoTimePopup(QWidget* parent): QDialog(parent)
 {
@@ -465,6 +467,7 @@ void TilingTab::confirmButton_clicked(bool)
     printJob.setBodyManager(QSharedPointer<OrderManifestManager>(orderMgr));
     printJob.setDirectoryMode(true);
     printJob.setDirectoryPath(tilingMgr->getPath());
+    SliceCache::protectPrintJob();
 
     emit uiStateChanged(TabIndex::Tiling, UiState::SelectCompleted);
 }
@@ -544,8 +547,8 @@ void TilingTab::setupTilingClicked(bool)
     this->_wRatio = (static_cast<double>(_areaWidth)) / ProjectorWindowSize.width();
     this->_hRatio = (static_cast<double>(_areaHeight)) / ProjectorWindowSize.height();
 
-    QPixmap pixmap(QString("%1/%2").arg(printJob.getLayerDirectory(0))
-        .arg(printJob.getLayerFileName(0)));
+    QPixmap pixmap(QPixmap::fromImage(LoadLayerImage(QString("%1/%2").arg(printJob.getLayerDirectory(0))
+        .arg(printJob.getLayerFileName(0)))));
 
     if (this->_pixmap)
         delete this->_pixmap;
@@ -2,78 +2,335 @@
 
 #include "upgradekitunpacker.h"
 
-#include "processrunner.h"
+#include "gpgsignaturechecker.h"
 
-UpgradeKitUnpacker::UpgradeKitUnpacker( QObject* parent ): QObject( parent ) {
+namespace {
+
+    // Large reads keep the disk streaming
+    qint64 const ReadBlockSize     { 1 << 20 };
+
+    int    const TarBlockSize      { 512 };
+
+    // Long names and pax headers are short; anything bigger is bogus
+    qint64 const MaximumHeaderData { 64 * 1024 };
+
+    // Fields of a ustar header block
+    int    const TarNameOffset     {   0 };
+    int    const TarNameLength     { 100 };
+    int    const TarSizeOffset     { 124 };
+    int    const TarSizeLength     {  12 };
+    int    const TarChecksumOffset { 148 };
+    int    const TarChecksumLength {   8 };
+    int    const TarTypeOffset     { 156 };
+    int    const TarMagicOffset    { 257 };
+    int    const TarPrefixOffset   { 345 };
+    int    const TarPrefixLength   { 155 };
+
+    QString fieldString( uchar const* field, int const length ) {
+        return QString::fromUtf8( reinterpret_cast<char const*>( field ), static_cast<int>( strnlen( reinterpret_cast<char const*>( field ), length ) ) );
+    }
+
+    // Octal, or GNU tar's base-256 for sizes that don't fit in octal
+    bool parseNumber( uchar const* field, int const length, qint64& value ) {
+        value = 0;
+
+        if ( field[0] & 0x80 ) {
+            value = field[0] & 0x7F;
+            for ( int n = 1; n < length; ++n ) {
+                if ( value > ( std::numeric_limits<qint64>::max( ) >> 8 ) ) {
+                    return false;
+                }
+                value = ( value << 8 ) | field[n];
+            }
+            return true;
+        }
+
+        int n = 0;
+        while ( ( n < length ) && ( field[n] == ' ' ) ) {
+            ++n;
+        }
+        bool anyDigits = false;
+        for ( ; ( n < length ) && ( field[n] >= '0' ) && ( field[n] <= '7' ); ++n ) {
+            value = ( value << 3 ) | ( field[n] - '0' );
+            anyDigits = true;
+        }
+        return anyDigits && ( ( n == length ) || ( field[n] == ' ' ) || ( field[n] == '\0' ) );
+    }
+
+    // Returns an empty string for names that would land outside the target
+    // directory.
+    QString safeMemberName( QString name ) {
+        while ( name.startsWith( "./" ) ) {
+            name.remove( 0, 2 );
+        }
+        if ( name.isEmpty( ) || name.startsWith( Slash ) || name.split( Slash ).contains( ".." ) ) {
+            return { };
+        }
+        return QDir::cleanPath( name );
+    }
+
+}
+
+UpgradeKitUnpacker::UpgradeKitUnpacker( QString const& kitFileName, QString const& signatureFileName, QString const& targetDirectory ):
+    _kitFileName       { kitFileName       },
+    _signatureFileName { signatureFileName },
+    _targetDirectory   { targetDirectory   }
+{
     /*empty*/
 }
 
 UpgradeKitUnpacker::~UpgradeKitUnpacker( ) {
-    if ( _processRunner ) {
-        _processRunner->deleteLater( );
-        _processRunner = nullptr;
-    }
+    /*empty*/
 }
 
-void UpgradeKitUnpacker::startUnpacking( QString const& fileName, QString const& targetDirectory ) {
-    _processRunner = new ProcessRunner( this );
+bool UpgradeKitUnpacker::unpack( ) {
+    debug( "+ UpgradeKitUnpacker::unpack: unpacking kit '%s' into directory '%s'\n", _kitFileName.toUtf8( ).data( ), _targetDirectory.toUtf8( ).data( ) );
 
-    QObject::connect( _processRunner, &ProcessRunner::succeeded,               this, &UpgradeKitUnpacker::tar_succeeded               );
-    QObject::connect( _processRunner, &ProcessRunner::failed,                  this, &UpgradeKitUnpacker::tar_failed                  );
-#if defined _DEBUG
-    QObject::connect( _processRunner, &ProcessRunner::readyReadStandardOutput, this, &UpgradeKitUnpacker::tar_readyReadStandardOutput );
-    QObject::connect( _processRunner, &ProcessRunner::readyReadStandardError,  this, &UpgradeKitUnpacker::tar_readyReadStandardError  );
-#endif // defined _DEBUG
+    QFile kitFile { _kitFileName };
+    if ( !kitFile.open( QIODevice::ReadOnly ) ) {
+        debug( "+ UpgradeKitUnpacker::unpack: couldn't open kit: %s\n", kitFile.errorString( ).toUtf8( ).data( ) );
+        return false;
+    }
+    if ( !QDir { }.mkpath( _targetDirectory ) ) {
+        debug( "+ UpgradeKitUnpacker::unpack: couldn't create directory\n" );
+        return false;
+    }
+
+    // gpg reads the kit from its standard input, as we read it
+    QProcess gpg;
+    gpg.start( "gpg", { "--status-fd", "1", "--verify", _signatureFileName, "-" } );
+    if ( !gpg.waitForStarted( -1 ) ) {
+        debug( "+ UpgradeKitUnpacker::unpack: couldn't start gpg: %s\n", ToString( gpg.error( ) ) );
+        return false;
+    }
 
-    _processRunner->start(
-        { "tar" },
-        {
-            "-C",  targetDirectory,
-            "-xf", fileName,
+    auto const giveUp = [ &gpg ] ( ) {
+        gpg.kill( );
+        gpg.waitForFinished( -1 );
+        return false;
+    };
+
+    QByteArray block { static_cast<int>( ReadBlockSize ), Qt::Uninitialized };
+    qint64 length;
+    while ( ( length = kitFile.read( block.data( ), ReadBlockSize ) ) > 0 ) {
+        gpg.write( block.constData( ), length );
+
+        if ( !_consume( block.constData( ), length ) ) {
+            return giveUp( );
         }
-    );
-}
 
-void UpgradeKitUnpacker::tar_succeeded( ) {
-    _processRunner->deleteLater( );
-    _processRunner = nullptr;
+        while ( gpg.bytesToWrite( ) > 0 ) {
+            if ( !gpg.waitForBytesWritten( -1 ) ) {
+                debug( "+ UpgradeKitUnpacker::unpack: gpg stopped reading the kit: %s\n", ToString( gpg.error( ) ) );
+                return giveUp( );
+            }
+        }
+    }
+    if ( length < 0 ) {
+        debug( "+ UpgradeKitUnpacker::unpack: couldn't read kit: %s\n", kitFile.errorString( ).toUtf8( ).data( ) );
+        return giveUp( );
+    }
+    if ( !_endOfArchive ) {
+        debug( "+ UpgradeKitUnpacker::unpack: kit is truncated\n" );
+        return giveUp( );
+    }
 
-    debug( "+ UpgradeKitUnpacker::tar_succeeded\n" );
+    gpg.closeWriteChannel( );
+    if ( !gpg.waitForFinished( -1 ) || ( gpg.exitStatus( ) != QProcess::NormalExit ) || ( gpg.exitCode( ) != 0 ) ) {
+        debug( "+ UpgradeKitUnpacker::unpack: gpg failed: exit code %d, error %s\n", gpg.exitCode( ), ToString( gpg.error( ) ) );
+        debug( "  + stderr:\n%s", gpg.readAllStandardError( ).data( ) );
+        return false;
+    }
 
-#if defined _DEBUG
-    emit unpackComplete( true, _tarOutput, _tarError );
-#else
-    emit unpackComplete( true );
-#endif // defined _DEBUG
+    debug( "+ UpgradeKitUnpacker::unpack: unpacked %d files; examining GPG output\n", _checksums.count( ) );
+    return GpgSignatureChecker::checkStatusOutput( QString::fromUtf8( gpg.readAllStandardOutput( ) ) );
 }
 
-void UpgradeKitUnpacker::tar_failed( int const exitCode, QProcess::ProcessError const error ) {
-    _processRunner->deleteLater( );
-    _processRunner = nullptr;
+bool UpgradeKitUnpacker::_consume( char const* data, qint64 length ) {
+    while ( length > 0 ) {
+        // Whatever follows the end of the archive is ignored, as tar does
+        if ( _endOfArchive ) {
+            return true;
+        }
 
-    debug( "+ UpgradeKitUnpacker::tar_failed: unpacking upgrade kit: exit code: %d, error %s [%d]\n", exitCode, ToString( error ), error );
+        if ( _memberRemaining > 0 ) {
+            qint64 const count = std::min( _memberRemaining, length );
+            if ( _memberType == MemberType::File ) {
+                _memberHash.addData( data, static_cast<int>( count ) );
+                if ( _memberFile.write( data, count ) != count ) {
+                    debug( "+ UpgradeKitUnpacker::_consume: couldn't write '%s': %s\n", _memberName.toUtf8( ).data( ), _memberFile.errorString( ).toUtf8( ).data( ) );
+                    return false;
+                }
+            } else if ( ( _memberType == MemberType::LongName ) || ( _memberType == MemberType::PaxHeader ) ) {
+                _memberData.append( data, static_cast<int>( count ) );
+            }
 
-#if defined _DEBUG
-    emit unpackComplete( false, _tarOutput, _tarError );
-#else
-    emit unpackComplete( false );
-#endif // defined _DEBUG
-}
+            data             += count;
+            length           -= count;
+            _memberRemaining -= count;
+            if ( !_memberRemaining && !_finishMember( ) ) {
+                return false;
+            }
+            continue;
+        }
 
-#if defined _DEBUG
-void UpgradeKitUnpacker::tar_readyReadStandardOutput( QString const& data ) {
-    _tarOutput.append( data );
-}
+        if ( _paddingRemaining > 0 ) {
+            qint64 const count = std::min( _paddingRemaining, length );
+            data              += count;
+            length            -= count;
+            _paddingRemaining -= count;
+            continue;
+        }
 
-void UpgradeKitUnpacker::tar_readyReadStandardError( QString const& data ) {
-    _tarError.append( data );
+        int const count = static_cast<int>( std::min<qint64>( TarBlockSize - _header.size( ), length ) );
+        _header.append( data, count );
+        data   += count;
+        length -= count;
+        if ( _header.size( ) == TarBlockSize ) {
+            bool const started = _startMember( );
+            _header.clear( );
+            if ( !started ) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
-#endif // defined _DEBUG
 
-int UpgradeKitUnpacker::instanceId( ) const {
-    return _processRunner ? _processRunner->instanceId( ) : -1;
+bool UpgradeKitUnpacker::_startMember( ) {
+    auto const header = reinterpret_cast<uchar const*>( _header.constData( ) );
+
+    if ( std::all_of( header, header + TarBlockSize, [] ( uchar const c ) { return !c; } ) ) {
+        _endOfArchive = true;
+        return true;
+    }
+
+    qint64 expectedChecksum;
+    if ( !parseNumber( header + TarChecksumOffset, TarChecksumLength, expectedChecksum ) ) {
+        debug( "+ UpgradeKitUnpacker::_startMember: bad header checksum field\n" );
+        return false;
+    }
+    qint64 checksum = 0;
+    for ( int n = 0; n < TarBlockSize; ++n ) {
+        checksum += ( ( n >= TarChecksumOffset ) && ( n < TarChecksumOffset + TarChecksumLength ) ) ? ' ' : header[n];
+    }
+    if ( checksum != expectedChecksum ) {
+        debug( "+ UpgradeKitUnpacker::_startMember: header checksum mismatch\n" );
+        return false;
+    }
+
+    qint64 size;
+    if ( !parseNumber( header + TarSizeOffset, TarSizeLength, size ) ) {
+        debug( "+ UpgradeKitUnpacker::_startMember: bad member size field\n" );
+        return false;
+    }
+    _memberRemaining  = size;
+    _paddingRemaining = ( TarBlockSize - size % TarBlockSize ) % TarBlockSize;
+
+    char const type = static_cast<char>( header[TarTypeOffset] );
+    if ( ( type == 'L' ) || ( type == 'x' ) ) {
+        if ( size > MaximumHeaderData ) {
+            debug( "+ UpgradeKitUnpacker::_startMember: extended header is too big: %lld bytes\n", static_cast<long long>( size ) );
+            return false;
+        }
+        _memberType = ( type == 'L' ) ? MemberType::LongName : MemberType::PaxHeader;
+        _memberData.clear( );
+    } else if ( type == 'g' ) {
+        _memberType = MemberType::Skip;
+    } else {
+        // A long name or pax path applies to the member that follows it
+        QString name;
+        if ( !_longName.isEmpty( ) ) {
+            name = _longName;
+            _longName.clear( );
+        } else {
+            name = fieldString( header + TarNameOffset, TarNameLength );
+            if ( !memcmp( header + TarMagicOffset, "ustar", 5 ) ) {
+                QString const prefix { fieldString( header + TarPrefixOffset, TarPrefixLength ) };
+                if ( !prefix.isEmpty( ) ) {
+                    name = prefix % Slash % name;
+                }
+            }
+        }
+
+        _memberName = safeMemberName( name );
+        if ( _memberName.isEmpty( ) ) {
+            debug( "+ UpgradeKitUnpacker::_startMember: refusing member '%s'\n", name.toUtf8( ).data( ) );
+            return false;
+        }
+
+        QString const path { _targetDirectory % Slash % _memberName };
+        if ( ( type == '0' ) || ( type == '\0' ) || ( type == '7' ) ) {
+            if ( !QDir { }.mkpath( QFileInfo { path }.path( ) ) ) {
+                debug( "+ UpgradeKitUnpacker::_startMember: couldn't create directory for '%s'\n", _memberName.toUtf8( ).data( ) );
+                return false;
+            }
+            _memberFile.setFileName( path );
+            if ( !_memberFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+                debug( "+ UpgradeKitUnpacker::_startMember: couldn't create '%s': %s\n", _memberName.toUtf8( ).data( ), _memberFile.errorString( ).toUtf8( ).data( ) );
+                return false;
+            }
+            _memberHash.reset( );
+            _memberType = MemberType::File;
+        } else if ( type == '5' ) {
+            if ( !QDir { }.mkpath( path ) ) {
+                debug( "+ UpgradeKitUnpacker::_startMember: couldn't create directory '%s'\n", _memberName.toUtf8( ).data( ) );
+                return false;
+            }
+            _memberType = MemberType::Skip;
+        } else {
+            debug( "+ UpgradeKitUnpacker::_startMember: member '%s' has unsupported type '%c'\n", _memberName.toUtf8( ).data( ), type );
+            return false;
+        }
+    }
+
+    return _memberRemaining ? true : _finishMember( );
 }
 
-QProcess::ProcessState UpgradeKitUnpacker::state( ) const {
-    return _processRunner ? _processRunner->state( ) : QProcess::ProcessState::NotRunning;
+bool UpgradeKitUnpacker::_finishMember( ) {
+    switch ( _memberType ) {
+        case MemberType::File: {
+            _memberFile.close( );
+            if ( _memberFile.error( ) != QFileDevice::NoError ) {
+                debug( "+ UpgradeKitUnpacker::_finishMember: couldn't write '%s': %s\n", _memberName.toUtf8( ).data( ), _memberFile.errorString( ).toUtf8( ).data( ) );
+                return false;
+            }
+
+            QString const checksum { _memberHash.result( ).toHex( ) };
+            _checksums.insert( _memberName, checksum );
+            debug( "+ UpgradeKitUnpacker::_finishMember: '%s': checksum %s\n", _memberName.toUtf8( ).data( ), checksum.toUtf8( ).data( ) );
+            break;
+        }
+
+        case MemberType::LongName:
+            _longName = QString::fromUtf8( _memberData.left( _memberData.indexOf( '\0' ) ) );
+            break;
+
+        case MemberType::PaxHeader: {
+            // Records are "<length> <key>=<value>\n"; only the path matters
+            int position = 0;
+            while ( position < _memberData.size( ) ) {
+                int const space = _memberData.indexOf( ' ', position );
+                bool ok = false;
+                int const recordLength = ( space > position ) ? _memberData.mid( position, space - position ).toInt( &ok ) : 0;
+                if ( !ok || ( recordLength <= space - position ) || ( position + recordLength > _memberData.size( ) ) ) {
+                    debug( "+ UpgradeKitUnpacker::_finishMember: bad pax header\n" );
+                    return false;
+                }
+
+                QByteArray const record { _memberData.mid( space + 1, position + recordLength - space - 2 ) };
+                if ( record.startsWith( "path=" ) ) {
+                    _longName = QString::fromUtf8( record.mid( 5 ) );
+                }
+                position += recordLength;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    _memberType = MemberType::None;
+    return true;
 }
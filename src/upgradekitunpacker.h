@@ -3,53 +3,68 @@
 
 #include <QtCore>
 
-class ProcessRunner;
-
-class UpgradeKitUnpacker: public QObject {
-
-    Q_OBJECT
+//
+// Unpacks an upgrade kit (a plain tar file) into a directory, reading the kit
+// exactly once: each block read is fed to gpg to check the kit's detached
+// signature, and to an in-process tar reader which writes out the members
+// and SHA-256s them as they go by. Kits usually come off slow USB sticks, so
+// this saves reading the kit again for tar, and reading every unpacked file
+// again to check its checksum.
+//
+// Only regular files and directories are unpacked; members with absolute
+// paths, '..' components, or any other type fail the kit.
+//
+// Runs on the calling thread, which needn't have an event loop.
+//
+
+class UpgradeKitUnpacker {
 
 public:
 
-    UpgradeKitUnpacker( QObject* parent = nullptr );
-    virtual ~UpgradeKitUnpacker( ) override;
+    UpgradeKitUnpacker( QString const& kitFileName, QString const& signatureFileName, QString const& targetDirectory );
+    ~UpgradeKitUnpacker( );
 
-    void startUnpacking( QString const& fileName, QString const& targetDirectory );
+    // True if the kit was unpacked whole and its signature is good. When
+    // false, whatever was unpacked is left for the caller to remove.
+    bool unpack( );
 
-    int instanceId( ) const;
-    QProcess::ProcessState state( ) const;
+    // SHA-256 of each regular file unpacked, in hex, by its path in the kit.
+    QMap<QString, QString> const& checksums( ) const { return _checksums; }
 
 protected:
 
 private:
 
-    ProcessRunner* _processRunner { };
-#if defined _DEBUG
-    QString        _tarOutput;
-    QString        _tarError;
-#endif // defined _DEBUG
-
-signals:
+    enum class MemberType {
+        None,
+        File,
+        LongName,
+        PaxHeader,
+        Skip,
+    };
 
-#if defined _DEBUG
-    void unpackComplete( bool const result, QString const& output, QString const& error );
-#else
-    void unpackComplete( bool const result );
-#endif // defined _DEBUG
+    QString                _kitFileName;
+    QString                _signatureFileName;
+    QString                _targetDirectory;
 
-public slots:
+    QMap<QString, QString> _checksums;
 
-protected slots:
+    QByteArray             _header;
+    bool                   _endOfArchive     { };
+    QString                _longName;
 
-private slots:
+    MemberType             _memberType       { MemberType::None };
+    QString                _memberName;
+    qint64                 _memberRemaining  { };
+    qint64                 _paddingRemaining { };
+    QFile                  _memberFile;
+    QCryptographicHash     _memberHash       { QCryptographicHash::Sha256 };
+    QByteArray             _memberData;
 
-    void tar_succeeded( );
-    void tar_failed( int const exitCode, QProcess::ProcessError const error );
-#if defined _DEBUG
-    void tar_readyReadStandardOutput( QString const& data );
-    void tar_readyReadStandardError( QString const& data );
-#endif // defined _DEBUG
+    bool _consume( char const* data, qint64 length );
+    bool _startMember( );
+    bool _finishMember( );
 
 };
 
-#endif // __UPGRADEKITUNPACKER__
+#endif // __UPGRADEKITUNPACKER_H__
@@ -132,7 +132,6 @@ void UpgradeManager::_clearJournals( ) {
 void UpgradeManager::_checkForUpgrades( QString const& upgradesPath ) {
     debug( "+ UpgradeManager::_checkForUpgrades: looking for unpacked upgrade kits in '%s'\n", UpdatesRootPath.toUtf8( ).data( ) );
     _unprocessedUpgradeKits.clear( );
-    _processedUpgradeKits  .clear( );
     _goodUpgradeKits       .clear( );
 
     for ( auto kitDirInfo : QDir { UpdatesRootPath }.entryInfoList( UpgradeKitDirGlobs, QDir::Dirs | QDir::Readable | QDir::Executable, QDir::Name ) ) {
@@ -212,7 +211,24 @@ void UpgradeManager::_checkForUpgrades( QString const& upgradesPath ) {
                 match.captured( 4 ).toUtf8( ).data( )
             );
 
-            _unprocessedUpgradeKits.append( UpgradeKitInfo { kitFile, sigFile } );
+            UpgradeKitInfo kit { kitFile, sigFile };
+
+            QString dirName { UpdatesRootPath % Slash % kitFile.fileName( ) };
+            if ( dirName.endsWith( ".kit" ) ) {
+                dirName = dirName.left( dirName.length( ) - 4 );
+            }
+            kit.directory = QDir { dirName };
+
+            // The kit will be unpacked over any copy unpacked earlier
+            auto const pred = [ &dirName ] ( UpgradeKitInfo const& kitInfo ) {
+                return kitInfo.isAlreadyUnpacked && ( kitInfo.directory.absolutePath( ) == dirName );
+            };
+            if ( auto iter = std::find_if( _unprocessedUpgradeKits.begin( ), _unprocessedUpgradeKits.end( ), pred ); iter != _unprocessedUpgradeKits.end( ) ) {
+                debug( "  + forgetting about upgrade kit already unpacked into same directory\n" );
+                _unprocessedUpgradeKits.erase( iter );
+            }
+
+            _unprocessedUpgradeKits.append( kit );
         }
     }
 
@@ -223,195 +239,117 @@ void UpgradeManager::_checkForUpgrades( QString const& upgradesPath ) {
     }
 
     debug( "+ UpgradeManager::_checkForUpgrades: found %d upgrade kits\n", _unprocessedUpgradeKits.count( ) );
-    _checkNextKitSignature( );
+    _verifyKits( );
 }
 
-void UpgradeManager::_checkNextKitSignature( ) {
-    debug( "+ UpgradeManager::_checkNextKitSignature\n" );
-
-top:
-    if ( _unprocessedUpgradeKits.isEmpty( ) ) {
-        debug( "  + finished checking kit signatures\n" );
+void UpgradeManager::_verifyKits( ) {
+    debug( "+ UpgradeManager::_verifyKits: verifying %d kits\n", _unprocessedUpgradeKits.count( ) );
 
-        _unprocessedUpgradeKits = std::move( _processedUpgradeKits );
-        if ( _unprocessedUpgradeKits.isEmpty( ) ) {
-            debug( "  + unprocessed upgrade kits list is empty; emitting upgradeCheckComplete(false).\n" );
-            emit upgradeCheckComplete( false );
-        } else {
-            debug( "  + starting unpacking %d kits\n", _unprocessedUpgradeKits.count( ) );
-            _unpackNextKit( );
-        }
-        return;
+    // Each kit gets a thread of its own, so one kit's files are read while
+    // another's are hashed or checked by gpg
+    _kitResults.fill( false, _unprocessedUpgradeKits.count( ) );
+    _kitsBeingVerified = _unprocessedUpgradeKits.count( );
+    for ( int index = 0; index < _unprocessedUpgradeKits.count( ); ++index ) {
+        auto thread = QThread::create( std::bind( &UpgradeManager::_verifyKit, this, index, _unprocessedUpgradeKits[index] ) );
+        QObject::connect( thread, &QThread::finished, thread, &QThread::deleteLater );
+        thread->start( );
     }
-
-    auto& currentUpgradeKit = _unprocessedUpgradeKits.front( );
-
-    if ( currentUpgradeKit.isAlreadyUnpacked ) {
-        debug( "  + skipping unpacked upgrade kit '%s'\n", currentUpgradeKit.directory.absolutePath( ).toUtf8( ).data( ) );
-        _processedUpgradeKits.append( currentUpgradeKit );
-        _unprocessedUpgradeKits.removeFirst( );
-        goto top;
-    }
-
-    auto kitFilePath = currentUpgradeKit.kitFileInfo.absoluteFilePath( );
-    auto sigFilePath = currentUpgradeKit.sigFileInfo.absoluteFilePath( );
-    debug(
-        "  + checking signature for upgrade kit\n"
-        "    + upgrade kit file name: '%s'\n"
-        "    + signature file name:   '%s'\n"
-        "",
-        kitFilePath.toUtf8( ).data( ),
-        sigFilePath.toUtf8( ).data( )
-    );
-
-    _gpgSignatureChecker = new GpgSignatureChecker( this );
-    QObject::connect( _gpgSignatureChecker, &GpgSignatureChecker::signatureCheckComplete, this, &UpgradeManager::gpgSignatureChecker_kit_complete );
-    _gpgSignatureChecker->startCheckDetachedSignature( kitFilePath, sigFilePath );
 }
 
-void UpgradeManager::gpgSignatureChecker_kit_complete( bool const result ) {
-    _gpgSignatureChecker->deleteLater( );
-    _gpgSignatureChecker = nullptr;
-
-    debug( "+ UpgradeManager::gpgSignatureChecker_kit_complete: signature is %s\n", result ? "good" : "bad" );
-    if ( result ) {
-        _processedUpgradeKits.append( _unprocessedUpgradeKits.front( ) );
-    }
+// Runs on a worker thread.
+void UpgradeManager::_verifyKit( int const index, UpgradeKitInfo kit ) {
+    bool const result = _checkKit( kit );
 
-    _unprocessedUpgradeKits.removeFirst( );
-    _checkNextKitSignature( );
+    QMetaObject::invokeMethod( this, [ this, index, kit, result ] ( ) {
+        _kitVerified( index, kit, result );
+    }, Qt::QueuedConnection );
 }
 
-void UpgradeManager::_unpackNextKit( ) {
-    debug( "+ UpgradeManager::_unpackNextKit\n" );
-
-top:
-    if ( _unprocessedUpgradeKits.isEmpty( ) ) {
-        debug( "  + finished unpacking kits\n" );
-
-        _unprocessedUpgradeKits = std::move( _processedUpgradeKits );
-        if ( _unprocessedUpgradeKits.isEmpty( ) ) {
-            debug( "  + unprocessed upgrade kits list is empty; emitting upgradeCheckComplete(false).\n" );
-            emit upgradeCheckComplete( false );
-        } else {
-            debug( "  + starting checking version.inf signatures for %d kits\n", _unprocessedUpgradeKits.count( ) );
-            _checkNextVersionInfSignature( );
+// Runs on a worker thread. Checks, in order, the kit's signature, the
+// signature of its version.inf, its metadata, and the checksums of its files,
+// giving up at the first failure.
+bool UpgradeManager::_checkKit( UpgradeKitInfo& kit ) {
+    bool const unpacking = !kit.isAlreadyUnpacked;
+    QMap<QString, QString> unpackedChecksums;
+
+    if ( unpacking ) {
+        QString const kitFilePath { kit.kitFileInfo.absoluteFilePath( ) };
+        QString const dirName     { kit.directory.absolutePath( ) };
+
+        // Unpack beside the kit's directory, so that a bad kit doesn't
+        // clobber a good copy unpacked earlier
+        QString const unpackDirName { UpdatesRootPath % Slash % ".unpacking-" % kit.directory.dirName( ) };
+        QDir { unpackDirName }.removeRecursively( );
+
+        UpgradeKitUnpacker unpacker { kitFilePath, kit.sigFileInfo.absoluteFilePath( ), unpackDirName };
+        if ( !unpacker.unpack( ) ) {
+            debug( "+ UpgradeManager::_checkKit: kit '%s' is bad or couldn't be unpacked\n", kitFilePath.toUtf8( ).data( ) );
+            QDir { unpackDirName }.removeRecursively( );
+            return false;
         }
-        return;
-    }
 
-    auto& currentUpgradeKit = _unprocessedUpgradeKits.front( );
+        if ( kit.directory.exists( ) ) {
+            debug( "+ UpgradeManager::_checkKit: directory '%s' already exists, deleting\n", dirName.toUtf8( ).data( ) );
+            kit.directory.removeRecursively( );
+        }
+        if ( !QDir { }.rename( unpackDirName, dirName ) ) {
+            debug( "+ UpgradeManager::_checkKit: couldn't rename '%s' to '%s'\n", unpackDirName.toUtf8( ).data( ), dirName.toUtf8( ).data( ) );
+            QDir { unpackDirName }.removeRecursively( );
+            return false;
+        }
 
-    if ( currentUpgradeKit.isAlreadyUnpacked ) {
-        debug( "  + skipping unpacked upgrade kit '%s'\n", currentUpgradeKit.directory.absolutePath( ).toUtf8( ).data( ) );
-        _processedUpgradeKits.append( currentUpgradeKit );
-        _unprocessedUpgradeKits.removeFirst( );
-        goto top;
+        kit.directory         = QDir { dirName };
+        kit.isAlreadyUnpacked = true;
+        unpackedChecksums     = unpacker.checksums( );
     }
 
-    QString kitFilePath { currentUpgradeKit.kitFileInfo.absoluteFilePath( ) };
-    debug( "  + kit file name: '%s'\n", kitFilePath.toUtf8( ).data( ) );
-
-    QString dirName { UpdatesRootPath + Slash + currentUpgradeKit.kitFileInfo.fileName( ) };
-    if ( dirName.endsWith( ".kit" ) ) {
-        dirName = dirName.left( dirName.length( ) - 4 );
+    auto const versionInfFilePath = kit.directory.absoluteFilePath( "version.inf" );
+    if ( !GpgSignatureChecker::checkDetachedSignature( versionInfFilePath, versionInfFilePath % ".sig" ) ) {
+        debug( "+ UpgradeManager::_checkKit: deleting bad unpacked kit '%s': version.inf signature is bad\n", kit.directory.absolutePath( ).toUtf8( ).data( ) );
+        kit.directory.removeRecursively( );
+        return false;
     }
 
-    debug( "  + Unpacking kit '%s' into directory '%s'\n", kitFilePath.toUtf8( ).data( ), dirName.toUtf8( ).data( ) );
-    currentUpgradeKit.directory = QDir { dirName };
-    if ( currentUpgradeKit.directory.exists( ) ) {
-        debug( "  + Directory already exists, deleting\n" );
-        currentUpgradeKit.directory.removeRecursively( );
-
-        auto const pred = [ &dirName ] ( UpgradeKitInfo const& kitInfo ) {
-            return kitInfo.isAlreadyUnpacked && ( kitInfo.directory.absolutePath( ) == dirName );
-        };
-
-        if ( auto iter = std::find_if( _unprocessedUpgradeKits.begin( ), _unprocessedUpgradeKits.end( ), pred ); iter != _unprocessedUpgradeKits.end( ) ) {
-            debug( "  + Forgetting about unprocessed upgrade kit already unpacked into same directory\n" );
-            _unprocessedUpgradeKits.erase( iter );
-        }
-        if ( auto iter = std::find_if( _processedUpgradeKits.begin( ), _processedUpgradeKits.end( ), pred ); iter != _processedUpgradeKits.end( ) ) {
-            debug( "  + Forgetting about processed upgrade kit already unpacked into same directory\n" );
-            _processedUpgradeKits.erase( iter );
-        }
+    if ( !_parseVersionInfo( versionInfFilePath, kit ) ) {
+        debug( "+ UpgradeManager::_checkKit: bad unpacked kit '%s': bad metadata\n", kit.directory.absolutePath( ).toUtf8( ).data( ) );
+        return false;
     }
 
-    currentUpgradeKit.directory.mkdir( dirName );
-
-    _upgradeKitUnpacker = new UpgradeKitUnpacker( this );
-    QObject::connect( _upgradeKitUnpacker, &UpgradeKitUnpacker::unpackComplete, this, &UpgradeManager::upgradeKitUnpacker_complete );
-    _upgradeKitUnpacker->startUnpacking( kitFilePath, dirName );
-}
-
-#if defined _DEBUG
-void UpgradeManager::upgradeKitUnpacker_complete( bool const result, QString const& tarOutput, QString const& tarError ) {
-#else
-void UpgradeManager::upgradeKitUnpacker_complete( bool const result ) {
-#endif // defined _DEBUG
-    _upgradeKitUnpacker->deleteLater( );
-    _upgradeKitUnpacker = nullptr;
-
-    debug( "+ UpgradeManager::upgradeKitUnpacker_complete: result is %s\n", ToString( result ) );
-
-    if ( result ) {
-        _unprocessedUpgradeKits[0].isAlreadyUnpacked = true;
-        _processedUpgradeKits.append( _unprocessedUpgradeKits.front( ) );
-#if defined _DEBUG
-    } else {
-        if ( !tarOutput.isEmpty( ) ) {
-            debug( "+ UpgradeManager::upgradeKitUnpacker_complete: tar's stdout:\n%s", tarOutput.toUtf8( ).data( ) );
-        }
-        if ( !tarError.isEmpty( ) ) {
-            debug( "+ UpgradeManager::upgradeKitUnpacker_complete: tar's stderr:\n%s", tarError.toUtf8( ).data( ) );
+    // Files just unpacked were hashed on their way out of the kit; files
+    // unpacked by an earlier check have to be read again
+    auto const path = kit.directory.absolutePath( ) + Slash;
+    for ( auto iter = kit.checksums.constBegin( ); iter != kit.checksums.constEnd( ); ++iter ) {
+        QString const checksum { unpacking ? unpackedChecksums.value( iter.key( ).mid( path.length( ) ) ) : Hasher::hashFile( iter.key( ), QCryptographicHash::Sha256 ) };
+        if ( checksum != iter.value( ) ) {
+            debug( "+ UpgradeManager::_checkKit: bad unpacked kit '%s': checksum mismatch for file '%s': %s vs %s\n", kit.directory.absolutePath( ).toUtf8( ).data( ), iter.key( ).toUtf8( ).data( ), iter.value( ).toUtf8( ).data( ), checksum.toUtf8( ).data( ) );
+            return false;
         }
-#endif // defined _DEBUG
     }
 
-    _unprocessedUpgradeKits.removeFirst( );
-    _unpackNextKit( );
+    debug( "+ UpgradeManager::_checkKit: kit '%s' is good\n", kit.directory.absolutePath( ).toUtf8( ).data( ) );
+    return true;
 }
 
-void UpgradeManager::_checkNextVersionInfSignature( ) {
-    debug( "+ UpgradeManager::_checkNextVersionInfSignature\n" );
+void UpgradeManager::_kitVerified( int const index, UpgradeKitInfo const& kit, bool const result ) {
+    debug( "+ UpgradeManager::_kitVerified: kit #%d: result is %s\n", index, ToString( result ) );
 
-    if ( _unprocessedUpgradeKits.isEmpty( ) ) {
-        debug( "  + finished checking version.inf signatures, moving on to examining %d kits\n", _processedUpgradeKits.count( ) );
-
-        _unprocessedUpgradeKits = std::move( _processedUpgradeKits );
-        if ( _unprocessedUpgradeKits.isEmpty( ) ) {
-            emit upgradeCheckComplete( false );
-        } else {
-            _examineUnpackedKits( );
-        }
+    _unprocessedUpgradeKits[index] = kit;
+    _kitResults[index]             = result;
+    if ( --_kitsBeingVerified > 0 ) {
         return;
     }
 
-    auto versionInfFilePath = _unprocessedUpgradeKits[0].directory.absoluteFilePath( "version.inf" );
-    debug( "  + checking signature for version.inf file '%s'\n", versionInfFilePath.toUtf8( ).data( ) );
-
-    _gpgSignatureChecker = new GpgSignatureChecker( this );
-    QObject::connect( _gpgSignatureChecker, &GpgSignatureChecker::signatureCheckComplete, this, &UpgradeManager::gpgSignatureChecker_versionInf_complete );
-    _gpgSignatureChecker->startCheckDetachedSignature( versionInfFilePath, versionInfFilePath + QString { ".sig" } );
-}
-
-void UpgradeManager::gpgSignatureChecker_versionInf_complete( bool const result ) {
-    _gpgSignatureChecker->deleteLater( );
-    _gpgSignatureChecker = nullptr;
-
-    {
-        auto& kit = _unprocessedUpgradeKits.front( );
-        if ( result ) {
-            debug( "+ UpgradeManager::gpgSignatureChecker_versionInf_complete: signature is good\n" );
-            _processedUpgradeKits.append( kit );
-        } else {
-            debug( "+ UpgradeManager::gpgSignatureChecker_versionInf_complete: deleting bad unpacked kit: signature is bad\n" );
-            kit.directory.removeRecursively( );
+    // Keep the kits in the order they were found
+    for ( int n = 0; n < _unprocessedUpgradeKits.count( ); ++n ) {
+        if ( _kitResults[n] ) {
+            _goodUpgradeKits.append( _unprocessedUpgradeKits[n] );
         }
     }
+    _unprocessedUpgradeKits.clear( );
+    _kitResults.clear( );
 
-    _unprocessedUpgradeKits.removeFirst( );
-    _checkNextVersionInfSignature( );
+    debug( "+ UpgradeManager::_kitVerified: finished verifying kits, %d good kits\n", _goodUpgradeKits.count( ) );
+    emit upgradeCheckComplete( _goodUpgradeKits.count( ) > 0 );
 }
 
 bool UpgradeManager::_parseVersionInfo( QString const& versionInfoFileName, UpgradeKitInfo& update ) {
@@ -561,52 +499,6 @@ bool UpgradeManager::_parseVersionInfo( QString const& versionInfoFileName, Upgr
     return true;
 }
 
-void UpgradeManager::_examineUnpackedKits( ) {
-    debug( "+ UpgradeManager::_examineUnpackedKits: %d kits to examine\n", _unprocessedUpgradeKits.count( ) );
-
-    for ( auto& update : _unprocessedUpgradeKits ) {
-        if ( _parseVersionInfo( update.directory.absoluteFilePath( "version.inf" ), update ) ) {
-            _processedUpgradeKits.append( update );
-        } else {
-            debug( "+ UpgradeManager::_examineUnpackedKits: deleting bad unpacked kit '%s': bad metadata\n", update.directory.absolutePath( ).toUtf8( ).data( ) );
-        }
-    }
-
-    _unprocessedUpgradeKits = std::move( _processedUpgradeKits );
-    _checkNextKitsHashes( );
-}
-
-void UpgradeManager::_checkNextKitsHashes( ) {
-    debug( "+ UpgradeManager::_checkNextKitsHashes\n" );
-
-    if ( _unprocessedUpgradeKits.isEmpty( ) ) {
-        debug( "  + finished checking checksums, %d good kits\n", _goodUpgradeKits.count( ) );
-
-        _unprocessedUpgradeKits.clear( );
-        _processedUpgradeKits.clear( );
-
-        emit upgradeCheckComplete( _goodUpgradeKits.count( ) > 0 );
-        return;
-    }
-
-    if ( !_hashChecker ) {
-        _hashChecker = new Hasher;
-        QObject::connect( _hashChecker, &Hasher::hashCheckResult, this, &UpgradeManager::hasher_hashCheckResult, Qt::QueuedConnection );
-    }
-
-    _hashChecker->checkHashes( _unprocessedUpgradeKits[0].checksums, QCryptographicHash::Sha256 );
-}
-
-void UpgradeManager::hasher_hashCheckResult( bool const result ) {
-    debug( "+ UpgradeManager::hasher_hashCheckResult: result is %s\n", ToString( result ) );
-
-    if ( result ) {
-        _goodUpgradeKits.append( _unprocessedUpgradeKits[0] );
-    }
-    _unprocessedUpgradeKits.removeFirst( );
-    _checkNextKitsHashes( );
-}
-
 void UpgradeManager::checkForUpgrades( QString const& upgradesPath ) {
     if ( _isBusy.test_and_set( ) ) {
         debug( "+ UpgradeManager::checkForUpgrades: already busy performing an upgrade check or upgrade install\n" );
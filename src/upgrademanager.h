@@ -7,11 +7,8 @@
 // Forward declarations
 //
 
-class GpgSignatureChecker;
-class Hasher;
 class ProcessRunner;
 class StdioLogger;
-class UpgradeKitUnpacker;
 
 //
 // Class UpgradeKitInfo
@@ -88,16 +85,14 @@ private:
 
     std::atomic_flag     _isBusy                 { ATOMIC_FLAG_INIT };
 
-    GpgSignatureChecker* _gpgSignatureChecker    { };
-    Hasher*              _hashChecker            { };
     ProcessRunner*       _processRunner          { };
-    UpgradeKitUnpacker*  _upgradeKitUnpacker     { };
     UpgradeKitInfo*      _kitToInstall           { };
     StdioLogger*         _stderrLogger           { };
     StdioLogger*         _stdoutLogger           { };
 
     UpgradeKitInfoList   _unprocessedUpgradeKits;
-    UpgradeKitInfoList   _processedUpgradeKits;
+    QVector<bool>        _kitResults;
+    int                  _kitsBeingVerified      { };
     UpgradeKitInfoList   _goodUpgradeKits;
 
     QString              _stderrJournal;
@@ -108,12 +103,11 @@ private:
     void _flushLoggers( );
     void _clearJournals( );
     void _checkForUpgrades( QString const& upgradesPath );
-    void _checkNextKitSignature( );
-    void _unpackNextKit( );
-    void _checkNextVersionInfSignature( );
+    void _verifyKits( );
+    void _verifyKit( int const index, UpgradeKitInfo kit );
+    bool _checkKit( UpgradeKitInfo& kit );
+    void _kitVerified( int const index, UpgradeKitInfo const& kit, bool const result );
     bool _parseVersionInfo( QString const& versionInfoFileName, UpgradeKitInfo& info );
-    void _examineUnpackedKits( );
-    void _checkNextKitsHashes( );
 
 signals:
     ;
@@ -134,17 +128,6 @@ protected slots:
 private slots:
     ;
 
-    void gpgSignatureChecker_kit_complete( bool const result );
-    void gpgSignatureChecker_versionInf_complete( bool const result );
-
-    void hasher_hashCheckResult( bool const result );
-
-#if defined _DEBUG
-    void upgradeKitUnpacker_complete( bool const result, QString const& tarOutput, QString const& tarError );
-#else
-    void upgradeKitUnpacker_complete( bool const result );
-#endif // defined _DEBUG
-
     void aptGetUpdate_succeeded( );
     void aptGetUpdate_failed( int const exitCode, QProcess::ProcessError const error );
 